@@ -2,6 +2,7 @@
 
 // Windows Forms için gerekli başlıklar
 #include <Windows.h>
+#include <vcclr.h>
 
 // C++/CLI için gerekli tanımlamalar
 #ifdef _MANAGED
@@ -32,6 +33,7 @@ namespace monte_carlo_pi_app {
 public ref class MainForm : public Form {
  public:
   MainForm(void) {
+    cancellation = new monte_carlo_pi::CancellationToken();
     InitializeComponent();
   }
 
@@ -40,6 +42,8 @@ public ref class MainForm : public Form {
     if (components) {
       delete components;
     }
+
+    delete cancellation;
   }
 
  private:
@@ -47,12 +51,14 @@ public ref class MainForm : public Form {
   NumericUpDown ^numPoints;
   NumericUpDown ^numThreads;
   Button ^calculateButton;
+  Button ^cancelButton;
   Label ^resultLabel;
   Label ^pointsLabel;
   Label ^threadsLabel;
   ProgressBar ^progressBar;
   System::Drawing::Font ^defaultFont;
   BackgroundWorker ^backgroundWorker;
+  monte_carlo_pi::CancellationToken *cancellation;
 
   void InitializeComponent(void) {
     // Varsayılan font ayarı
@@ -60,6 +66,7 @@ public ref class MainForm : public Form {
     this->numPoints = (gcnew NumericUpDown());
     this->numThreads = (gcnew NumericUpDown());
     this->calculateButton = (gcnew Button());
+    this->cancelButton = (gcnew Button());
     this->resultLabel = (gcnew Label());
     this->pointsLabel = (gcnew Label());
     this->threadsLabel = (gcnew Label());
@@ -108,6 +115,15 @@ public ref class MainForm : public Form {
     this->calculateButton->Text = L"Calculate";
     this->calculateButton->Font = defaultFont;
     this->calculateButton->Click += gcnew EventHandler(this, &MainForm::calculateButton_Click);
+    // cancelButton
+    this->cancelButton->Location = Drawing::Point(12, 65);
+    this->cancelButton->Name = L"cancelButton";
+    this->cancelButton->Size = Drawing::Size(100, 23);
+    this->cancelButton->TabIndex = 7;
+    this->cancelButton->Text = L"Cancel";
+    this->cancelButton->Font = defaultFont;
+    this->cancelButton->Enabled = false;
+    this->cancelButton->Click += gcnew EventHandler(this, &MainForm::cancelButton_Click);
     // resultLabel
     this->resultLabel->AutoSize = true;
     this->resultLabel->Location = Drawing::Point(12, 100);
@@ -121,6 +137,13 @@ public ref class MainForm : public Form {
     this->progressBar->Size = Drawing::Size(226, 23);
     this->progressBar->TabIndex = 6;
     this->progressBar->Visible = false;
+    this->progressBar->Minimum = 0;
+    this->progressBar->Maximum = 100;
+    // backgroundWorker
+    this->backgroundWorker->WorkerReportsProgress = true;
+    this->backgroundWorker->DoWork += gcnew DoWorkEventHandler(this, &MainForm::CalculatePi);
+    this->backgroundWorker->ProgressChanged += gcnew ProgressChangedEventHandler(this, &MainForm::CalculationProgress);
+    this->backgroundWorker->RunWorkerCompleted += gcnew RunWorkerCompletedEventHandler(this, &MainForm::CalculationComplete);
     // MainForm
     this->AutoScaleDimensions = Drawing::SizeF(6, 13);
     this->AutoScaleMode = Windows::Forms::AutoScaleMode::Font;
@@ -128,6 +151,7 @@ public ref class MainForm : public Form {
     this->Controls->Add(this->progressBar);
     this->Controls->Add(this->resultLabel);
     this->Controls->Add(this->calculateButton);
+    this->Controls->Add(this->cancelButton);
     this->Controls->Add(this->numThreads);
     this->Controls->Add(this->threadsLabel);
     this->Controls->Add(this->numPoints);
@@ -143,29 +167,50 @@ public ref class MainForm : public Form {
 
   void calculateButton_Click(Object ^ /*sender*/, EventArgs ^ /*e*/) {
     calculateButton->Enabled = false;
+    cancelButton->Enabled = true;
+    cancellation->reset();
     progressBar->Visible = true;
-    progressBar->Style = ProgressBarStyle::Marquee;
-    backgroundWorker->DoWork += gcnew DoWorkEventHandler(this, &MainForm::CalculatePi);
-    backgroundWorker->RunWorkerCompleted += gcnew RunWorkerCompletedEventHandler(this, &MainForm::CalculationComplete);
+    progressBar->Style = ProgressBarStyle::Continuous;
+    progressBar->Value = 0;
     backgroundWorker->RunWorkerAsync();
   }
 
+  void cancelButton_Click(Object ^ /*sender*/, EventArgs ^ /*e*/) {
+    cancelButton->Enabled = false;
+    cancellation->cancel();
+  }
+
   void CalculatePi(Object ^ /*sender*/, DoWorkEventArgs ^e) {
     try {
       long long points = Decimal::ToInt64(numPoints->Value);
       int threads = Decimal::ToInt32(numThreads->Value);
-      double pi = monte_carlo_pi::calculate_pi_parallel(points, threads);
-      e->Result = pi;
+      monte_carlo_pi::EstimateOptions options;
+      options.num_threads = threads;
+      options.seed = static_cast<std::uint64_t>(DateTime::Now.Ticks);
+      // Report roughly once per percent; ReportProgress marshals to the UI thread
+      gcroot<BackgroundWorker ^> worker = backgroundWorker;
+      monte_carlo_pi::EstimateResult result = monte_carlo_pi::calculate_pi_parallel(
+          points, options, [worker](const monte_carlo_pi::Progress & progress) {
+        int percent = static_cast<int>(100 * progress.points_done / progress.points_total);
+        worker->ReportProgress(percent, progress.estimate);
+      }, cancellation, points / 100 > 0 ? points / 100 : 1);
+      e->Result = result.estimate;
     } catch (Exception ^ex) {
       MessageBox::Show(ex->Message, L"Error", MessageBoxButtons::OK, MessageBoxIcon::Error);
       e->Result = 0.0;
     }
   }
 
+  void CalculationProgress(Object ^ /*sender*/, ProgressChangedEventArgs ^e) {
+    progressBar->Value = Math::Min(e->ProgressPercentage, 100);
+    resultLabel->Text = String::Format(L"PI ~ {0:F6} ({1}%)", safe_cast<double>(e->UserState), e->ProgressPercentage);
+  }
+
   void CalculationComplete(Object ^ /*sender*/, RunWorkerCompletedEventArgs ^e) {
     double pi = safe_cast<double>(e->Result);
-    resultLabel->Text = String::Format(L"PI = {0:F6}", pi);
+    resultLabel->Text = String::Format(cancellation->is_cancelled() ? L"PI ~ {0:F6} (cancelled)" : L"PI = {0:F6}", pi);
     calculateButton->Enabled = true;
+    cancelButton->Enabled = false;
     progressBar->Visible = false;
   }
 };
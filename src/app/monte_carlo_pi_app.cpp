@@ -1,80 +1,483 @@
 #include <iostream>
 #include <vector>
-#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
-#include <algorithm>
-#include <numeric>
+#include <map>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include "monte_carlo_pi.h"
-#include "MainForm.h"
+#include "timing_harness.h"
+#include "perf_counters.h"
+#include "trace_control.h"
+
+#if defined(_WIN32)
+  #include "MainForm.h"
 
 using namespace monte_carlo_pi_app;
 using namespace System;
 using namespace System::Windows::Forms;
+#endif
 
-// Test different thread counts (0 = sequential, 1 = default threads, 2,4,8,16 threads)
+// Test different thread counts (0 = sequential, 1 = one thread, 2,4,8,16 threads)
 const std::vector<int> thread_counts = {0, 1, 2, 4, 8, 16};
 
-// Function to measure execution time with multiple runs
-template<typename Func>
-std::vector<double> measure_time_multiple_runs(Func f, int num_runs = 5) {
-  std::vector<double> times;
-  times.reserve(num_runs);
+// Default point counts of the command-line sweep
+const std::vector<long long> point_counts = {1000000, 10000000, 100000000};
 
-  for (int i = 0; i < num_runs; ++i) {
-    auto start = std::chrono::high_resolution_clock::now();
-    f();
-    auto end = std::chrono::high_resolution_clock::now();
-    times.push_back(std::chrono::duration<double>(end - start).count());
-  }
+// Exit codes of the command-line sweep
+enum ExitCode {
+  kExitSuccess = 0,
+  kExitUsage = 1,
+  kExitIoError = 2,
+  kExitBadEstimate = 3,
+  kExitRegression = 4
+};
 
-  return times;
-}
+// Timing statistics of one configuration: warmup, steady clock, outlier
+// rejection, Welford moments, percentiles and a bootstrap interval of the median
+using TimeStats = monte_carlo_pi::TimingStats;
 
-// Function to calculate statistics
-struct TimeStats {
-  double mean;
-  double std_dev;
-  double min;
-  double max;
+// One row of the sweep: a point count run sequentially or with a thread count
+struct SweepResult {
+  long long points;
+  int threads;  // 0 for the sequential run
+  TimeStats seq;
+  TimeStats par;
+  double pi;
+  monte_carlo_pi::ProfiledEstimate profile;  // Hardware counters of one extra run, if requested
 };
 
-TimeStats calculate_stats(const std::vector<double> &times) {
-  TimeStats stats;
-  stats.mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
-  double sq_sum = std::inner_product(times.begin(), times.end(), times.begin(), 0.0);
-  stats.std_dev = std::sqrt(sq_sum / times.size() - stats.mean * stats.mean);
-  auto [min_it, max_it] = std::minmax_element(times.begin(), times.end());
-  stats.min = *min_it;
-  stats.max = *max_it;
-  return stats;
+// Speedup of the medians, which outliers and skewed run times affect less than the means
+double speedup(const SweepResult &result) {
+  return result.seq.median / result.par.median;
+}
+
+// Baseline name of a row
+std::string result_name(const SweepResult &result) {
+  return "points=" + std::to_string(result.points) + "/threads="
+         + (result.threads == 0 ? std::string("sequential") : std::to_string(result.threads));
+}
+
+double efficiency(const SweepResult &result) {
+  return result.threads > 0 ? speedup(result) / result.threads : 1.0;
 }
 
 // Function to save results to CSV file
-void save_results_to_csv(const std::string &filename,
-                         const std::vector<long long> &point_counts,
-                         const std::vector<std::vector<TimeStats>> &seq_stats,
-                         const std::vector<std::vector<TimeStats>> &par_stats) {
-  std::ofstream file(filename);
-  file << "Points,Threads,Sequential Mean (s),Sequential StdDev (s),Sequential Min (s),Sequential Max (s),"
-       << "Parallel Mean (s),Parallel StdDev (s),Parallel Min (s),Parallel Max (s),Speedup\n";
-
-  for (size_t i = 0; i < point_counts.size(); ++i) {
-    for (size_t j = 0; j < seq_stats[i].size(); ++j) {
-      const auto &seq = seq_stats[i][j];
-      const auto &par = par_stats[i][j];
-      double speedup = seq.mean / par.mean;
-      file << point_counts[i] << ","
-           << (j == 0 ? "sequential" : std::to_string(thread_counts[j])) << ","
-           << std::fixed << std::setprecision(6)
-           << seq.mean << "," << seq.std_dev << "," << seq.min << "," << seq.max << ","
-           << par.mean << "," << par.std_dev << "," << par.min << "," << par.max << ","
-           << speedup << "\n";
+void save_results_to_csv(std::ostream &file, const std::vector<SweepResult> &results) {
+  const auto stats_header = [&file](const char *run) {
+    for (const char *column : {"Mean", "StdDev", "Min", "Max", "Median", "P90", "P99", "Median CI Low", "Median CI High"}) {
+      file << run << " " << column << " (s),";
+    }
+
+    file << run << " Runs," << run << " Outliers,";
+  };
+  const auto stats_csv = [&file](const TimeStats & stats) {
+    file << std::fixed << std::setprecision(6)
+         << stats.mean << "," << stats.std_dev << "," << stats.min << "," << stats.max << ","
+         << stats.median << "," << stats.p90 << "," << stats.p99 << "," << stats.ci_lower << "," << stats.ci_upper << ","
+         << stats.runs << "," << stats.outliers << ",";
+  };
+  file << "Points,Threads,";
+  stats_header("Sequential");
+  stats_header("Parallel");
+  file << "Speedup,Efficiency,Pi";
+
+  for (int event = 0; event < monte_carlo_pi::kHardwareEventCount; ++event) {
+    file << "," << monte_carlo_pi::hardware_event_name(static_cast<monte_carlo_pi::HardwareEvent>(event)) << " per point";
+  }
+
+  file << "\n";
+
+  for (const SweepResult &result : results) {
+    file << result.points << ","
+         << (result.threads == 0 ? "sequential" : std::to_string(result.threads)) << ",";
+    stats_csv(result.seq);
+    stats_csv(result.par);
+    file << speedup(result) << "," << efficiency(result) << ","
+         << std::setprecision(10) << result.pi;
+
+    // Unavailable counters are left empty
+    for (int event = 0; event < monte_carlo_pi::kHardwareEventCount; ++event) {
+      const double per_point = result.profile.per_point(static_cast<monte_carlo_pi::HardwareEvent>(event));
+      file << ",";
+
+      if (per_point >= 0.0) {
+        file << std::setprecision(4) << per_point;
+      }
+    }
+
+    file << "\n";
+  }
+}
+
+// Function to save the hardware counters of every thread to a CSV file
+void save_thread_counters_to_csv(std::ostream &file, const std::vector<SweepResult> &results) {
+  file << "Points,Threads,Thread,Thread Points";
+
+  for (int event = 0; event < monte_carlo_pi::kHardwareEventCount; ++event) {
+    const char *name = monte_carlo_pi::hardware_event_name(static_cast<monte_carlo_pi::HardwareEvent>(event));
+    file << "," << name << "," << name << " per point";
+  }
+
+  file << "\n";
+
+  for (const SweepResult &result : results) {
+    for (const monte_carlo_pi::ThreadProfile &thread : result.profile.threads) {
+      file << result.points << "," << (result.threads == 0 ? "sequential" : std::to_string(result.threads)) << ","
+           << thread.thread << "," << thread.points;
+
+      for (int event = 0; event < monte_carlo_pi::kHardwareEventCount; ++event) {
+        const auto hardware_event = static_cast<monte_carlo_pi::HardwareEvent>(event);
+        file << ",";
+
+        if (thread.counters.has(hardware_event)) {
+          file << thread.counters.value(hardware_event) << "," << std::fixed << std::setprecision(4)
+               << (thread.points > 0 ? static_cast<double>(thread.counters.value(hardware_event)) / thread.points : 0.0);
+        } else {
+          file << ",";
+        }
+      }
+
+      file << "\n";
+    }
+  }
+}
+
+// Function to save results to JSON file
+void save_results_to_json(std::ostream &file, const std::vector<SweepResult> &results) {
+  const auto stats_json = [](const TimeStats & stats) {
+    std::ostringstream out;
+    out << std::setprecision(9) << "{\"mean\": " << stats.mean << ", \"std_dev\": " << stats.std_dev
+        << ", \"min\": " << stats.min << ", \"max\": " << stats.max << ", \"median\": " << stats.median
+        << ", \"p90\": " << stats.p90 << ", \"p99\": " << stats.p99 << ", \"median_ci\": [" << stats.ci_lower
+        << ", " << stats.ci_upper << "], \"runs\": " << stats.runs << ", \"outliers\": " << stats.outliers << "}";
+    return out.str();
+  };
+  file << "{\n  \"results\": [";
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const SweepResult &result = results[i];
+    file << (i == 0 ? "\n" : ",\n") << std::setprecision(9)
+         << "    {\"points\": " << result.points << ", \"threads\": " << result.threads
+         << ", \"sequential\": " << stats_json(result.seq) << ", \"parallel\": " << stats_json(result.par)
+         << ", \"speedup\": " << speedup(result) << ", \"efficiency\": " << efficiency(result)
+         << ", \"pi\": " << std::setprecision(12) << result.pi;
+
+    if (!result.profile.threads.empty()) {
+      file << ", \"counters_per_point\": {";
+
+      for (int event = 0; event < monte_carlo_pi::kHardwareEventCount; ++event) {
+        const auto hardware_event = static_cast<monte_carlo_pi::HardwareEvent>(event);
+        const double per_point = result.profile.per_point(hardware_event);
+        file << (event == 0 ? "" : ", ") << "\"" << monte_carlo_pi::hardware_event_name(hardware_event) << "\": ";
+
+        if (per_point >= 0.0) {
+          file << std::setprecision(6) << per_point;
+        } else {
+          file << "null";
+        }
+      }
+
+      file << "}, \"thread_points\": [";
+
+      for (size_t t = 0; t < result.profile.threads.size(); ++t) {
+        file << (t == 0 ? "" : ", ") << result.profile.threads[t].points;
+      }
+
+      file << "]";
+    }
+
+    file << "}";
+  }
+
+  file << "\n  ]\n}\n";
+}
+
+// Runs the sweep; every estimate uses the same seeded stream so runs are comparable
+std::vector<SweepResult> run_sweep(const std::vector<long long> &points, const std::vector<int> &threads,
+                                   const monte_carlo_pi::TimingOptions &timing, std::uint64_t seed, bool profile) {
+  std::vector<SweepResult> results;
+
+  for (long long num_points : points) {
+    double pi = 0.0;
+    const TimeStats seq = monte_carlo_pi::measure_time([&pi, num_points, seed]() {
+      pi = monte_carlo_pi::calculate_pi_sequential(num_points, seed);
+    }, timing);
+
+    for (int thread_count : threads) {
+      SweepResult result = {num_points, thread_count, seq, seq, pi, monte_carlo_pi::ProfiledEstimate()};
+
+      if (thread_count > 0) {
+        result.par = monte_carlo_pi::measure_time([&result, num_points, thread_count, seed]() {
+          result.pi = monte_carlo_pi::calculate_pi_parallel(num_points, thread_count, seed);
+        }, timing);
+      }
+
+      // Counters come from a separate run so they never perturb the timings
+      if (profile && thread_count > 0) {
+        monte_carlo_pi::EstimateOptions options;
+        options.num_threads = thread_count;
+        options.seed = seed;
+        result.profile = monte_carlo_pi::calculate_pi_parallel_profiled(num_points, options);
+      } else if (profile) {
+        result.profile = monte_carlo_pi::generate_points_profiled(num_points, seed);
+      }
+
+      results.push_back(result);
+    }
+  }
+
+  return results;
+}
+
+// Parses a comma-separated list of positive (or, for thread counts, non-negative) integers
+template<typename T>
+std::vector<T> parse_list(const std::string &text, long long minimum) {
+  std::vector<T> values;
+  std::istringstream stream(text);
+  std::string item;
+
+  while (std::getline(stream, item, ',')) {
+    size_t used = 0;
+    long long value = 0;
+
+    try {
+      value = std::stoll(item, &used);
+    } catch (const std::exception &) {
+      throw std::invalid_argument(item);
+    }
+
+    if (used != item.size() || value < minimum) {
+      throw std::invalid_argument(item);
     }
+
+    values.push_back(static_cast<T>(value));
   }
+
+  if (values.empty()) {
+    throw std::invalid_argument(text);
+  }
+
+  return values;
 }
 
+// Parses a non-negative fraction such as a relative slowdown
+double parse_fraction(const std::string &text) {
+  size_t used = 0;
+  double value = 0.0;
+
+  try {
+    value = std::stod(text, &used);
+  } catch (const std::exception &) {
+    throw std::invalid_argument(text);
+  }
+
+  if (used != text.size() || !(value >= 0.0)) {
+    throw std::invalid_argument(text);
+  }
+
+  return value;
+}
+
+// Parses a seed over the full unsigned 64-bit range; only digits may lead, as stoull would wrap a negative value
+std::uint64_t parse_seed(const std::string &text) {
+  size_t used = 0;
+  unsigned long long value = 0;
+
+  if (text.empty() || text[0] < '0' || text[0] > '9') {
+    throw std::invalid_argument(text);
+  }
+
+  try {
+    value = std::stoull(text, &used);
+  } catch (const std::exception &) {
+    throw std::invalid_argument(text);
+  }
+
+  if (used != text.size()) {
+    throw std::invalid_argument(text);
+  }
+
+  return static_cast<std::uint64_t>(value);
+}
+
+void print_usage(std::ostream &out) {
+  out << "Usage: monte_carlo_pi_app [options]\n"
+      << "  --points N[,N...]   point counts (default 1000000,10000000,100000000)\n"
+      << "  --threads T[,T...]  thread counts, 0 for the sequential run (default 0,1,2,4,8,16)\n"
+      << "  --warmup W          untimed warmup runs per configuration (default 2)\n"
+      << "  --runs R            timed runs per configuration (default 10)\n"
+      << "  --seed S            seed of the point stream, 0 to 2^64-1 (default 1)\n"
+      << "  --csv FILE          write CSV results to FILE (- for stdout)\n"
+      << "  --json FILE         write JSON results to FILE (- for stdout)\n"
+      << "  --perf              collect hardware counters (Linux perf_event_open) in one extra run per row\n"
+      << "  --perf-csv FILE     write the per-thread counters to FILE (- for stdout), implies --perf\n"
+      << "  --trace FILE        write a Chrome trace of the parallel threads to FILE (chrome://tracing, Perfetto)\n"
+      << "  --save-baseline F   store the parallel timings as baseline file F\n"
+      << "  --baseline F        compare the parallel timings with baseline file F\n"
+      << "  --max-slowdown X    ignore significant slowdowns up to the fraction X (default 0.05)\n"
+      << "Without --csv or --json the CSV is written to stdout.\n"
+      << "Exit codes: 0 success, 1 usage error, 2 input/output error, 3 estimate outside 6 standard errors of Pi,\n"
+      << "4 significant slowdown against the baseline.\n";
+}
+
+// Writes one report to a file or, for "-", to stdout
+bool write_report(const std::string &path, const std::vector<SweepResult> &results,
+                  void (*save)(std::ostream &, const std::vector<SweepResult> &)) {
+  if (path == "-") {
+    save(std::cout, results);
+    return static_cast<bool>(std::cout);
+  }
+
+  std::ofstream file(path);
+
+  if (!file) {
+    return false;
+  }
+
+  save(file, results);
+  file.close();
+  return !file.fail();
+}
+
+// Headless benchmark driver: point-count x thread-count sweep with CSV/JSON output
+int run_cli(int argc, char **argv) {
+  std::vector<long long> points = point_counts;
+  std::vector<int> threads = thread_counts;
+  monte_carlo_pi::TimingOptions timing;
+  std::uint64_t seed = 1;
+  std::string csv_path;
+  std::string json_path;
+  std::string baseline_path;
+  std::string save_baseline_path;
+  double max_slowdown = 0.05;
+  bool profile = false;
+  std::string perf_csv_path;
+  std::string trace_path;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+
+      if (arg == "--help" || arg == "-h") {
+        print_usage(std::cout);
+        return kExitSuccess;
+      }
+
+      if (arg == "--perf") {
+        profile = true;
+        continue;
+      }
+
+      if (i + 1 >= argc) {
+        throw std::invalid_argument(arg);
+      }
+
+      const std::string value = argv[++i];
+
+      if (arg == "--points") {
+        points = parse_list<long long>(value, 1);
+      } else if (arg == "--threads") {
+        threads = parse_list<int>(value, 0);
+      } else if (arg == "--warmup") {
+        timing.warmup_runs = parse_list<int>(value, 0).at(0);
+      } else if (arg == "--runs") {
+        timing.runs = parse_list<int>(value, 1).at(0);
+      } else if (arg == "--seed") {
+        seed = parse_seed(value);
+      } else if (arg == "--csv") {
+        csv_path = value;
+      } else if (arg == "--json") {
+        json_path = value;
+      } else if (arg == "--perf-csv") {
+        perf_csv_path = value;
+        profile = true;
+      } else if (arg == "--trace") {
+        trace_path = value;
+      } else if (arg == "--baseline") {
+        baseline_path = value;
+      } else if (arg == "--save-baseline") {
+        save_baseline_path = value;
+      } else if (arg == "--max-slowdown") {
+        max_slowdown = parse_fraction(value);
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  } catch (const std::exception &error) {
+    std::cerr << "Invalid argument: " << error.what() << "\n";
+    print_usage(std::cerr);
+    return kExitUsage;
+  }
+
+  if (csv_path.empty() && json_path.empty()) {
+    csv_path = "-";
+  }
+
+  std::map<std::string, TimeStats> baseline;
+
+  if (!baseline_path.empty() && !monte_carlo_pi::load_baseline(baseline_path, &baseline)) {
+    std::cerr << "Cannot read baseline " << baseline_path << ".\n";
+    return kExitIoError;
+  }
+
+  if (profile && !monte_carlo_pi::PerfCounters().supported()) {
+    std::cerr << "Hardware counters are unavailable (perf_event_open failed); counter columns stay empty.\n";
+  }
+
+  monte_carlo_pi::set_tracing_enabled(!trace_path.empty());
+  const std::vector<SweepResult> results = run_sweep(points, threads, timing, seed, profile);
+  monte_carlo_pi::set_tracing_enabled(false);
+  std::map<std::string, TimeStats> current;
+
+  for (const SweepResult &result : results) {
+    current[result_name(result)] = result.par;
+  }
+
+  if ((!csv_path.empty() && !write_report(csv_path, results, save_results_to_csv))
+      || (!json_path.empty() && !write_report(json_path, results, save_results_to_json))
+      || (!perf_csv_path.empty() && !write_report(perf_csv_path, results, save_thread_counters_to_csv))
+      || (!trace_path.empty() && !monte_carlo_pi::write_chrome_trace(trace_path))) {
+    std::cerr << "Cannot write results.\n";
+    return kExitIoError;
+  }
+
+  if (!save_baseline_path.empty() && !monte_carlo_pi::save_baseline(save_baseline_path, current)) {
+    std::cerr << "Cannot write baseline " << save_baseline_path << ".\n";
+    return kExitIoError;
+  }
+
+  // A correct estimator stays within a few binomial standard errors of Pi
+  const double pi = std::acos(-1.0);
+
+  for (const SweepResult &result : results) {
+    const double p = pi / 4.0;
+    const double standard_error = 4.0 * std::sqrt(p * (1.0 - p) / result.points);
+
+    if (std::abs(result.pi - pi) > 6.0 * standard_error) {
+      std::cerr << "Estimate " << result.pi << " for " << result.points << " points is outside 6 standard errors of Pi.\n";
+      return kExitBadEstimate;
+    }
+  }
+
+  bool regressed = false;
+
+  for (const monte_carlo_pi::RegressionCheck &check : monte_carlo_pi::compare_to_baseline(baseline, current, max_slowdown)) {
+    if (check.regression) {
+      std::cerr << "Regression: " << check.name << " median " << check.current_median << " s vs baseline "
+                << check.baseline_median << " s (x" << check.ratio << ").\n";
+      regressed = true;
+    }
+  }
+
+  return regressed ? kExitRegression : kExitSuccess;
+}
+
+#if defined(_WIN32)
+
 [STAThread]
 int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/,
                    LPSTR /*lpCmdLine*/, int /*nCmdShow*/) {
@@ -83,3 +486,11 @@ int WINAPI WinMain(HINSTANCE /*hInstance*/, HINSTANCE /*hPrevInstance*/,
   Application::Run(gcnew MainForm());
   return 0;
 }
+
+#else
+
+int main(int argc, char **argv) {
+  return run_cli(argc, argv);
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include <benchmark/benchmark.h>
+#include "monte_carlo_pi.h"
+#include "rng_engines.h"
+#include "mathUtility.h"
+#include <omp.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Sweeps points x threads x kernel x engine. Run with
+//   monte_carlo_pi_bench --benchmark_format=json --benchmark_out=bench.json
+// compare two JSON files with Google Benchmark's tools/compare.py, and get
+// the scaling efficiency of each configuration with scaling_efficiency.py.
+
+namespace {
+
+// Point generators under test: the Philox stream in both arithmetics and the QMC sequences
+enum class Engine {
+  PhiloxDouble,
+  PhiloxFixed,
+  Sobol,
+  Halton,
+  R2
+};
+
+constexpr std::uint64_t kSeed = 42;
+
+const char *engine_name(Engine engine) {
+  switch (engine) {
+    case Engine::PhiloxDouble:
+      return "philox-double";
+
+    case Engine::PhiloxFixed:
+      return "philox-fixed";
+
+    case Engine::Sobol:
+      return "sobol";
+
+    case Engine::Halton:
+      return "halton";
+
+    case Engine::R2:
+      return "r2";
+  }
+
+  return "unknown";
+}
+
+bool is_qmc(Engine engine) {
+  return engine == Engine::Sobol || engine == Engine::Halton || engine == Engine::R2;
+}
+
+// Seconds per point, from the benchmark's own timer (real time with UseRealTime)
+benchmark::Counter seconds_per_point(long long num_points) {
+  return benchmark::Counter(static_cast<double>(num_points), benchmark::Counter::kIsIterationInvariantRate
+                            | benchmark::Counter::kInvert);
+}
+
+// Arguments: points, threads, kernel level, engine
+void BM_CalculatePi(benchmark::State &state) {
+  const long long num_points = state.range(0);
+  const int threads = static_cast<int>(state.range(1));
+  const monte_carlo_pi::SimdLevel level = static_cast<monte_carlo_pi::SimdLevel>(state.range(2));
+  const Engine engine = static_cast<Engine>(state.range(3));
+
+  monte_carlo_pi::EstimateOptions options;
+  options.num_threads = threads;
+  options.seed = kSeed;
+  options.simd_level = level;
+  options.arithmetic = engine == Engine::PhiloxFixed ? monte_carlo_pi::Arithmetic::FixedPoint : monte_carlo_pi::Arithmetic::Double;
+
+  for (auto _ : state) {
+    switch (engine) {
+      case Engine::Sobol:
+        benchmark::DoNotOptimize(monte_carlo_pi::calculate_pi_qmc(num_points, monte_carlo_pi::Sequence::Sobol, 1, threads, kSeed));
+        break;
+
+      case Engine::Halton:
+        benchmark::DoNotOptimize(monte_carlo_pi::calculate_pi_qmc(num_points, monte_carlo_pi::Sequence::Halton, 1, threads, kSeed));
+        break;
+
+      case Engine::R2:
+        benchmark::DoNotOptimize(monte_carlo_pi::calculate_pi_qmc(num_points, monte_carlo_pi::Sequence::R2, 1, threads, kSeed));
+        break;
+
+      default:
+        benchmark::DoNotOptimize(monte_carlo_pi::calculate_pi_parallel(num_points, options));
+        break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_points);
+  state.SetLabel(std::string(engine_name(engine)) + "/" + (is_qmc(engine) ? "scalar" : monte_carlo_pi::simd_level_name(level)));
+  state.counters["s_per_point"] = seconds_per_point(num_points);
+}
+
+// Registers every combination, with a single-thread run per group as the scaling baseline
+void sweep(benchmark::internal::Benchmark *benchmark) {
+  const int max_threads = omp_get_max_threads();
+  const int host_level = static_cast<int>(monte_carlo_pi::detect_simd_level());
+
+  for (int engine = 0; engine <= static_cast<int>(Engine::R2); ++engine) {
+    // The QMC sequences have a single scalar kernel
+    const int last_level = is_qmc(static_cast<Engine>(engine)) ? 0 : host_level;
+
+    for (int level = 0; level <= last_level; ++level) {
+      for (long long points : {1LL << 16, 1LL << 20, 1LL << 24}) {
+        for (int threads = 1; threads < 2 * max_threads; threads *= 2) {
+          benchmark->Args({points, std::min(threads, max_threads), level, engine});
+        }
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_CalculatePi)
+->ArgNames({"points", "threads", "kernel", "engine"})
+->Apply(sweep)
+->UseRealTime()
+->Unit(benchmark::kMillisecond);
+
+// Arguments: points, threads, index into rng_engines()
+void BM_RngEngine(benchmark::State &state) {
+  const long long num_points = state.range(0);
+  const monte_carlo_pi::RngEngine &engine = monte_carlo_pi::rng_engines()[static_cast<std::size_t>(state.range(2))];
+  monte_carlo_pi::EstimateOptions options;
+  options.num_threads = static_cast<int>(state.range(1));
+  options.seed = kSeed;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(engine.count_points_inside(0, num_points, options));
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_points);
+  state.SetLabel(engine.name);
+  state.counters["s_per_point"] = seconds_per_point(num_points);
+}
+
+void engines(benchmark::internal::Benchmark *benchmark) {
+  for (std::size_t engine = 0; engine < monte_carlo_pi::rng_engines().size(); ++engine) {
+    for (int threads = 1; threads < 2 * omp_get_max_threads(); threads *= 2) {
+      benchmark->Args({1LL << 22, std::min(threads, omp_get_max_threads()), static_cast<long long>(engine)});
+    }
+  }
+}
+
+BENCHMARK(BM_RngEngine)
+->ArgNames({"points", "threads", "engine"})
+->Apply(engines)
+->UseRealTime()
+->Unit(benchmark::kMillisecond);
+
+// Arguments: values, threads
+void BM_CalculateMoments(benchmark::State &state) {
+  std::vector<double> data(static_cast<std::size_t>(state.range(0)));
+
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<double>(i % 1000);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Can::Utility::MathUtility::calculateMoments(data.data(), data.size(),
+                             static_cast<int>(state.range(1))).variance());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * state.range(0) * static_cast<int64_t>(sizeof(double)));
+  state.SetLabel(Can::Utility::MathUtility::usesAvx2() ? "avx2" : "scalar");
+}
+
+BENCHMARK(BM_CalculateMoments)
+->ArgNames({"values", "threads"})
+->ArgsProduct({{1 << 16, 1 << 24}, {1, omp_get_max_threads()}})
+->UseRealTime()
+->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Prints the parallel scaling efficiency of a monte_carlo_pi_bench JSON report.
+
+Usage: scaling_efficiency.py bench.json
+
+Runs that differ only in their thread count form a group. The efficiency of
+a run is T1 / (N * TN), where T1 is the time of the group's single-thread
+run and TN the time with N threads. With --benchmark_repetitions the median
+aggregate is used, otherwise the mean of the iteration runs.
+"""
+
+import json
+import re
+import sys
+from collections import defaultdict
+
+THREADS = re.compile(r"/threads:(\d+)")
+
+
+def run_times(benchmarks):
+    """Maps each run name to its real time, preferring the median aggregate."""
+    medians = {}
+    samples = defaultdict(list)
+
+    for entry in benchmarks:
+        name = entry.get("run_name", entry["name"])
+
+        if entry.get("run_type") == "aggregate":
+            if entry.get("aggregate_name") == "median":
+                medians[name] = entry["real_time"]
+        else:
+            samples[name].append(entry["real_time"])
+
+    times = {name: sum(values) / len(values) for name, values in samples.items()}
+    times.update(medians)
+    return times
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write(__doc__)
+        return 2
+
+    with open(argv[1]) as report:
+        times = run_times(json.load(report)["benchmarks"])
+
+    groups = defaultdict(dict)
+
+    for name, time in times.items():
+        match = THREADS.search(name)
+
+        if match:
+            groups[THREADS.sub("/threads:*", name)][int(match.group(1))] = time
+
+    print("%-70s %8s %10s" % ("benchmark", "threads", "efficiency"))
+
+    for group in sorted(groups):
+        runs = groups[group]
+
+        if 1 not in runs:
+            print("%-70s %8s %10s" % (group, "-", "no 1-thread run"))
+            continue
+
+        for threads in sorted(runs):
+            efficiency = runs[1] / (threads * runs[threads])
+            print("%-70s %8d %10.3f" % (group, threads, efficiency))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
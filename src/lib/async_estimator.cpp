@@ -0,0 +1,76 @@
+#include "async_estimator.h"
+#include <algorithm>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// Runs the chunks of [first, last) and hands the total to on_done on the thread of the last chunk
+void launch_chunks(WorkStealingPool &pool, long long chunk_size, long long first, long long last, const EstimateOptions &options,
+                   TaskPriority priority, std::function<void(long long)> on_done) {
+  auto hits = std::make_shared<std::atomic<long long>>(0);
+  const long long num_chunks = (last - first + chunk_size - 1) / chunk_size;
+  // Chunks are claimed on demand, so the queued tasks do not grow with the range
+  pool.submit_indexed(num_chunks, [hits, first, last, chunk_size, options](long long chunk) {
+    const long long chunk_first = first + chunk * chunk_size;
+    const long long chunk_last = std::min(chunk_first + chunk_size, last);
+    hits->fetch_add(count_points_inside(options.seed, chunk_first, chunk_last, options.arithmetic, options.simd_level),
+                    std::memory_order_relaxed);
+  }, [hits, on_done] {
+    on_done(hits->load());
+  }, priority);
+}
+
+} // namespace
+
+AsyncExecutor::AsyncExecutor(int num_threads, long long chunk_size)
+  : pool_(num_threads), chunk_size_(std::max(chunk_size, 1LL)) {
+}
+
+AsyncExecutor &AsyncExecutor::shared() {
+  static AsyncExecutor executor;
+  return executor;
+}
+
+int AsyncExecutor::num_threads() const {
+  return pool_.size();
+}
+
+WorkStealingPool &AsyncExecutor::pool() {
+  return pool_;
+}
+
+EstimateFuture<long long> AsyncExecutor::count_points_inside(long long first, long long last, const EstimateOptions &options,
+                                                             TaskPriority priority) {
+  auto state = std::make_shared<detail::FutureState<long long>>();
+
+  if (first < 0 || last <= first) {
+    state->set_value(0);
+  } else {
+    launch_chunks(pool_, chunk_size_, first, last, options, priority, [state](long long hits) {
+      state->set_value(hits);
+    });
+  }
+
+  return EstimateFuture<long long>(state, this);
+}
+
+EstimateFuture<double> AsyncExecutor::calculate_pi(long long num_points, const EstimateOptions &options, TaskPriority priority) {
+  auto state = std::make_shared<detail::FutureState<double>>();
+
+  if (num_points <= 0) {
+    state->set_value(0.0);
+  } else {
+    launch_chunks(pool_, chunk_size_, 0, num_points, options, priority, [state, num_points](long long hits) {
+      state->set_value(4.0 * hits / num_points);
+    });
+  }
+
+  return EstimateFuture<double>(state, this);
+}
+
+EstimateFuture<double> calculate_pi_async(long long num_points, const EstimateOptions &options, TaskPriority priority) {
+  return AsyncExecutor::shared().calculate_pi(num_points, options, priority);
+}
+
+} // namespace monte_carlo_pi
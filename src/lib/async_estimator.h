@@ -0,0 +1,414 @@
+#ifndef ASYNC_ESTIMATOR_H
+#define ASYNC_ESTIMATOR_H
+
+#include "monte_carlo_pi.h"
+#include "work_stealing_pool.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+class AsyncExecutor;
+
+namespace detail {
+
+/**
+ * @brief Shared state of an EstimateFuture: value or exception, plus the callbacks waiting for it
+ * @tparam T Value type
+ */
+template<typename T>
+class FutureState {
+ public:
+  /**
+   * @brief Stores the value and runs the callbacks
+   * @param value Result
+   */
+  void set_value(T value) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      value_.emplace(std::move(value));
+    }
+    complete();
+  }
+
+  /**
+   * @brief Stores an exception and runs the callbacks
+   * @param error Exception thrown by the producer
+   */
+  void set_exception(std::exception_ptr error) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = std::move(error);
+    }
+    complete();
+  }
+
+  /**
+   * @brief Runs a callback once the state is ready, immediately if it already is
+   * @param callback Callable run on the completing thread; it must be cheap
+   */
+  void on_ready(std::function<void()> callback) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (!ready_) {
+        callbacks_.push_back(std::move(callback));
+        return;
+      }
+    }
+    callback();
+  }
+
+  /**
+   * @brief Checks whether a value or exception is stored
+   * @return true once completed
+   */
+  bool is_ready() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_;
+  }
+
+  /**
+   * @brief Blocks until the state is ready
+   */
+  void wait() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_changed_.wait(lock, [this] {
+      return ready_;
+    });
+  }
+
+  /**
+   * @brief Returns the value of a ready state
+   * @return Stored value
+   * @throws The stored exception, if the producer failed
+   */
+  const T &value() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+
+    return *value_;
+  }
+
+ private:
+  void complete() {
+    std::vector<std::function<void()>> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready_ = true;
+      callbacks.swap(callbacks_);
+    }
+    ready_changed_.notify_all();
+
+    for (std::function<void()> &callback : callbacks) {
+      callback();
+    }
+  }
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable ready_changed_;
+  bool ready_ = false;
+  std::optional<T> value_;
+  std::exception_ptr error_;
+  std::vector<std::function<void()>> callbacks_;
+};
+
+/**
+ * @brief Runs a callable and stores its result or exception
+ * @param state State to complete
+ * @param f Callable
+ */
+template<typename T, typename F>
+void fulfil(FutureState<T> &state, F &&f) {
+  try {
+    state.set_value(f());
+  } catch (...) {
+    state.set_exception(std::current_exception());
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Handle to the result of asynchronous work on an AsyncExecutor
+ *
+ * Unlike std::future the handle is copyable, get may be called repeatedly,
+ * and continuations can be attached with then.
+ *
+ * @tparam T Value type
+ */
+template<typename T>
+class EstimateFuture {
+ public:
+  /**
+   * @brief Creates an empty handle
+   */
+  EstimateFuture() = default;
+
+  /**
+   * @brief Wraps a shared state
+   * @param state Shared state completed by the producer
+   * @param executor Executor that runs continuations and helps while waiting
+   */
+  EstimateFuture(std::shared_ptr<detail::FutureState<T>> state, AsyncExecutor *executor)
+    : state_(std::move(state)), executor_(executor) {
+  }
+
+  /**
+   * @brief Checks whether the handle refers to a shared state
+   * @return true unless default-constructed
+   */
+  bool valid() const {
+    return state_ != nullptr;
+  }
+
+  /**
+   * @brief Checks whether the result is available
+   * @return true once the value or exception is stored
+   */
+  bool is_ready() const {
+    return state_->is_ready();
+  }
+
+  /**
+   * @brief Waits for the result; on a worker of the executor, runs queued work meanwhile
+   */
+  void wait() const;
+
+  /**
+   * @brief Waits for the result and returns it
+   * @return Value
+   * @throws The exception of the producer or of a failed earlier continuation
+   */
+  T get() const {
+    wait();
+    return state_->value();
+  }
+
+  /**
+   * @brief Attaches a continuation that runs on the executor once the result is ready
+   *
+   * If this future holds an exception, f is not called and the returned
+   * future holds the same exception.
+   *
+   * @param f Copyable callable taking const T & and returning a non-void value
+   * @param priority Scheduling class of the continuation
+   * @return Future of f's result
+   */
+  template<typename F>
+  auto then(F f, TaskPriority priority = TaskPriority::Normal) const;
+
+  /**
+   * @brief Returns the executor of the future
+   * @return Executor
+   */
+  AsyncExecutor *executor() const {
+    return executor_;
+  }
+
+  /**
+   * @brief Runs a callback on the completing thread once the result is ready, whether value or exception
+   * @param callback Cheap callable; heavier work belongs in then
+   */
+  void on_ready(std::function<void()> callback) const {
+    state_->on_ready(std::move(callback));
+  }
+
+ private:
+  std::shared_ptr<detail::FutureState<T>> state_;
+  AsyncExecutor *executor_ = nullptr;
+};
+
+/**
+ * @brief Pool that runs asynchronous estimates and their continuations
+ *
+ * All work of an executor, whether estimate chunks, submitted callables or
+ * continuations, runs on one fixed set of workers. Any number of
+ * outstanding requests therefore never adds threads, and chunks of
+ * concurrent requests interleave. A request queues at most one task per
+ * worker, which claims its chunks on demand, so memory does not grow with
+ * the point count. Higher priority work is taken first.
+ * Results depend only on the seed and point count, as for
+ * calculate_pi_parallel.
+ */
+class AsyncExecutor {
+ public:
+  /**
+   * @brief Starts the workers
+   * @param num_threads Number of workers (0 for the hardware concurrency)
+   * @param chunk_size Points per task of an estimate
+   */
+  explicit AsyncExecutor(int num_threads = 0, long long chunk_size = kDefaultChunkSize);
+
+  AsyncExecutor(const AsyncExecutor &) = delete;
+  AsyncExecutor &operator=(const AsyncExecutor &) = delete;
+
+  /**
+   * @brief Returns the process-wide executor used by calculate_pi_async
+   * @return Executor with one worker per hardware thread, created on first use
+   */
+  static AsyncExecutor &shared();
+
+  /**
+   * @brief Returns the number of worker threads
+   * @return Worker count
+   */
+  int num_threads() const;
+
+  /**
+   * @brief Returns the underlying pool
+   * @return Work-stealing pool of the executor
+   */
+  WorkStealingPool &pool();
+
+  /**
+   * @brief Runs a callable on the executor
+   * @param f Copyable callable without arguments returning a non-void value
+   * @param priority Scheduling class
+   * @return Future of the callable's result
+   */
+  template<typename F>
+  auto submit(F f, TaskPriority priority = TaskPriority::Normal) {
+    using Result = std::invoke_result_t<F &>;
+    static_assert(!std::is_void<Result>::value, "submitted callables must return a value");
+    auto state = std::make_shared<detail::FutureState<Result>>();
+    pool_.submit([state, f]() mutable {
+      detail::fulfil(*state, f);
+    }, priority);
+    return EstimateFuture<Result>(state, this);
+  }
+
+  /**
+   * @brief Counts the points of a stream index range inside the circle, asynchronously
+   * @param first Index of the first point (inclusive)
+   * @param last Index one past the last point (exclusive)
+   * @param options Seed, arithmetic and kernel level; num_threads is ignored
+   * @param priority Scheduling class of all chunks
+   * @return Future of the hit count
+   */
+  EstimateFuture<long long> count_points_inside(long long first, long long last, const EstimateOptions &options,
+                                                TaskPriority priority = TaskPriority::Normal);
+
+  /**
+   * @brief Calculates Pi from the seeded stream, asynchronously
+   * @param num_points Number of points to generate
+   * @param options Seed, arithmetic and kernel level; num_threads is ignored
+   * @param priority Scheduling class of all chunks
+   * @return Future of the estimate
+   */
+  EstimateFuture<double> calculate_pi(long long num_points, const EstimateOptions &options,
+                                      TaskPriority priority = TaskPriority::Normal);
+
+  /// Default number of points per task
+  static constexpr long long kDefaultChunkSize = 1 << 18;
+
+ private:
+  WorkStealingPool pool_;
+  long long chunk_size_;
+};
+
+template<typename T>
+void EstimateFuture<T>::wait() const {
+  WorkStealingPool &pool = executor_->pool();
+
+  // A worker that blocked here could hold up the very work it waits for
+  if (pool.is_worker_thread()) {
+    while (!state_->is_ready()) {
+      if (!pool.try_run_one()) {
+        std::this_thread::yield();
+      }
+    }
+  } else {
+    state_->wait();
+  }
+}
+
+template<typename T>
+template<typename F>
+auto EstimateFuture<T>::then(F f, TaskPriority priority) const {
+  using Result = std::invoke_result_t<F &, const T &>;
+  static_assert(!std::is_void<Result>::value, "continuations must return a value");
+  auto next = std::make_shared<detail::FutureState<Result>>();
+  auto source = state_;
+  AsyncExecutor *executor = executor_;
+  state_->on_ready([executor, source, next, f, priority] {
+    executor->pool().submit([source, next, f]() mutable {
+      detail::fulfil(*next, [&source, &f] {
+        return f(source->value());
+      });
+    }, priority);
+  });
+  return EstimateFuture<Result>(next, executor);
+}
+
+/**
+ * @brief Calculates Pi on the shared executor
+ * @param num_points Number of points to generate
+ * @param options Seed, arithmetic and kernel level; num_threads is ignored
+ * @param priority Scheduling class
+ * @return Future of the estimate
+ */
+EstimateFuture<double> calculate_pi_async(long long num_points, const EstimateOptions &options = EstimateOptions(),
+                                          TaskPriority priority = TaskPriority::Normal);
+
+/**
+ * @brief Combines futures into one that is ready when all of them are
+ *
+ * Values keep the order of the input. If any input fails, the result holds
+ * the exception of the first failed input in input order.
+ *
+ * @param futures Futures of one executor
+ * @return Future of all values
+ */
+template<typename T>
+EstimateFuture<std::vector<T>> when_all(const std::vector<EstimateFuture<T>> &futures) {
+  AsyncExecutor *executor = futures.empty() ? &AsyncExecutor::shared() : futures.front().executor();
+  auto state = std::make_shared<detail::FutureState<std::vector<T>>>();
+
+  if (futures.empty()) {
+    state->set_value(std::vector<T>());
+    return EstimateFuture<std::vector<T>>(state, executor);
+  }
+
+  auto remaining = std::make_shared<std::atomic<std::size_t>>(futures.size());
+  const auto inputs = std::make_shared<std::vector<EstimateFuture<T>>>(futures);
+  const auto collect = [state, inputs] {
+    detail::fulfil(*state, [&inputs] {
+      std::vector<T> values;
+      values.reserve(inputs->size());
+
+      for (const EstimateFuture<T> &input : *inputs) {
+        values.push_back(input.get());
+      }
+
+      return values;
+    });
+  };
+
+  // The last input to complete gathers the values; every input is ready by then, so get never blocks
+  for (const EstimateFuture<T> &input : futures) {
+    input.on_ready([remaining, collect] {
+      if (remaining->fetch_sub(1) == 1) {
+        collect();
+      }
+    });
+  }
+
+  return EstimateFuture<std::vector<T>>(state, executor);
+}
+
+} // namespace monte_carlo_pi
+
+#endif // ASYNC_ESTIMATOR_H
@@ -0,0 +1,163 @@
+#include "cpu_topology.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#if defined(__linux__)
+  #include <sched.h>
+#endif
+
+namespace monte_carlo_pi {
+namespace detail {
+
+namespace {
+
+#if defined(__linux__)
+
+// Reads one integer from a sysfs topology file, or returns fallback
+int read_topology_value(int cpu, const char *name, int fallback) {
+  std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+  int value = fallback;
+
+  if (!(file >> value)) {
+    return fallback;
+  }
+
+  return value;
+}
+
+#endif
+
+} // namespace
+
+std::vector<LogicalCpu> detect_cpu_topology() {
+  std::vector<LogicalCpu> cpus;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return cpus;
+  }
+
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      LogicalCpu logical;
+      logical.cpu = cpu;
+      logical.socket = read_topology_value(cpu, "physical_package_id", 0);
+      logical.core = read_topology_value(cpu, "core_id", cpu);
+      cpus.push_back(logical);
+    }
+  }
+
+  // Siblings of a core are ranked by CPU number
+  std::map<std::pair<int, int>, int> siblings_seen;
+
+  for (LogicalCpu &logical : cpus) {
+    logical.smt = siblings_seen[std::make_pair(logical.socket, logical.core)]++;
+  }
+
+#endif
+  return cpus;
+}
+
+std::vector<LogicalCpu> placement_order(std::vector<LogicalCpu> cpus, ThreadPlacement placement) {
+  // Dense rank of each core within its socket, so sockets with sparse core ids interleave evenly
+  std::map<std::pair<int, int>, int> core_rank;
+
+  for (const LogicalCpu &logical : cpus) {
+    core_rank.emplace(std::make_pair(logical.socket, logical.core), 0);
+  }
+
+  int previous_socket = -1;
+  int rank = 0;
+
+  for (auto &entry : core_rank) {
+    rank = entry.first.first == previous_socket ? rank + 1 : 0;
+    previous_socket = entry.first.first;
+    entry.second = rank;
+  }
+
+  const auto rank_of = [&core_rank](const LogicalCpu & logical) {
+    return core_rank[std::make_pair(logical.socket, logical.core)];
+  };
+
+  switch (placement) {
+    case ThreadPlacement::Default:
+      return {};
+
+    case ThreadPlacement::Compact:
+      std::sort(cpus.begin(), cpus.end(), [&rank_of](const LogicalCpu & a, const LogicalCpu & b) {
+        return std::make_tuple(a.socket, rank_of(a), a.smt) < std::make_tuple(b.socket, rank_of(b), b.smt);
+      });
+      break;
+
+    case ThreadPlacement::Scatter:
+      std::sort(cpus.begin(), cpus.end(), [&rank_of](const LogicalCpu & a, const LogicalCpu & b) {
+        return std::make_tuple(a.smt, rank_of(a), a.socket) < std::make_tuple(b.smt, rank_of(b), b.socket);
+      });
+      break;
+
+    case ThreadPlacement::PhysicalCores:
+    case ThreadPlacement::NoSmt:
+      std::sort(cpus.begin(), cpus.end(), [&rank_of](const LogicalCpu & a, const LogicalCpu & b) {
+        return std::make_tuple(a.smt, a.socket, rank_of(a)) < std::make_tuple(b.smt, b.socket, rank_of(b));
+      });
+
+      if (placement == ThreadPlacement::NoSmt) {
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [](const LogicalCpu & logical) {
+          return logical.smt != 0;
+        }), cpus.end());
+      }
+
+      break;
+  }
+
+  return cpus;
+}
+
+ScopedCpuPin::ScopedCpuPin(int cpu) {
+#if defined(__linux__)
+  cpu_set_t saved;
+  CPU_ZERO(&saved);
+
+  if (cpu < 0 || cpu >= CPU_SETSIZE || sched_getaffinity(0, sizeof(saved), &saved) != 0) {
+    return;
+  }
+
+  cpu_set_t target;
+  CPU_ZERO(&target);
+  CPU_SET(cpu, &target);
+
+  if (sched_setaffinity(0, sizeof(target), &target) == 0) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&saved);
+    saved_mask_.assign(bytes, bytes + sizeof(saved));
+    pinned_ = true;
+  }
+
+#else
+  (void)cpu;
+#endif
+}
+
+ScopedCpuPin::~ScopedCpuPin() {
+#if defined(__linux__)
+
+  if (pinned_) {
+    cpu_set_t saved;
+    std::copy(saved_mask_.begin(), saved_mask_.end(), reinterpret_cast<unsigned char *>(&saved));
+    sched_setaffinity(0, sizeof(saved), &saved);
+  }
+
+#endif
+}
+
+bool ScopedCpuPin::pinned() const {
+  return pinned_;
+}
+
+} // namespace detail
+} // namespace monte_carlo_pi
@@ -0,0 +1,74 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include "monte_carlo_pi.h"
+#include <vector>
+
+namespace monte_carlo_pi {
+namespace detail {
+
+/**
+ * @brief Position of one logical CPU in the machine
+ */
+struct LogicalCpu {
+  int cpu = 0;     ///< Operating system CPU number
+  int socket = 0;  ///< Physical package
+  int core = 0;    ///< Core number, unique within the socket
+  int smt = 0;     ///< Rank among the SMT siblings of the core (0 for the first)
+};
+
+/**
+ * @brief Reads the topology of the CPUs the process may run on
+ * @return Allowed logical CPUs ordered by CPU number, empty if unavailable
+ */
+std::vector<LogicalCpu> detect_cpu_topology();
+
+/**
+ * @brief Orders the CPUs in which a placement policy fills them
+ *
+ * Thread t of a team runs on element t modulo the size of the result.
+ * NoSmt leaves out every CPU that is not the first sibling of its core.
+ *
+ * @param cpus Logical CPUs, as returned by detect_cpu_topology
+ * @param placement Placement policy
+ * @return CPUs in fill order, empty for ThreadPlacement::Default
+ */
+std::vector<LogicalCpu> placement_order(std::vector<LogicalCpu> cpus, ThreadPlacement placement);
+
+/**
+ * @brief Saved CPU mask of the calling thread
+ *
+ * Pins the calling thread to one CPU for its lifetime and restores the
+ * previous mask on destruction, so pooled OpenMP threads are left as found.
+ */
+class ScopedCpuPin {
+ public:
+  /**
+   * @brief Pins the calling thread
+   * @param cpu Operating system CPU number
+   */
+  explicit ScopedCpuPin(int cpu);
+
+  /**
+   * @brief Restores the previous CPU mask
+   */
+  ~ScopedCpuPin();
+
+  ScopedCpuPin(const ScopedCpuPin &) = delete;
+  ScopedCpuPin &operator=(const ScopedCpuPin &) = delete;
+
+  /**
+   * @brief Checks whether the thread was pinned
+   * @return true if the affinity call succeeded
+   */
+  bool pinned() const;
+
+ private:
+  std::vector<unsigned char> saved_mask_;
+  bool pinned_ = false;
+};
+
+} // namespace detail
+} // namespace monte_carlo_pi
+
+#endif // CPU_TOPOLOGY_H
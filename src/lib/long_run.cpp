@@ -0,0 +1,293 @@
+#include "long_run.h"
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <unistd.h>
+#endif
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// Points handed to the kernel per parallel work item
+constexpr long long kBlockSize = 1 << 14;
+
+// File layout, all fields little-endian 64-bit words:
+// magic, version, seed, num_points, arithmetic, shard count,
+// per shard begin, end, next, points (low, high), hits (low, high),
+// and an FNV-1a checksum of all preceding bytes
+constexpr std::uint64_t kCheckpointMagic = 0x54504B4349504D43ull;  // "CMPICKPT"
+constexpr std::uint64_t kCheckpointVersion = 1;
+constexpr std::size_t kHeaderWords = 6;
+constexpr std::size_t kShardWords = 7;
+
+// Identity of a run; a checkpoint is only resumed by the same run
+struct RunIdentity {
+  std::uint64_t seed;
+  std::uint64_t num_points;
+  std::uint64_t arithmetic;
+  std::uint64_t shards;
+};
+
+void append_word(std::vector<unsigned char> *bytes, std::uint64_t word) {
+  for (int byte = 0; byte < 8; ++byte) {
+    bytes->push_back(static_cast<unsigned char>(word >> (8 * byte)));
+  }
+}
+
+std::uint64_t read_word(const std::vector<unsigned char> &bytes, std::size_t index) {
+  std::uint64_t word = 0;
+
+  for (int byte = 0; byte < 8; ++byte) {
+    word |= static_cast<std::uint64_t>(bytes[8 * index + byte]) << (8 * byte);
+  }
+
+  return word;
+}
+
+std::uint64_t fnv1a(const unsigned char *data, std::size_t size) {
+  std::uint64_t hash = 0xCBF29CE484222325ull;
+
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 0x100000001B3ull;
+  }
+
+  return hash;
+}
+
+// Writes the checkpoint next to its destination and renames it into place
+void write_checkpoint(const std::string &path, const RunIdentity &run, const std::vector<ShardState> &shards) {
+  std::vector<unsigned char> bytes;
+  bytes.reserve(8 * (kHeaderWords + kShardWords * shards.size() + 1));
+  append_word(&bytes, kCheckpointMagic);
+  append_word(&bytes, kCheckpointVersion);
+  append_word(&bytes, run.seed);
+  append_word(&bytes, run.num_points);
+  append_word(&bytes, run.arithmetic);
+  append_word(&bytes, run.shards);
+
+  for (const ShardState &shard : shards) {
+    append_word(&bytes, shard.begin);
+    append_word(&bytes, shard.end);
+    append_word(&bytes, shard.next);
+    append_word(&bytes, shard.points.low);
+    append_word(&bytes, shard.points.high);
+    append_word(&bytes, shard.hits.low);
+    append_word(&bytes, shard.hits.high);
+  }
+
+  append_word(&bytes, fnv1a(bytes.data(), bytes.size()));
+  const std::string temporary = path + ".tmp";
+  std::FILE *file = std::fopen(temporary.c_str(), "wb");
+
+  if (file == nullptr) {
+    throw std::runtime_error("Cannot create checkpoint file: " + temporary);
+  }
+
+  bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && std::fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+  written = written && fsync(fileno(file)) == 0;
+#endif
+  written = std::fclose(file) == 0 && written;
+#if defined(_WIN32)
+  // rename does not replace an existing file on Windows
+  std::remove(path.c_str());
+#endif
+
+  if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error("Cannot write checkpoint file: " + path);
+  }
+}
+
+// Loads a checkpoint; returns false if the file does not exist
+bool read_checkpoint(const std::string &path, const RunIdentity &run, std::vector<ShardState> *shards) {
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+
+  if (file == nullptr) {
+    return false;
+  }
+
+  std::vector<unsigned char> bytes;
+  unsigned char buffer[4096];
+  std::size_t n = 0;
+
+  while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    bytes.insert(bytes.end(), buffer, buffer + n);
+  }
+
+  std::fclose(file);
+
+  if (bytes.size() < 8 * (kHeaderWords + 1) || bytes.size() % 8 != 0
+      || read_word(bytes, bytes.size() / 8 - 1) != fnv1a(bytes.data(), bytes.size() - 8)
+      || read_word(bytes, 0) != kCheckpointMagic || read_word(bytes, 1) != kCheckpointVersion) {
+    throw std::runtime_error("Checkpoint file is corrupt: " + path);
+  }
+
+  if (read_word(bytes, 2) != run.seed || read_word(bytes, 3) != run.num_points || read_word(bytes, 4) != run.arithmetic
+      || read_word(bytes, 5) != run.shards || bytes.size() != 8 * (kHeaderWords + kShardWords * run.shards + 1)) {
+    throw std::invalid_argument("Checkpoint belongs to a different run: " + path);
+  }
+
+  for (std::size_t i = 0; i < shards->size(); ++i) {
+    const std::size_t word = kHeaderWords + kShardWords * i;
+    ShardState &shard = (*shards)[i];
+
+    if (read_word(bytes, word) != shard.begin || read_word(bytes, word + 1) != shard.end) {
+      throw std::invalid_argument("Checkpoint belongs to a different run: " + path);
+    }
+
+    shard.next = read_word(bytes, word + 2);
+    shard.points.low = read_word(bytes, word + 3);
+    shard.points.high = read_word(bytes, word + 4);
+    shard.hits.low = read_word(bytes, word + 5);
+    shard.hits.high = read_word(bytes, word + 6);
+
+    if (shard.next < shard.begin || shard.next > shard.end) {
+      throw std::runtime_error("Checkpoint file is corrupt: " + path);
+    }
+  }
+
+  return true;
+}
+
+void sum_shards(LongRunResult *result) {
+  result->points = UInt128();
+  result->hits = UInt128();
+
+  for (const ShardState &shard : result->shards) {
+    result->points.add(shard.points);
+    result->hits.add(shard.hits);
+  }
+
+  const double points = result->points.to_double();
+  result->estimate = points > 0.0 ? 4.0 * result->hits.to_double() / points : 0.0;
+}
+
+} // namespace
+
+LongRunResult calculate_pi_long_run(long long num_points, const LongRunOptions &options) {
+  using clock = std::chrono::steady_clock;
+  const clock::time_point start = clock::now();
+  LongRunResult result;
+
+  if (options.shards <= 0 || options.round_points <= 0 || options.checkpoint_interval_seconds < 0.0) {
+    throw std::invalid_argument("Shard count, round size and checkpoint interval must be positive.");
+  }
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  // Shard k starts at floor-divided offsets, spreading the remainder over the first shards
+  const std::uint64_t total = static_cast<std::uint64_t>(num_points);
+  const std::uint64_t shard_count = static_cast<std::uint64_t>(options.shards);
+  const std::uint64_t base = total / shard_count;
+  const std::uint64_t remainder = total % shard_count;
+  result.shards.resize(options.shards);
+
+  for (std::uint64_t k = 0; k < shard_count; ++k) {
+    ShardState &shard = result.shards[k];
+    shard.begin = base * k + std::min(k, remainder);
+    shard.end = shard.begin + base + (k < remainder ? 1 : 0);
+    shard.next = shard.begin;
+  }
+
+  const RunIdentity run = {options.estimate.seed, total, static_cast<std::uint64_t>(options.estimate.arithmetic), shard_count};
+  const bool checkpointing = !options.checkpoint_path.empty();
+
+  if (checkpointing) {
+    result.resumed = read_checkpoint(options.checkpoint_path, run, &result.shards);
+  }
+
+  const int threads = options.estimate.num_threads > 0 ? options.estimate.num_threads : omp_get_max_threads();
+  const std::uint64_t step = std::max<std::uint64_t>(static_cast<std::uint64_t>(options.round_points) / shard_count, 1);
+  const std::uint64_t seed = options.estimate.seed;
+  const Arithmetic arithmetic = options.estimate.arithmetic;
+  const SimdLevel level = options.estimate.simd_level;
+  clock::time_point last_checkpoint = clock::now();
+
+  // One work item per block of a shard's step in the current round
+  struct Chunk {
+    std::size_t shard;
+    long long first;
+    long long last;
+  };
+
+  std::vector<Chunk> chunks;
+  std::vector<long long> round_hits(result.shards.size());
+
+  for (;;) {
+    if (options.cancellation != nullptr && options.cancellation->is_cancelled()) {
+      result.cancelled = true;
+      break;
+    }
+
+    chunks.clear();
+
+    for (std::size_t k = 0; k < result.shards.size(); ++k) {
+      const ShardState &shard = result.shards[k];
+      const std::uint64_t round_end = shard.next + std::min(step, shard.end - shard.next);
+
+      for (std::uint64_t first = shard.next; first < round_end; first += kBlockSize) {
+        chunks.push_back({k, static_cast<long long>(first), static_cast<long long>(std::min<std::uint64_t>(first + kBlockSize, round_end))});
+      }
+    }
+
+    if (chunks.empty()) {
+      break;
+    }
+
+    std::fill(round_hits.begin(), round_hits.end(), 0);
+    const long long num_chunks = static_cast<long long>(chunks.size());
+    #pragma omp parallel for schedule(dynamic, 4) num_threads(threads)
+
+    for (long long i = 0; i < num_chunks; ++i) {
+      const Chunk &chunk = chunks[i];
+      const long long chunk_hits = count_points_inside(seed, chunk.first, chunk.last, arithmetic, level);
+      #pragma omp atomic
+      round_hits[chunk.shard] += chunk_hits;
+    }
+
+    for (std::size_t k = 0; k < result.shards.size(); ++k) {
+      ShardState &shard = result.shards[k];
+      const std::uint64_t sampled = std::min(step, shard.end - shard.next);
+      shard.next += sampled;
+      shard.points.add(sampled);
+      shard.hits.add(static_cast<std::uint64_t>(round_hits[k]));
+    }
+
+    const double since_checkpoint = std::chrono::duration<double>(clock::now() - last_checkpoint).count();
+
+    if (checkpointing && since_checkpoint >= options.checkpoint_interval_seconds) {
+      write_checkpoint(options.checkpoint_path, run, result.shards);
+      ++result.checkpoints_written;
+      last_checkpoint = clock::now();
+
+      if (options.on_checkpoint) {
+        sum_shards(&result);
+        Progress progress;
+        progress.points_done = static_cast<long long>(result.points.low);
+        progress.points_total = num_points;
+        progress.hits = static_cast<long long>(result.hits.low);
+        progress.estimate = result.estimate;
+        options.on_checkpoint(progress);
+      }
+    }
+  }
+
+  if (checkpointing) {
+    write_checkpoint(options.checkpoint_path, run, result.shards);
+    ++result.checkpoints_written;
+  }
+
+  sum_shards(&result);
+  result.elapsed_seconds = std::chrono::duration<double>(clock::now() - start).count();
+  return result;
+}
+
+} // namespace monte_carlo_pi
@@ -0,0 +1,124 @@
+#ifndef LONG_RUN_H
+#define LONG_RUN_H
+
+#include "monte_carlo_pi.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Portable unsigned 128-bit counter
+ *
+ * Used for the hit and point totals of long runs and their checkpoints.
+ * One run cannot reach 2^63 points, as num_points is a long long and every
+ * stream index is sampled at most once across shards and restarts. The
+ * 128-bit fields keep the checkpoint layout fixed should the stream index
+ * ever widen, and let callers add the totals of many independent runs
+ * (for example one per seed) without an overflow check.
+ */
+struct UInt128 {
+  std::uint64_t low = 0;   ///< Low 64 bits
+  std::uint64_t high = 0;  ///< High 64 bits
+
+  /**
+   * @brief Adds a 64-bit value with carry
+   * @param value Value to add
+   */
+  void add(std::uint64_t value) {
+    low += value;
+    high += low < value ? 1 : 0;
+  }
+
+  /**
+   * @brief Adds another 128-bit value with carry
+   * @param other Value to add
+   */
+  void add(const UInt128 &other) {
+    add(other.low);
+    high += other.high;
+  }
+
+  /**
+   * @brief Converts to the nearest double
+   * @return Value as double
+   */
+  double to_double() const {
+    return static_cast<double>(high) * 18446744073709551616.0 + static_cast<double>(low);
+  }
+
+  bool operator==(const UInt128 &other) const {
+    return low == other.low && high == other.high;
+  }
+
+  bool operator!=(const UInt128 &other) const {
+    return !(*this == other);
+  }
+};
+
+/**
+ * @brief Progress of one shard of a long run
+ */
+struct ShardState {
+  std::uint64_t begin = 0;  ///< Index of the first point of the shard
+  std::uint64_t end = 0;    ///< Index one past the last point of the shard
+  std::uint64_t next = 0;   ///< Stream counter of the next point to sample
+  UInt128 points;           ///< Points sampled so far
+  UInt128 hits;             ///< Points inside the circle so far
+};
+
+/**
+ * @brief Settings of a checkpointed long run
+ */
+struct LongRunOptions {
+  EstimateOptions estimate;                         ///< Thread count, seed, arithmetic and kernel level
+  std::string checkpoint_path;                      ///< Checkpoint file, empty to disable checkpointing
+  double checkpoint_interval_seconds = 60.0;        ///< Minimum time between two checkpoints
+  int shards = 64;                                  ///< Shards the stream is cut into (fixed by the first run)
+  long long round_points = 1LL << 28;               ///< Points sampled across all shards between two checks
+  ProgressCallback on_checkpoint;                   ///< Called after every checkpoint, may be empty
+  const CancellationToken *cancellation = nullptr;  ///< Stops the run at the next round, may be nullptr
+};
+
+/**
+ * @brief Outcome of a checkpointed long run
+ */
+struct LongRunResult {
+  double estimate = 0.0;           ///< Estimated value of Pi over the sampled points
+  UInt128 points;                  ///< Points sampled, including those of earlier sessions
+  UInt128 hits;                    ///< Points inside the circle, including earlier sessions
+  std::vector<ShardState> shards;  ///< Per-shard counters
+  bool resumed = false;            ///< true if the run continued from a checkpoint
+  bool cancelled = false;          ///< true if the run stopped before sampling all points
+  int checkpoints_written = 0;     ///< Checkpoints written in this session
+  double elapsed_seconds = 0.0;    ///< Wall-clock time of this session
+};
+
+/**
+ * @brief Calculates Pi over a very long seeded stream with periodic checkpoints
+ *
+ * The stream is cut into equal shards. Every round advances each unfinished
+ * shard by its share of round_points in one parallel dispatch, and a
+ * checkpoint is written after a round once checkpoint_interval_seconds have
+ * passed. A checkpoint holds the seed, the stream counter of every shard and
+ * its 128-bit point and hit totals. It is written to a temporary file and
+ * renamed over the previous one, so a crash leaves either the old or the new
+ * checkpoint. If checkpoint_path already holds a checkpoint of the same run,
+ * sampling continues from it, and the final estimate equals that of an
+ * uninterrupted run. The last checkpoint is written when the run finishes or
+ * is cancelled. A checkpoint is 56 bytes per shard plus a header, so even a
+ * one-second interval costs far less than 1% of the sampling time; the round
+ * size bounds how long cancellation and checkpoints may be delayed.
+ *
+ * @param num_points Number of points to generate
+ * @param options Stream settings, checkpoint file and interval
+ * @return Totals of the run so far
+ * @throws std::invalid_argument if the checkpoint belongs to a different run or the options are out of range
+ * @throws std::runtime_error if a checkpoint cannot be read or written
+ */
+LongRunResult calculate_pi_long_run(long long num_points, const LongRunOptions &options);
+
+} // namespace monte_carlo_pi
+
+#endif // LONG_RUN_H
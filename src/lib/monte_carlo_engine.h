@@ -0,0 +1,388 @@
+#ifndef MONTE_CARLO_ENGINE_H
+#define MONTE_CARLO_ENGINE_H
+
+#include "monte_carlo_pi.h"
+#include "monte_carlo_pi_kernels.h"
+#include "philox.h"
+#include "trace.h"
+#include "mathUtility.h"
+#include <omp.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Hooks run on every thread around its share of the blocks
+ *
+ * Lets a caller, such as the hardware-counter profiler, measure exactly the
+ * engine's own block loop. Both calls are made on the sampling thread.
+ */
+class ThreadObserver {
+ public:
+  virtual ~ThreadObserver() = default;
+
+  /**
+   * @brief Called before the thread's first block
+   * @param thread OpenMP thread number
+   */
+  virtual void thread_begin(int thread) = 0;
+
+  /**
+   * @brief Called after the thread's last block
+   * @param thread OpenMP thread number
+   * @param points Points the thread sampled
+   */
+  virtual void thread_end(int thread, long long points) = 0;
+};
+
+/**
+ * @brief Parallel settings of the Monte Carlo engine
+ */
+struct EngineOptions {
+  int num_threads = 0;                  ///< OpenMP threads (0 for omp_get_max_threads)
+  long long block_size = 1 << 14;       ///< Points per work item of the static schedule
+  ThreadObserver *observer = nullptr;   ///< Per-thread hooks, may be nullptr
+};
+
+/**
+ * @brief Point source drawing from the Philox4x32-10 stream
+ *
+ * Point i fills two coordinates from each counter {i, j}, j = 0, 1, ..., so
+ * any point can be generated from its index alone. For two dimensions this
+ * is exactly the stream of calculate_pi_sequential.
+ */
+class PhiloxPoints {
+ public:
+  /**
+   * @brief Creates the point source of a seed
+   * @param seed Seed of the counter-based stream
+   */
+  explicit PhiloxPoints(std::uint64_t seed) : seed_(seed), philox_(seed) {
+  }
+
+  /**
+   * @brief Returns the seed of the stream
+   * @return Seed
+   */
+  std::uint64_t seed() const {
+    return seed_;
+  }
+
+  /**
+   * @brief Generates point i of the stream in the unit hypercube
+   * @tparam Dimension Number of coordinates
+   * @param index Stream index of the point
+   * @return Coordinates in [0, 1)
+   */
+  template<int Dimension>
+  std::array<double, Dimension> point(std::uint64_t index) const {
+    std::array<double, Dimension> x;
+    fill_pairs(index, x, std::make_index_sequence<(Dimension + 1) / 2>());
+    return x;
+  }
+
+ private:
+  template<std::size_t Dimension, std::size_t... Pair>
+  void fill_pairs(std::uint64_t index, std::array<double, Dimension> &x, std::index_sequence<Pair...>) const {
+    (fill_pair<Pair>(index, x), ...);
+  }
+
+  template<std::size_t Pair, std::size_t Dimension>
+  void fill_pair(std::uint64_t index, std::array<double, Dimension> &x) const {
+    const Philox4x32::Counter bits = philox_({static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32),
+                                              static_cast<std::uint32_t>(Pair), 0
+                                             });
+    x[2 * Pair] = detail::to_unit_double((static_cast<std::uint64_t>(bits[1]) << 32) | bits[0]);
+
+    if constexpr (2 * Pair + 1 < Dimension) {
+      x[2 * Pair + 1] = detail::to_unit_double((static_cast<std::uint64_t>(bits[3]) << 32) | bits[2]);
+    }
+  }
+
+  std::uint64_t seed_;
+  Philox4x32 philox_;
+};
+
+/**
+ * @brief Reduction type accumulating the mean and variance of an integrand
+ *
+ * Values are added with Welford's update and partial sums merged with the
+ * formula of Chan et al. (Can::Utility::RunningMoments), so an integrand
+ * with a large mean and a small spread keeps its variance instead of
+ * cancelling to zero.
+ */
+struct Moments : Can::Utility::RunningMoments {
+  /**
+   * @brief Adds one integrand value
+   * @param value Integrand value
+   * @return This accumulator
+   */
+  Moments &operator+=(double value) {
+    add(value);
+    return *this;
+  }
+
+  /**
+   * @brief Merges a partial accumulator
+   * @param other Moments of another range
+   * @return This accumulator
+   */
+  Moments &operator+=(const Moments &other) {
+    merge(other);
+    return *this;
+  }
+};
+
+/**
+ * @brief Indicator of the unit ball, restricted to the positive orthant [0, 1)^Dimension
+ * @tparam Dimension Number of coordinates
+ */
+template<int Dimension>
+struct UnitBallIndicator {
+  /**
+   * @brief Tests whether a point lies inside the unit ball
+   * @param x Point in the unit hypercube
+   * @return true if |x| <= 1
+   */
+  bool operator()(const std::array<double, Dimension> &x) const {
+    return squared_norm(x, std::make_index_sequence<Dimension>()) <= 1.0;
+  }
+
+ private:
+  template<std::size_t... I>
+  static double squared_norm(const std::array<double, Dimension> &x, std::index_sequence<I...>) {
+    // Left fold, evaluated in the same order as x * x + y * y of the kernels
+    return (0.0 + ... + (x[I] * x[I]));
+  }
+};
+
+/**
+ * @brief The quarter-circle test of the Pi estimator
+ *
+ * The per-point operator is the generic (and reference) form; the engine
+ * counts blocks of this integrand with the vectorised Philox kernels of
+ * count_points_inside instead, in the selected arithmetic.
+ */
+struct QuarterCircle : UnitBallIndicator<2> {
+  Arithmetic arithmetic = Arithmetic::Double;  ///< Arithmetic of the block kernels
+  SimdLevel simd_level = SimdLevel::AVX512;    ///< Highest kernel level (clamped to the host)
+};
+
+/**
+ * @brief Evaluates an integrand over a contiguous range of the point stream
+ *
+ * This is the customisation point of the engine: the primary template
+ * inlines the integrand into a per-point loop, and a specialisation can
+ * replace the loop for one combination, as the Pi estimator does with its
+ * SIMD kernels.
+ *
+ * @tparam Dimension Number of coordinates
+ * @tparam Sum Reduction type; needs value initialisation and += of the integrand's result
+ * @tparam Integrand Functor taking const std::array<double, Dimension> &
+ * @tparam Points Point source with a point<Dimension>(index) member
+ */
+template<int Dimension, typename Sum, typename Integrand, typename Points>
+struct BlockKernel {
+  /**
+   * @brief Sums the integrand over points [first, last)
+   * @param f Integrand
+   * @param points Point source
+   * @param first First index (inclusive)
+   * @param last Last index (exclusive)
+   * @return Sum of the integrand
+   */
+  static Sum run(const Integrand &f, const Points &points, long long first, long long last) {
+    Sum sum{};
+
+    for (long long i = first; i < last; ++i) {
+      sum += f(points.template point<Dimension>(static_cast<std::uint64_t>(i)));
+    }
+
+    return sum;
+  }
+};
+
+/**
+ * @brief Counts the quarter-circle hits with the dispatched Philox kernels
+ */
+template<>
+struct BlockKernel<2, long long, QuarterCircle, PhiloxPoints> {
+  static long long run(const QuarterCircle &f, const PhiloxPoints &points, long long first, long long last) {
+    return count_points_inside(points.seed(), first, last, f.arithmetic, f.simd_level);
+  }
+};
+
+/**
+ * @brief Sums an integrand over points [first, last) of a stream, in parallel
+ *
+ * Threads take contiguous blocks of the range with a static schedule and
+ * reduce into a private Sum; the partial sums are combined in thread order
+ * after the parallel region. Integer sums are therefore independent of the
+ * thread count, floating-point sums reproducible for a fixed thread count.
+ * With one thread no parallel region is opened.
+ *
+ * @tparam Dimension Number of coordinates
+ * @tparam Sum Reduction type
+ * @param f Integrand
+ * @param points Point source
+ * @param first First index (inclusive)
+ * @param last Last index (exclusive)
+ * @param options Thread count and block size
+ * @return Sum of the integrand
+ */
+template<int Dimension, typename Sum, typename Integrand, typename Points>
+Sum sample_sum(const Integrand &f, const Points &points, long long first, long long last,
+               const EngineOptions &options = EngineOptions()) {
+  using Kernel = BlockKernel<Dimension, Sum, Integrand, Points>;
+  Sum sum{};
+
+  if (first < 0 || last <= first) {
+    return sum;
+  }
+
+  const long long block_size = std::max(options.block_size, 1LL);
+  const long long num_blocks = (last - first + block_size - 1) / block_size;
+  const int threads = options.num_threads > 0 ? options.num_threads : omp_get_max_threads();
+  const TraceScope region("parallel_region", num_blocks);
+
+  ThreadObserver *const observer = options.observer;
+
+  if (threads == 1) {
+    if (observer != nullptr) {
+      observer->thread_begin(0);
+    }
+
+    for (long long block = 0; block < num_blocks; ++block) {
+      const TraceScope span("block", block);
+      const long long block_first = first + block * block_size;
+      sum += Kernel::run(f, points, block_first, std::min(block_first + block_size, last));
+    }
+
+    if (observer != nullptr) {
+      observer->thread_end(0, last - first);
+    }
+
+    return sum;
+  }
+
+  std::vector<Sum> partial(threads, Sum{});
+  const std::int64_t fork_ns = trace_now();
+  #pragma omp parallel num_threads(threads)
+  {
+    const int t = omp_get_thread_num();
+    trace_since("thread_start", fork_ns, t);
+    Sum local{};
+    long long local_points = 0;
+
+    if (observer != nullptr) {
+      observer->thread_begin(t);
+    }
+
+    #pragma omp for schedule(static) nowait
+
+    for (long long block = 0; block < num_blocks; ++block) {
+      const TraceScope span("block", block);
+      const long long block_first = first + block * block_size;
+      const long long block_last = std::min(block_first + block_size, last);
+      local += Kernel::run(f, points, block_first, block_last);
+      local_points += block_last - block_first;
+    }
+
+    if (observer != nullptr) {
+      observer->thread_end(t, local_points);
+    }
+
+    const TraceScope reduction("reduction");
+    partial[t] = local;
+  }
+
+  for (const Sum &value : partial) {
+    sum += value;
+  }
+
+  return sum;
+}
+
+/**
+ * @brief Result of a Monte Carlo integration over the unit hypercube
+ */
+struct IntegrationResult {
+  double value = 0.0;      ///< Estimated integral
+  double std_error = 0.0;  ///< Standard error of the estimate
+  long long points = 0;    ///< Points sampled
+};
+
+/**
+ * @brief Integrates a function over [0, 1)^Dimension
+ *
+ * Other domains are integrated by mapping the unit hypercube inside the
+ * integrand and multiplying by the Jacobian there.
+ *
+ * @tparam Dimension Number of coordinates
+ * @param f Integrand returning a value convertible to double
+ * @param num_points Number of points to sample
+ * @param seed Seed of the Philox stream
+ * @param options Thread count and block size
+ * @return Mean of the integrand and its standard error
+ */
+template<int Dimension, typename Integrand>
+IntegrationResult integrate(const Integrand &f, long long num_points, std::uint64_t seed,
+                            const EngineOptions &options = EngineOptions()) {
+  IntegrationResult result;
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  const Moments moments = sample_sum<Dimension, Moments>(f, PhiloxPoints(seed), 0, num_points, options);
+  result.value = moments.mean();
+  result.std_error = std::sqrt(moments.variance() / static_cast<double>(num_points));
+  result.points = num_points;
+  return result;
+}
+
+/**
+ * @brief Estimates the volume of the unit ball in Dimension dimensions
+ * @tparam Dimension Number of coordinates
+ * @param num_points Number of points to sample
+ * @param seed Seed of the Philox stream
+ * @param options Thread count and block size
+ * @return Volume estimate, 2^Dimension times the hit fraction of the positive orthant
+ */
+template<int Dimension>
+double hypersphere_volume(long long num_points, std::uint64_t seed, const EngineOptions &options = EngineOptions()) {
+  if (num_points <= 0) {
+    return 0.0;
+  }
+
+  const long long hits = sample_sum<Dimension, long long>(UnitBallIndicator<Dimension>(), PhiloxPoints(seed), 0, num_points, options);
+  return std::ldexp(static_cast<double>(hits) / static_cast<double>(num_points), Dimension);
+}
+
+namespace detail {
+
+/**
+ * @brief Counts the quarter-circle hits of [first, last) on the path of calculate_pi_parallel
+ *
+ * Takes the placed per-socket reduction for a placement policy and the
+ * engine's block loop otherwise, calling the observer on every thread.
+ *
+ * @param first Index of the first point (inclusive)
+ * @param last Index one past the last point (exclusive)
+ * @param options Thread count, placement, seed, arithmetic and kernel level
+ * @param observer Per-thread hooks, may be nullptr
+ * @return Number of points in [first, last) inside the circle
+ */
+long long count_range_parallel(long long first, long long last, const EstimateOptions &options, ThreadObserver *observer);
+
+} // namespace detail
+
+} // namespace monte_carlo_pi
+
+#endif // MONTE_CARLO_ENGINE_H
@@ -1,43 +1,356 @@
 #include "monte_carlo_pi.h"
+#include "monte_carlo_pi_kernels.h"
+#include "monte_carlo_engine.h"
+#include "cpu_topology.h"
+#include "trace.h"
 #include <omp.h>
 #include <random>
 #include <chrono>
 #include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 
 namespace monte_carlo_pi {
 
-std::pair<long long, long long> generate_points(long long num_points) {
-  // Handle edge cases
-  if (num_points <= 0) {
-    return {0, 0};
-  }
+namespace {
+
+// Points handed to the kernel per parallel work item
+constexpr long long kBlockSize = 1 << 14;
 
-  // Use current time as seed for random number generator
-  auto seed_value = std::chrono::system_clock::now().time_since_epoch().count();
-  std::mt19937 generator(static_cast<std::mt19937::result_type>(seed_value));
-  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+// First batch of an adaptive estimate
+constexpr long long kMinBatch = 1 << 16;
+
+// Fresh seed for the unseeded overloads
+std::uint64_t random_seed() {
+  std::random_device device;
+  std::uint64_t seed = (static_cast<std::uint64_t>(device()) << 32) | device();
+  return seed ^ static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+}
+
+// Fixed-point points 2c and 2c + 1 share counter c; odd range ends take one half of a counter
+long long count_fixed_point(std::uint64_t seed, std::uint64_t first, std::uint64_t last, SimdLevel level) {
+  const Philox4x32 philox(seed);
   long long points_inside = 0;
-  long long total_points = num_points;
 
-  for (long long i = 0; i < num_points; ++i) {
-    double x = distribution(generator);
-    double y = distribution(generator);
+  if (first % 2 == 1) {
+    const Philox4x32::Counter bits = philox(first / 2);
+    points_inside += detail::fixed_point_inside(bits[2], bits[3]);
+    ++first;
+  }
+
+  if (last % 2 == 1 && first < last) {
+    const Philox4x32::Counter bits = philox(last / 2);
+    points_inside += detail::fixed_point_inside(bits[0], bits[1]);
+    --last;
+  }
+
+  const std::uint64_t first_counter = first / 2;
+  const std::uint64_t last_counter = last / 2;
+
+  switch (level) {
+    case SimdLevel::AVX512:
+      return points_inside + detail::count_inside_fixed_avx512(seed, first_counter, last_counter);
+
+    case SimdLevel::AVX2:
+      return points_inside + detail::count_inside_fixed_avx2(seed, first_counter, last_counter);
+
+    case SimdLevel::SSE42:
+      return points_inside + detail::count_inside_fixed_sse42(seed, first_counter, last_counter);
+
+    case SimdLevel::Scalar:
+      break;
+  }
+
+  return points_inside + detail::count_inside_fixed_scalar(seed, first_counter, last_counter);
+}
+
+// Pi estimator instance of the generic engine
+QuarterCircle quarter_circle(const EstimateOptions &options) {
+  QuarterCircle f;
+  f.arithmetic = options.arithmetic;
+  f.simd_level = options.simd_level;
+  return f;
+}
+
+EngineOptions engine_options(const EstimateOptions &options, ThreadObserver *observer = nullptr) {
+  EngineOptions engine;
+  engine.num_threads = options.num_threads;
+  engine.block_size = kBlockSize;
+  engine.observer = observer;
+  return engine;
+}
+
+// CPUs in the fill order of the placement, empty for Default or an unreadable topology
+std::vector<detail::LogicalCpu> placement_cpus(ThreadPlacement placement) {
+  if (placement == ThreadPlacement::Default) {
+    return {};
+  }
+
+  static const std::vector<detail::LogicalCpu> topology = detail::detect_cpu_topology();
+  return detail::placement_order(topology, placement);
+}
+
+// Team size of a placed run: one thread per CPU by default, at most one per core for NoSmt
+int placed_thread_count(const EstimateOptions &options, const std::vector<detail::LogicalCpu> &order) {
+  const int available = static_cast<int>(order.size());
+  const int threads = options.num_threads > 0 ? options.num_threads : available;
+  return options.placement == ThreadPlacement::NoSmt ? std::min(threads, available) : threads;
+}
+
+// Counts [first, last) with every thread pinned to its CPU of the placement
+// order. Counts are gathered per socket in memory first touched by a thread
+// of that socket, and only the per-socket totals cross the interconnect.
+long long count_range_placed(long long first, long long last, const EstimateOptions &options,
+                             const std::vector<detail::LogicalCpu> &order, ThreadObserver *observer) {
+  // One cache line per thread count
+  struct alignas(64) ThreadCount {
+    long long hits = 0;
+  };
+
+  struct SocketState {
+    std::vector<ThreadCount> threads;
+    long long hits = 0;
+  };
+
+  const int available = static_cast<int>(order.size());
+  const int threads = placed_thread_count(options, order);
+
+  // Dense socket index and rank within the socket of every thread
+  std::vector<int> socket_ids;
+  std::vector<int> socket_of(threads);
+  std::vector<int> rank_in_socket(threads);
+  std::vector<int> socket_size;
+
+  for (int t = 0; t < threads; ++t) {
+    const int socket_id = order[t % available].socket;
+    const auto found = std::find(socket_ids.begin(), socket_ids.end(), socket_id);
+    socket_of[t] = static_cast<int>(found - socket_ids.begin());
+
+    if (found == socket_ids.end()) {
+      socket_ids.push_back(socket_id);
+      socket_size.push_back(0);
+    }
+
+    rank_in_socket[t] = socket_size[socket_of[t]]++;
+  }
+
+  const std::uint64_t seed = options.seed;
+  const Arithmetic arithmetic = options.arithmetic;
+  const SimdLevel level = options.simd_level;
+  const long long num_blocks = (last - first + kBlockSize - 1) / kBlockSize;
+  std::vector<std::unique_ptr<SocketState>> sockets(socket_ids.size());
+  const TraceScope region("parallel_region", num_blocks);
+  const std::int64_t fork_ns = trace_now();
+  #pragma omp parallel num_threads(threads)
+  {
+    const int t = omp_get_thread_num();
+    trace_since("thread_start", fork_ns, t);
+    const std::int64_t setup_ns = trace_now();
+    const detail::ScopedCpuPin pin(order[t % available].cpu);
+    const int socket = socket_of[t];
+
+    // The first thread of a socket allocates its state after pinning, so the pages land on its node
+    if (rank_in_socket[t] == 0) {
+      sockets[socket].reset(new SocketState);
+      sockets[socket]->threads.resize(socket_size[socket]);
+    }
+
+    trace_since("setup", setup_ns, order[t % available].cpu);
+    {
+      const TraceScope wait("barrier");
+      #pragma omp barrier
+    }
+    long long local_points_inside = 0;
+    long long local_points = 0;
+
+    if (observer != nullptr) {
+      observer->thread_begin(t);
+    }
+
+    #pragma omp for schedule(static) nowait
+
+    for (long long block = 0; block < num_blocks; ++block) {
+      const TraceScope span("block", block);
+      const long long block_first = first + block * kBlockSize;
+      const long long block_last = std::min(block_first + kBlockSize, last);
+      local_points_inside += count_points_inside(seed, block_first, block_last, arithmetic, level);
+      local_points += block_last - block_first;
+    }
+
+    if (observer != nullptr) {
+      observer->thread_end(t, local_points);
+    }
+
+    sockets[socket]->threads[rank_in_socket[t]].hits = local_points_inside;
+    const TraceScope reduction("reduction", socket);
+    #pragma omp barrier
 
-    // Check if point lies inside the circle (x^2 + y^2 <= 1)
-    if (x*x + y*y <= 1.0) {
-      points_inside++;
+    if (rank_in_socket[t] == 0) {
+      for (const ThreadCount &count : sockets[socket]->threads) {
+        sockets[socket]->hits += count.hits;
+      }
+    }
+  }
+
+  long long points_inside = 0;
+
+  // Sockets without a thread in the team (if the runtime gave fewer threads) have no state
+  for (const std::unique_ptr<SocketState> &state : sockets) {
+    if (state) {
+      points_inside += state->hits;
     }
   }
 
-  return {points_inside, total_points};
+  return points_inside;
+}
+
+// Counts [first, last) of the seeded stream as the quarter-circle instance of the engine
+long long count_range_parallel(long long first, long long last, const EstimateOptions &options) {
+  return detail::count_range_parallel(first, last, options, nullptr);
+}
+
+// Binomial standard error and 95% Wilson score interval, scaled to Pi
+void fill_statistics(EstimateResult *result) {
+  constexpr double z = 1.959963984540054;
+
+  if (result->points <= 0) {
+    return;
+  }
+
+  const double n = static_cast<double>(result->points);
+  const double p = static_cast<double>(result->hits) / n;
+  const double centre = (p + z * z / (2.0 * n)) / (1.0 + z * z / n);
+  const double half_width = z * std::sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / (1.0 + z * z / n);
+  result->estimate = 4.0 * p;
+  result->standard_error = 4.0 * std::sqrt(p * (1.0 - p) / n);
+  result->ci_lower = 4.0 * (centre - half_width);
+  result->ci_upper = 4.0 * (centre + half_width);
+}
+
+} // namespace
+
+long long detail::count_range_parallel(long long first, long long last, const EstimateOptions &options, ThreadObserver *observer) {
+  const std::vector<detail::LogicalCpu> order = placement_cpus(options.placement);
+
+  if (!order.empty()) {
+    return count_range_placed(first, last, options, order, observer);
+  }
+
+  return sample_sum<2, long long>(quarter_circle(options), PhiloxPoints(options.seed), first, last,
+                                  engine_options(options, observer));
+}
+
+struct CancellationToken::State {
+  std::atomic<bool> cancelled{false};
+};
+
+CancellationToken::CancellationToken() : state_(new State) {
+}
+
+CancellationToken::~CancellationToken() = default;
+
+void CancellationToken::cancel() {
+  state_->cancelled.store(true, std::memory_order_relaxed);
+}
+
+void CancellationToken::reset() {
+  state_->cancelled.store(false, std::memory_order_relaxed);
+}
+
+bool CancellationToken::is_cancelled() const {
+  return state_->cancelled.load(std::memory_order_relaxed);
+}
+
+SimdLevel detect_simd_level() {
+  static const SimdLevel level = detail::detect_cpu_simd_level();
+  return level;
+}
+
+const char *simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::Scalar:
+      return "scalar";
+
+    case SimdLevel::SSE42:
+      return "sse4.2";
+
+    case SimdLevel::AVX2:
+      return "avx2";
+
+    case SimdLevel::AVX512:
+      return "avx512";
+  }
+
+  return "unknown";
+}
+
+long long count_points_inside(std::uint64_t seed, long long first, long long last) {
+  return count_points_inside(seed, first, last, detect_simd_level());
+}
+
+long long count_points_inside(std::uint64_t seed, long long first, long long last, SimdLevel level) {
+  return count_points_inside(seed, first, last, Arithmetic::Double, level);
+}
+
+long long count_points_inside(std::uint64_t seed, long long first, long long last, Arithmetic arithmetic, SimdLevel level) {
+  if (first < 0 || last <= first) {
+    return 0;
+  }
+
+  const std::uint64_t begin = static_cast<std::uint64_t>(first);
+  const std::uint64_t end = static_cast<std::uint64_t>(last);
+
+  if (level > detect_simd_level()) {
+    level = detect_simd_level();
+  }
+
+  if (arithmetic == Arithmetic::FixedPoint) {
+    return count_fixed_point(seed, begin, end, level);
+  }
+
+  switch (level) {
+    case SimdLevel::AVX512:
+      return detail::count_inside_avx512(seed, begin, end);
+
+    case SimdLevel::AVX2:
+      return detail::count_inside_avx2(seed, begin, end);
+
+    case SimdLevel::SSE42:
+      return detail::count_inside_sse42(seed, begin, end);
+
+    case SimdLevel::Scalar:
+      break;
+  }
+
+  return detail::count_inside_scalar(seed, begin, end);
+}
+
+std::pair<long long, long long> generate_points(long long num_points) {
+  return generate_points(num_points, random_seed());
+}
+
+std::pair<long long, long long> generate_points(long long num_points, std::uint64_t seed) {
+  // Handle edge cases
+  if (num_points <= 0) {
+    return {0, 0};
+  }
+
+  EngineOptions sequential;
+  sequential.num_threads = 1;
+  return {sample_sum<2, long long>(quarter_circle(EstimateOptions()), PhiloxPoints(seed), 0, num_points, sequential), num_points};
 }
 
 double calculate_pi_sequential(long long num_points) {
+  return calculate_pi_sequential(num_points, random_seed());
+}
+
+double calculate_pi_sequential(long long num_points, std::uint64_t seed) {
   if (num_points <= 0) {
     return 0.0;
   }
 
-  auto [points_inside, total_points] = generate_points(num_points);
+  auto [points_inside, total_points] = generate_points(num_points, seed);
 
   if (total_points == 0) {
     return 0.0;
@@ -47,45 +360,185 @@ double calculate_pi_sequential(long long num_points) {
 }
 
 double calculate_pi_parallel(long long num_points, int num_threads) {
+  return calculate_pi_parallel(num_points, num_threads, random_seed());
+}
+
+double calculate_pi_parallel(long long num_points, int num_threads, std::uint64_t seed) {
+  EstimateOptions options;
+  options.num_threads = num_threads;
+  options.seed = seed;
+  return calculate_pi_parallel(num_points, options);
+}
+
+double calculate_pi_parallel(long long num_points, const EstimateOptions &options) {
   if (num_points <= 0) {
     return 0.0;
   }
 
-  if (num_threads > 0) {
-    omp_set_num_threads(num_threads);
+  long long points_inside = count_range_parallel(0, num_points, options);
+  long long total_points = num_points;
+
+  if (total_points == 0) {
+    return 0.0;
   }
 
-  long long points_inside = 0;
-  long long total_points = num_points;
-  #pragma omp parallel
+  return 4.0 * points_inside / total_points;
+}
+
+EstimateResult calculate_pi_parallel(long long num_points, const EstimateOptions &options, const ProgressCallback &on_progress,
+                                     const CancellationToken *cancellation, long long report_interval) {
+  const auto start = std::chrono::steady_clock::now();
+  EstimateResult result;
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  const std::vector<detail::LogicalCpu> order = placement_cpus(options.placement);
+  const int threads = !order.empty() ? placed_thread_count(options, order)
+                      : options.num_threads > 0 ? options.num_threads : omp_get_max_threads();
+  report_interval = std::max(report_interval, kBlockSize);
+  const long long num_blocks = (num_points + kBlockSize - 1) / kBlockSize;
+  std::atomic<long long> points_done{0};
+  std::atomic<long long> hits{0};
+  std::atomic<long long> next_report{report_interval};
+  std::atomic<long long> next_block{0};
+  std::mutex report_mutex;
+  long long last_reported = 0;  // Guarded by report_mutex
+  #pragma omp parallel num_threads(threads)
   {
-    // Her thread için benzersiz bir seed oluştur
-    auto now = std::chrono::high_resolution_clock::now();
-    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
-    unsigned seed = static_cast<unsigned>(nanos) + omp_get_thread_num() * 1000;
-    std::mt19937 generator(seed);
-    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
-    long long local_points_inside = 0;
-    #pragma omp for
+    const detail::ScopedCpuPin pin(order.empty() ? -1 : order[omp_get_thread_num() % order.size()].cpu);
 
-    for (long long i = 0; i < num_points; ++i) {
-      double x = distribution(generator);
-      double y = distribution(generator);
+    // Threads claim blocks from a shared counter, so every thread leaves at
+    // its next block boundary once cancellation is requested
+    for (long long block = next_block.fetch_add(1, std::memory_order_relaxed);
+         block < num_blocks && (cancellation == nullptr || !cancellation->is_cancelled());
+         block = next_block.fetch_add(1, std::memory_order_relaxed)) {
+      const TraceScope span("block", block);
+      const long long first = block * kBlockSize;
+      const long long last = std::min(first + kBlockSize, num_points);
+      const long long block_hits = count_points_inside(options.seed, first, last, options.arithmetic, options.simd_level);
+      const long long hits_so_far = hits.fetch_add(block_hits, std::memory_order_relaxed) + block_hits;
+      const long long done = points_done.fetch_add(last - first, std::memory_order_relaxed) + (last - first);
 
-      if (x*x + y*y <= 1.0) {
-        local_points_inside++;
+      if (on_progress && done >= next_report.load(std::memory_order_relaxed) && report_mutex.try_lock()) {
+        // Another thread with a larger count may have reported between the check and the lock
+        if (done >= next_report.load(std::memory_order_relaxed) && done > last_reported) {
+          last_reported = done;
+          next_report.store(done + report_interval, std::memory_order_relaxed);
+          on_progress(Progress{done, num_points, hits_so_far, 4.0 * hits_so_far / done});
+        }
+
+        report_mutex.unlock();
       }
     }
+  }
 
-    #pragma omp atomic
-    points_inside += local_points_inside;
+  result.points = points_done.load();
+  result.hits = hits.load();
+  result.cancelled = result.points < num_points;
+  fill_statistics(&result);
+  result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.points_per_second = result.elapsed_seconds > 0.0 ? result.points / result.elapsed_seconds : 0.0;
+
+  if (on_progress) {
+    on_progress(Progress{result.points, num_points, result.hits, result.estimate});
   }
 
-  if (total_points == 0) {
-    return 0.0;
+  return result;
+}
+
+void calculate_pi_batch(const BatchRequest *requests, std::size_t count, double *results, const EstimateOptions &options) {
+  if (count == 0) {
+    return;
   }
 
-  return 4.0 * points_inside / total_points;
+  // Blocks of the requests before and including each one; a global block
+  // index is mapped back to its request by binary search
+  std::vector<long long> block_ends(count);
+  long long num_blocks = 0;
+
+  for (std::size_t request = 0; request < count; ++request) {
+    num_blocks += (std::max(requests[request].num_points, 0LL) + kBlockSize - 1) / kBlockSize;
+    block_ends[request] = num_blocks;
+  }
+
+  const int threads = options.num_threads > 0 ? options.num_threads : omp_get_max_threads();
+  const Arithmetic arithmetic = options.arithmetic;
+  const SimdLevel level = options.simd_level;
+  std::vector<long long> hits(count, 0);
+
+  #pragma omp parallel num_threads(threads)
+  {
+    // A thread's blocks are mostly of one request, so it adds to hits only when the request changes
+    std::size_t current = count;
+    long long local_hits = 0;
+
+    // Tail blocks of small requests are shorter, so blocks are handed out dynamically
+    #pragma omp for schedule(dynamic, 4) nowait
+
+    for (long long block = 0; block < num_blocks; ++block) {
+      const std::size_t request = static_cast<std::size_t>(std::upper_bound(block_ends.begin(), block_ends.end(), block) - block_ends.begin());
+
+      if (request != current) {
+        if (current < count) {
+          #pragma omp atomic
+          hits[current] += local_hits;
+        }
+
+        current = request;
+        local_hits = 0;
+      }
+
+      const long long first = (block - (request > 0 ? block_ends[request - 1] : 0)) * kBlockSize;
+      const long long last = std::min(first + kBlockSize, requests[request].num_points);
+      local_hits += count_points_inside(requests[request].seed, first, last, arithmetic, level);
+    }
+
+    if (current < count) {
+      #pragma omp atomic
+      hits[current] += local_hits;
+    }
+  }
+
+  for (std::size_t request = 0; request < count; ++request) {
+    const long long num_points = requests[request].num_points;
+    results[request] = num_points > 0 ? 4.0 * hits[request] / num_points : 0.0;
+  }
+}
+
+EstimateResult estimate_pi(double target_stderr, long long max_points, int num_threads) {
+  EstimateOptions options;
+  options.num_threads = num_threads;
+  options.seed = random_seed();
+  return estimate_pi(target_stderr, max_points, options);
+}
+
+EstimateResult estimate_pi(double target_stderr, long long max_points, const EstimateOptions &options) {
+  const auto start = std::chrono::steady_clock::now();
+  EstimateResult result;
+  long long batch = kMinBatch;
+
+  while (result.points < max_points) {
+    // Extend the same stream, so the batches add up to one run over [0, points)
+    batch = std::min(batch, max_points - result.points);
+    result.hits += count_range_parallel(result.points, result.points + batch, options);
+    result.points += batch;
+    fill_statistics(&result);
+
+    if (result.standard_error <= target_stderr) {
+      break;
+    }
+
+    // Points still needed if the variance stays where it is, growing by at most 2x per batch
+    const double needed = static_cast<double>(result.points) * (result.standard_error / target_stderr) * (result.standard_error / target_stderr);
+    const double remaining = needed * 1.05 - static_cast<double>(result.points);
+    batch = std::max(kMinBatch, static_cast<long long>(std::min(remaining, static_cast<double>(result.points))));
+  }
+
+  result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.points_per_second = result.elapsed_seconds > 0.0 ? result.points / result.elapsed_seconds : 0.0;
+  return result;
 }
 
 } // namespace monte_carlo_pi
@@ -4,9 +4,192 @@
 #include <random>
 #include <vector>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
 
 namespace monte_carlo_pi {
 
+/**
+ * @brief Instruction set used by the inside-circle kernel
+ */
+enum class SimdLevel {
+  Scalar,  ///< Portable C++ kernel, one point per step
+  SSE42,   ///< SSE4.2 kernel, 4 points per step
+  AVX2,    ///< AVX2 kernel, 8 points per step
+  AVX512   ///< AVX-512F kernel, 16 points per step
+};
+
+/**
+ * @brief Coordinate arithmetic used by the inside-circle kernel
+ *
+ * Double maps two 64-bit words to x and y in [0, 1), one counter per point.
+ * FixedPoint splits each 64-bit word into two 32-bit coordinates, so one
+ * counter yields two points and the hot loop contains no int-to-float
+ * conversion. It tests the cell centre (x + 1/2, y + 1/2) against the radius
+ * 2^32 exactly in 64-bit integer arithmetic. The two modes map points to
+ * counters differently, so a seed gives a different (equally valid) stream
+ * in each mode.
+ *
+ * Bias: both modes evaluate the indicator on a grid rather than on the
+ * continuum. Double uses the corners of a 2^-52 grid, which overcounts about
+ * one cell per row and biases the Pi estimate by about 4 * 2^-52 (9e-16).
+ * Corners of the coarser 2^-32 grid would bias it by 4 * 2^-32 (9e-10);
+ * testing cell centres cancels that first-order term and leaves the
+ * lattice-point remainder of the Gauss circle problem, of order
+ * 4 * R^(-4/3) with R = 2^32 (about 1e-12). Both are far below the
+ * statistical error of 1.64 / sqrt(N), which is still 5e-7 at N = 10^13.
+ */
+enum class Arithmetic {
+  Double,     ///< 52-bit double coordinates, one counter per point
+  FixedPoint  ///< 32-bit integer coordinates, two points per counter
+};
+
+/**
+ * @brief Placement of the parallel estimator's threads on the CPUs
+ *
+ * Honoured by every calculate_pi_parallel overload and by estimate_pi;
+ * the progress-reporting overload pins its threads but keeps its shared
+ * counters instead of the per-socket reduction. Uses the Linux CPU
+ * affinity API and the sysfs topology, read once per process, and is
+ * limited to the CPUs the process may run on. Each thread is pinned only
+ * for the duration of the call. On other platforms, or if the topology
+ * cannot be read, every policy behaves like Default.
+ */
+enum class ThreadPlacement {
+  Default,        ///< Leave placement to the OpenMP runtime
+  Compact,        ///< Fill one socket at a time, SMT siblings next to each other
+  Scatter,        ///< Alternate between sockets, distinct cores before SMT siblings
+  PhysicalCores,  ///< One thread per physical core before any SMT sibling is used
+  NoSmt           ///< Physical cores only, the thread count is capped at the core count
+};
+
+/**
+ * @brief Settings of a seeded parallel estimate
+ */
+struct EstimateOptions {
+  int num_threads = 0;                                   ///< Number of threads to use (0 for default)
+  std::uint64_t seed = 0;                                ///< Seed of the counter-based point stream
+  Arithmetic arithmetic = Arithmetic::Double;            ///< Coordinate arithmetic of the kernel
+  SimdLevel simd_level = SimdLevel::AVX512;              ///< Widest kernel to use, clamped to the host
+  ThreadPlacement placement = ThreadPlacement::Default;  ///< CPU placement of the threads
+};
+
+/**
+ * @brief One estimate of a batch submitted to calculate_pi_batch
+ */
+struct BatchRequest {
+  long long num_points = 0;  ///< Number of points to generate
+  std::uint64_t seed = 0;    ///< Seed of the counter-based point stream
+};
+
+/**
+ * @brief Outcome of an adaptive, precision-targeted estimate
+ */
+struct EstimateResult {
+  double estimate = 0.0;           ///< Estimated value of Pi
+  double standard_error = 0.0;     ///< Binomial standard error of the estimate
+  double ci_lower = 0.0;           ///< Lower bound of the 95% Wilson confidence interval
+  double ci_upper = 0.0;           ///< Upper bound of the 95% Wilson confidence interval
+  long long points = 0;            ///< Points sampled
+  long long hits = 0;              ///< Points inside the circle
+  double elapsed_seconds = 0.0;    ///< Wall-clock time of the estimate
+  double points_per_second = 0.0;  ///< Sampling throughput
+  bool cancelled = false;          ///< true if the run stopped early on cancellation
+};
+
+/**
+ * @brief Snapshot passed to a progress callback
+ *
+ * While the run is in flight the counters are read from separate atomics
+ * and may disagree by up to one block; the final report is exact.
+ */
+struct Progress {
+  long long points_done = 0;   ///< Points sampled so far
+  long long points_total = 0;  ///< Points requested
+  long long hits = 0;          ///< Points inside the circle so far
+  double estimate = 0.0;       ///< Partial estimate of Pi
+};
+
+/// Receives progress reports; calls are serialised, never concurrent
+using ProgressCallback = std::function<void(const Progress &)>;
+
+/**
+ * @brief Thread-safe flag used to stop a running estimate
+ *
+ * The flag lives behind a pointer so that this header stays usable from
+ * C++/CLI code, where <atomic> is not available.
+ */
+class CancellationToken {
+ public:
+  CancellationToken();
+  ~CancellationToken();
+  CancellationToken(const CancellationToken &) = delete;
+  CancellationToken &operator=(const CancellationToken &) = delete;
+
+  /**
+   * @brief Requests cancellation; callable from any thread
+   */
+  void cancel();
+
+  /**
+   * @brief Clears a previous cancellation request
+   */
+  void reset();
+
+  /**
+   * @brief Checks whether cancellation was requested
+   * @return true after cancel() and before reset()
+   */
+  bool is_cancelled() const;
+
+ private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
+/**
+ * @brief Low-discrepancy sequence used by the quasi-Monte Carlo estimator
+ *
+ * Every sequence is randomised from a seed so that independent replicas
+ * give an unbiased error estimate (randomised QMC). Coordinates are 32-bit
+ * fixed-point values tested with the exact cell-centre test of
+ * Arithmetic::FixedPoint.
+ */
+enum class Sequence {
+  Sobol,   ///< 2-D Sobol in Gray-code order with hash-based Owen scrambling, at most 2^32 points
+  Halton,  ///< Halton bases 2 and 3 with a random shift modulo 1, at most 2^32 points
+  R2       ///< R2 additive recurrence (plastic number) with a random start
+};
+
+/**
+ * @brief Result of a randomised quasi-Monte Carlo estimate
+ */
+struct QmcResult {
+  double pi = 0.0;                       ///< Mean of the replica estimates
+  double standard_error = 0.0;           ///< Standard error across replicas (0 for one replica)
+  std::vector<double> replica_estimates; ///< Estimate of every replica
+};
+
+/**
+ * @brief Detects the widest kernel the host CPU can execute
+ *
+ * The CPUID query runs once; every later call returns the cached level.
+ * All kernels produce identical counts, so the choice only affects speed.
+ *
+ * @return Widest supported SimdLevel
+ */
+SimdLevel detect_simd_level();
+
+/**
+ * @brief Returns a printable name for a kernel level
+ * @param level Kernel level
+ * @return Name such as "avx2"
+ */
+const char *simd_level_name(SimdLevel level);
+
 /**
  * @brief Calculates Pi using Monte Carlo method sequentially
  * @param num_points Number of points to generate
@@ -14,6 +197,14 @@ namespace monte_carlo_pi {
  */
 double calculate_pi_sequential(long long num_points);
 
+/**
+ * @brief Calculates Pi sequentially from a reproducible point stream
+ * @param num_points Number of points to generate
+ * @param seed Seed of the counter-based point stream
+ * @return Calculated Pi value
+ */
+double calculate_pi_sequential(long long num_points, std::uint64_t seed);
+
 /**
  * @brief Calculates Pi using Monte Carlo method with OpenMP
  * @param num_points Number of points to generate
@@ -22,6 +213,88 @@ double calculate_pi_sequential(long long num_points);
  */
 double calculate_pi_parallel(long long num_points, int num_threads = 0);
 
+/**
+ * @brief Calculates Pi with OpenMP from a reproducible point stream
+ *
+ * Point i is always drawn from counter i of the stream, so the result
+ * depends only on (seed, num_points) and not on the thread count.
+ *
+ * @param num_points Number of points to generate
+ * @param num_threads Number of threads to use (0 for default)
+ * @param seed Seed of the counter-based point stream
+ * @return Calculated Pi value
+ */
+double calculate_pi_parallel(long long num_points, int num_threads, std::uint64_t seed);
+
+/**
+ * @brief Calculates Pi with OpenMP using explicit kernel settings
+ * @param num_points Number of points to generate
+ * @param options Thread count, seed, arithmetic and kernel level
+ * @return Calculated Pi value
+ */
+double calculate_pi_parallel(long long num_points, const EstimateOptions &options);
+
+/**
+ * @brief Calculates Pi with OpenMP, reporting progress and honouring cancellation
+ *
+ * Threads publish their counts once per block, so the hot loop itself is
+ * untouched. Whichever thread first crosses the next reporting threshold
+ * calls on_progress; points_done never decreases from one report to the
+ * next. When cancelled, the threads stop at their next block boundary and
+ * the estimate of the points sampled so far is returned.
+ *
+ * @param num_points Number of points to generate
+ * @param options Thread count, seed, arithmetic and kernel level
+ * @param on_progress Progress callback, may be empty
+ * @param cancellation Cancellation token, may be nullptr
+ * @param report_interval Points between two progress reports
+ * @return Estimate of the sampled points, with cancelled set if stopped early
+ */
+EstimateResult calculate_pi_parallel(long long num_points, const EstimateOptions &options, const ProgressCallback &on_progress,
+                                     const CancellationToken *cancellation, long long report_interval = 1LL << 24);
+
+/**
+ * @brief Calculates many independent estimates in a single parallel dispatch
+ *
+ * All requests are cut into equal-sized blocks and scheduled together, so
+ * a batch of small estimates pays for one fork/join instead of one each.
+ * results[i] equals calculate_pi_parallel(requests[i].num_points, options)
+ * with options.seed set to requests[i].seed.
+ *
+ * @param requests Array of count requests
+ * @param count Number of requests
+ * @param results Array of count values receiving the Pi estimates
+ * @param options Thread count, arithmetic and kernel level; the seed is taken from each request
+ */
+void calculate_pi_batch(const BatchRequest *requests, std::size_t count, double *results, const EstimateOptions &options = EstimateOptions());
+
+/**
+ * @brief Estimates Pi to a target precision instead of a fixed point count
+ *
+ * Runs the parallel engine in growing batches over one seeded stream and
+ * stops as soon as the binomial standard error reaches target_stderr, or
+ * when max_points have been sampled.
+ *
+ * @param target_stderr Standard error at which to stop
+ * @param max_points Upper bound on the number of points
+ * @param num_threads Number of threads to use (0 for default)
+ * @return Estimate with its error, confidence interval and throughput
+ */
+EstimateResult estimate_pi(double target_stderr, long long max_points, int num_threads = 0);
+
+/**
+ * @brief Estimates Pi to a target precision with explicit kernel settings
+ *
+ * The result equals a single run over the first result.points points of
+ * the stream selected by options.
+ *
+ * @param target_stderr Standard error at which to stop
+ * @param max_points Upper bound on the number of points
+ * @param options Thread count, seed, arithmetic and kernel level
+ * @return Estimate with its error, confidence interval and throughput
+ */
+EstimateResult estimate_pi(double target_stderr, long long max_points, const EstimateOptions &options);
+
 /**
  * @brief Generates random points and counts points inside circle
  * @param num_points Number of points to generate
@@ -29,6 +302,89 @@ double calculate_pi_parallel(long long num_points, int num_threads = 0);
  */
 std::pair<long long, long long> generate_points(long long num_points);
 
+/**
+ * @brief Generates points from a reproducible stream and counts points inside circle
+ * @param num_points Number of points to generate
+ * @param seed Seed of the counter-based point stream
+ * @return Pair of (points_inside_circle, total_points)
+ */
+std::pair<long long, long long> generate_points(long long num_points, std::uint64_t seed);
+
+/**
+ * @brief Counts the points of a stream index range that fall inside the circle
+ *
+ * Ranges can be split at any boundary and evaluated independently; the
+ * counts of adjacent ranges always add up to the count of their union.
+ *
+ * @param seed Seed of the counter-based point stream
+ * @param first Index of the first point (inclusive)
+ * @param last Index one past the last point (exclusive)
+ * @return Number of points in [first, last) inside the circle
+ */
+long long count_points_inside(std::uint64_t seed, long long first, long long last);
+
+/**
+ * @brief Counts the points of a stream index range with a specific kernel
+ *
+ * Levels the host cannot execute fall back to the widest supported one.
+ *
+ * @param seed Seed of the counter-based point stream
+ * @param first Index of the first point (inclusive)
+ * @param last Index one past the last point (exclusive)
+ * @param level Kernel to run
+ * @return Number of points in [first, last) inside the circle
+ */
+long long count_points_inside(std::uint64_t seed, long long first, long long last, SimdLevel level);
+
+/**
+ * @brief Counts the points of a stream index range with a specific arithmetic and kernel
+ * @param seed Seed of the counter-based point stream
+ * @param first Index of the first point (inclusive)
+ * @param last Index one past the last point (exclusive)
+ * @param arithmetic Coordinate arithmetic
+ * @param level Kernel to run
+ * @return Number of points in [first, last) inside the circle
+ */
+long long count_points_inside(std::uint64_t seed, long long first, long long last, Arithmetic arithmetic, SimdLevel level);
+
+/**
+ * @brief Returns a printable name for a low-discrepancy sequence
+ * @param sequence Sequence
+ * @return Name such as "sobol"
+ */
+const char *sequence_name(Sequence sequence);
+
+/**
+ * @brief Counts the points of a low-discrepancy index range inside the circle
+ *
+ * Like count_points_inside, ranges can be split at any boundary.
+ *
+ * @param sequence Low-discrepancy sequence
+ * @param seed Randomisation seed of the sequence
+ * @param first Index of the first point (inclusive)
+ * @param last Index one past the last point (exclusive)
+ * @return Number of points in [first, last) inside the circle
+ * @throws std::invalid_argument If a Sobol or Halton range reaches beyond 2^32 points
+ */
+long long count_points_inside_qmc(Sequence sequence, std::uint64_t seed, long long first, long long last);
+
+/**
+ * @brief Calculates Pi with randomised quasi-Monte Carlo sampling and OpenMP
+ *
+ * The error of a QMC estimate shrinks close to O(1/N) instead of
+ * O(1/sqrt(N)). Each replica uses an independently randomised copy of the
+ * sequence; the spread of the replicas gives the standard error.
+ *
+ * @param num_points Number of points per replica
+ * @param sequence Low-discrepancy sequence
+ * @param replicas Number of independent randomisations (at least 1)
+ * @param num_threads Number of threads to use (0 for default)
+ * @param seed Randomisation seed
+ * @return Mean estimate, standard error and per-replica estimates
+ * @throws std::invalid_argument If a Sobol or Halton estimate asks for more than 2^32 points
+ */
+QmcResult calculate_pi_qmc(long long num_points, Sequence sequence, int replicas = 1, int num_threads = 0, std::uint64_t seed = 0);
+
 } // namespace monte_carlo_pi
 
-#endif // MONTE_CARLO_PI_H 
+#endif // MONTE_CARLO_PI_H
@@ -0,0 +1,128 @@
+#ifndef MONTE_CARLO_PI_KERNELS_H
+#define MONTE_CARLO_PI_KERNELS_H
+
+#include "monte_carlo_pi.h"
+#include "philox.h"
+#include <cstdint>
+
+namespace monte_carlo_pi {
+namespace detail {
+
+/// Scale of a 52-bit integer mapped onto [0, 1)
+constexpr double kUnitScale = 1.0 / 4503599627370496.0;  // 2^-52
+
+/**
+ * @brief Maps a 64-bit random word onto [0, 1)
+ *
+ * Keeps the top 52 bits, which is exactly the value the vector kernels
+ * obtain by OR-ing the bits into the mantissa of 1.0 and subtracting 1.0.
+ *
+ * @param bits Random word
+ * @return Uniform double in [0, 1)
+ */
+inline double to_unit_double(std::uint64_t bits) {
+  return static_cast<double>(bits >> 12) * kUnitScale;
+}
+
+/**
+ * @brief Tests whether point i of the stream lies inside the quarter circle
+ *
+ * Point i takes x from the first and y from the second 64-bit half of
+ * counter i.
+ *
+ * @param philox Keyed generator
+ * @param index Stream index of the point
+ * @return true if x^2 + y^2 <= 1
+ */
+inline bool point_inside(const Philox4x32 &philox, std::uint64_t index) {
+  const Philox4x32::Counter bits = philox(index);
+  double x = to_unit_double((static_cast<std::uint64_t>(bits[1]) << 32) | bits[0]);
+  double y = to_unit_double((static_cast<std::uint64_t>(bits[3]) << 32) | bits[2]);
+  return x * x + y * y <= 1.0;
+}
+
+/**
+ * @brief SplitMix64 finaliser, used to derive independent sub-seeds
+ * @param value Input word
+ * @return Well-mixed output word
+ */
+inline std::uint64_t mix_seed(std::uint64_t value) {
+  value += 0x9E3779B97F4A7C15ull;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+  return value ^ (value >> 31);
+}
+
+/**
+ * @brief Returns (v + 1/2)^2 - 1/4 = v^2 + v, which fits in 64 bits for any 32-bit v
+ * @param v Fixed-point coordinate
+ * @return Shifted square of the cell centre
+ */
+inline std::uint64_t centred_square(std::uint32_t v) {
+  return static_cast<std::uint64_t>(v) * v + v;
+}
+
+/**
+ * @brief Exact fixed-point inside test of the cell centre (x + 1/2, y + 1/2)
+ *
+ * (x + 1/2)^2 + (y + 1/2)^2 <= 2^64 reduces to x^2 + x + y^2 + y <= 2^64 - 1
+ * for integers, i.e. to the 64-bit sum not carrying out.
+ *
+ * @param x First coordinate in units of 2^-32
+ * @param y Second coordinate in units of 2^-32
+ * @return true if the cell centre lies inside the quarter circle
+ */
+inline bool fixed_point_inside(std::uint32_t x, std::uint32_t y) {
+  const std::uint64_t x_term = centred_square(x);
+  return x_term + centred_square(y) >= x_term;
+}
+
+/**
+ * @brief Portable kernel, also used for the tails of the vector kernels
+ * @param seed Stream seed
+ * @param first First index (inclusive)
+ * @param last Last index (exclusive)
+ * @return Number of points inside the circle
+ */
+long long count_inside_scalar(std::uint64_t seed, std::uint64_t first, std::uint64_t last);
+
+/// SSE4.2 kernel, 4 points per step
+long long count_inside_sse42(std::uint64_t seed, std::uint64_t first, std::uint64_t last);
+
+/// AVX2 kernel, 8 points per step
+long long count_inside_avx2(std::uint64_t seed, std::uint64_t first, std::uint64_t last);
+
+/// AVX-512 kernel, 16 points per step
+long long count_inside_avx512(std::uint64_t seed, std::uint64_t first, std::uint64_t last);
+
+/**
+ * @brief Portable fixed-point kernel over whole counters
+ *
+ * Counter c carries point 2c in words 0/1 and point 2c + 1 in words 2/3.
+ *
+ * @param seed Stream seed
+ * @param first_counter First counter (inclusive)
+ * @param last_counter Last counter (exclusive)
+ * @return Number of points inside the circle
+ */
+long long count_inside_fixed_scalar(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter);
+
+/// SSE4.2 fixed-point kernel, 8 points per step
+long long count_inside_fixed_sse42(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter);
+
+/// AVX2 fixed-point kernel, 16 points per step
+long long count_inside_fixed_avx2(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter);
+
+/// AVX-512 fixed-point kernel, 32 points per step
+long long count_inside_fixed_avx512(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter);
+
+/**
+ * @brief Queries CPUID (and the OS-enabled register state) once
+ * @return Highest vector kernel level the host can execute
+ */
+SimdLevel detect_cpu_simd_level();
+
+} // namespace detail
+} // namespace monte_carlo_pi
+
+#endif // MONTE_CARLO_PI_KERNELS_H
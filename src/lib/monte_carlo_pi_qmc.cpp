@@ -0,0 +1,249 @@
+#include "monte_carlo_pi.h"
+#include "monte_carlo_pi_kernels.h"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// Points handed to the sequence generator per parallel work item
+constexpr long long kBlockSize = 1 << 14;
+
+// Sobol and the base-2 Halton coordinate work on 32-bit indices, so larger ranges would repeat points
+constexpr long long kMaxPoints32 = 1LL << 32;
+
+// R2 increments 1/g and 1/g^2 (g = plastic number) as 64-bit fractions
+constexpr std::uint64_t kR2Alpha0 = 0xC13FA9A902A6328Full;
+constexpr std::uint64_t kR2Alpha1 = 0x91E10DA5C79E7B1Cull;
+
+// Direction numbers of the second Sobol dimension (primitive polynomial x + 1, m_1 = 1)
+struct SobolDirections {
+  std::uint32_t v[32] = {};
+
+  constexpr SobolDirections() {
+    v[0] = 0x80000000u;
+
+    for (int bit = 1; bit < 32; ++bit) {
+      v[bit] = v[bit - 1] ^ (v[bit - 1] >> 1);
+    }
+  }
+};
+
+constexpr SobolDirections kSobolDirections;
+
+std::uint32_t reverse_bits(std::uint32_t x) {
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+  x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+int trailing_zeros(std::uint64_t x) {
+  int count = 0;
+
+  while ((x & 1) == 0 && count < 64) {
+    x >>= 1;
+    ++count;
+  }
+
+  return count;
+}
+
+// Hash-based nested uniform (Owen) scramble of one coordinate, after Burley,
+// "Practical Hash-based Owen Scrambling" (JCGT 2020). The Laine-Karras
+// permutation only lets lower bits influence higher ones; running it on the
+// reversed word makes every digit depend only on the digits above it.
+std::uint32_t owen_scramble(std::uint32_t x, std::uint32_t seed) {
+  x = reverse_bits(x);
+  x += seed;
+  x ^= x * 0x6C50B47Cu;
+  x ^= x * 0xB82F1E52u;
+  x ^= x * 0xC7AFE638u;
+  x ^= x * 0x8D22F6E6u;
+  return reverse_bits(x);
+}
+
+// Second Sobol coordinate of a (Gray-coded) index
+std::uint32_t sobol_dimension1(std::uint32_t index) {
+  std::uint32_t value = 0;
+
+  for (int bit = 0; index != 0; ++bit, index >>= 1) {
+    if (index & 1) {
+      value ^= kSobolDirections.v[bit];
+    }
+  }
+
+  return value;
+}
+
+// Point i is the Sobol point of Gray code i (Antonov-Saleev order), so each
+// step flips a single direction number and any range can start anywhere
+long long count_sobol(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  const std::uint32_t seed_x = static_cast<std::uint32_t>(detail::mix_seed(seed));
+  const std::uint32_t seed_y = static_cast<std::uint32_t>(detail::mix_seed(seed ^ 0xA5A5A5A5A5A5A5A5ull));
+  const std::uint32_t gray = static_cast<std::uint32_t>(first ^ (first >> 1));
+  std::uint32_t x = reverse_bits(gray);
+  std::uint32_t y = sobol_dimension1(gray);
+  long long points_inside = 0;
+
+  for (std::uint64_t i = first; i < last; ++i) {
+    points_inside += detail::fixed_point_inside(owen_scramble(x, seed_x), owen_scramble(y, seed_y));
+    const int bit = trailing_zeros(i + 1);
+
+    if (bit < 32) {
+      x ^= 0x80000000u >> bit;
+      y ^= kSobolDirections.v[bit];
+    }
+  }
+
+  return points_inside;
+}
+
+// Radical inverse in base 3, as a 32-bit fraction
+std::uint32_t radical_inverse3(std::uint64_t index) {
+  double value = 0.0;
+  double digit_weight = 1.0 / 3.0;
+
+  while (index != 0) {
+    value += digit_weight * static_cast<double>(index % 3);
+    index /= 3;
+    digit_weight /= 3.0;
+  }
+
+  return static_cast<std::uint32_t>(std::min(value * 4294967296.0, 4294967295.0));
+}
+
+// Halton bases 2 and 3, randomised by a Cranley-Patterson rotation (a random shift modulo 1)
+long long count_halton(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  const std::uint64_t shift = detail::mix_seed(seed);
+  const std::uint32_t shift_x = static_cast<std::uint32_t>(shift);
+  const std::uint32_t shift_y = static_cast<std::uint32_t>(shift >> 32);
+  long long points_inside = 0;
+
+  for (std::uint64_t i = first; i < last; ++i) {
+    const std::uint32_t x = reverse_bits(static_cast<std::uint32_t>(i));
+    points_inside += detail::fixed_point_inside(x + shift_x, radical_inverse3(i) + shift_y);
+  }
+
+  return points_inside;
+}
+
+// R2 additive recurrence in exact 64-bit fixed point, randomised by a random start
+long long count_r2(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  std::uint64_t x = detail::mix_seed(seed) + first * kR2Alpha0;
+  std::uint64_t y = detail::mix_seed(seed ^ 0xA5A5A5A5A5A5A5A5ull) + first * kR2Alpha1;
+  long long points_inside = 0;
+
+  for (std::uint64_t i = first; i < last; ++i) {
+    points_inside += detail::fixed_point_inside(static_cast<std::uint32_t>(x >> 32), static_cast<std::uint32_t>(y >> 32));
+    x += kR2Alpha0;
+    y += kR2Alpha1;
+  }
+
+  return points_inside;
+}
+
+} // namespace
+
+const char *sequence_name(Sequence sequence) {
+  switch (sequence) {
+    case Sequence::Sobol:
+      return "sobol";
+
+    case Sequence::Halton:
+      return "halton";
+
+    case Sequence::R2:
+      return "r2";
+  }
+
+  return "unknown";
+}
+
+long long count_points_inside_qmc(Sequence sequence, std::uint64_t seed, long long first, long long last) {
+  if (first < 0 || last <= first) {
+    return 0;
+  }
+
+  if (sequence != Sequence::R2 && last > kMaxPoints32) {
+    throw std::invalid_argument("Sobol and Halton sequences are limited to 2^32 points per replica.");
+  }
+
+  const std::uint64_t begin = static_cast<std::uint64_t>(first);
+  const std::uint64_t end = static_cast<std::uint64_t>(last);
+
+  switch (sequence) {
+    case Sequence::Sobol:
+      return count_sobol(seed, begin, end);
+
+    case Sequence::Halton:
+      return count_halton(seed, begin, end);
+
+    case Sequence::R2:
+      return count_r2(seed, begin, end);
+  }
+
+  return 0;
+}
+
+QmcResult calculate_pi_qmc(long long num_points, Sequence sequence, int replicas, int num_threads, std::uint64_t seed) {
+  QmcResult result;
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  if (sequence != Sequence::R2 && num_points > kMaxPoints32) {
+    throw std::invalid_argument("Sobol and Halton sequences are limited to 2^32 points per replica.");
+  }
+
+  replicas = std::max(replicas, 1);
+  const int threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+  const long long blocks_per_replica = (num_points + kBlockSize - 1) / kBlockSize;
+  const long long num_items = blocks_per_replica * replicas;
+  std::vector<std::uint64_t> replica_seeds(replicas);
+  std::vector<long long> hits(replicas, 0);
+
+  for (int replica = 0; replica < replicas; ++replica) {
+    replica_seeds[replica] = detail::mix_seed(seed ^ detail::mix_seed(static_cast<std::uint64_t>(replica)));
+  }
+
+  // All replicas share one parallel loop, split into index blocks
+  #pragma omp parallel for schedule(static) num_threads(threads)
+
+  for (long long item = 0; item < num_items; ++item) {
+    const long long replica = item / blocks_per_replica;
+    const long long first = (item % blocks_per_replica) * kBlockSize;
+    const long long last = std::min(first + kBlockSize, num_points);
+    const long long block_hits = count_points_inside_qmc(sequence, replica_seeds[replica], first, last);
+    #pragma omp atomic
+    hits[replica] += block_hits;
+  }
+
+  double sum = 0.0;
+
+  for (long long replica_hits : hits) {
+    result.replica_estimates.push_back(4.0 * replica_hits / num_points);
+    sum += result.replica_estimates.back();
+  }
+
+  result.pi = sum / replicas;
+
+  if (replicas > 1) {
+    double squared_deviations = 0.0;
+
+    for (double estimate : result.replica_estimates) {
+      squared_deviations += (estimate - result.pi) * (estimate - result.pi);
+    }
+
+    result.standard_error = std::sqrt(squared_deviations / (replicas - 1) / replicas);
+  }
+
+  return result;
+}
+
+} // namespace monte_carlo_pi
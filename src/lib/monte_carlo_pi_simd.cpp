@@ -0,0 +1,498 @@
+#include "monte_carlo_pi_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define MONTE_CARLO_PI_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+
+// GCC and Clang need per-function target attributes to emit wider instructions than the build baseline
+#if defined(__GNUC__) || defined(__clang__)
+  #define MONTE_CARLO_PI_TARGET(isa) __attribute__((target(isa)))
+#else
+  #define MONTE_CARLO_PI_TARGET(isa)
+#endif
+
+namespace monte_carlo_pi {
+namespace detail {
+
+long long count_inside_scalar(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  const Philox4x32 philox(seed);
+  long long points_inside = 0;
+
+  for (std::uint64_t i = first; i < last; ++i) {
+    points_inside += point_inside(philox, i);
+  }
+
+  return points_inside;
+}
+
+long long count_inside_fixed_scalar(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  const Philox4x32 philox(seed);
+  long long points_inside = 0;
+
+  for (std::uint64_t counter = first_counter; counter < last_counter; ++counter) {
+    const Philox4x32::Counter bits = philox(counter);
+    points_inside += fixed_point_inside(bits[0], bits[1]);
+    points_inside += fixed_point_inside(bits[2], bits[3]);
+  }
+
+  return points_inside;
+}
+
+#ifdef MONTE_CARLO_PI_X86
+
+namespace {
+
+constexpr std::uint64_t kOneBits = 0x3FF0000000000000ull;  // bit pattern of 1.0
+constexpr std::uint64_t kSignBit = 0x8000000000000000ull;
+constexpr std::uint64_t kLowWord = 0x00000000FFFFFFFFull;
+
+// Philox key schedule, one key pair per round
+struct RoundKeys {
+  std::uint32_t k0[Philox4x32::kRounds];
+  std::uint32_t k1[Philox4x32::kRounds];
+
+  explicit RoundKeys(std::uint64_t seed) {
+    const Philox4x32::Key key = Philox4x32(seed).key();
+    k0[0] = key[0];
+    k1[0] = key[1];
+
+    for (int round = 1; round < Philox4x32::kRounds; ++round) {
+      k0[round] = k0[round - 1] + Philox4x32::kWeyl0;
+      k1[round] = k1[round - 1] + Philox4x32::kWeyl1;
+    }
+  }
+};
+
+// A vector step whose low counter word would wrap is handed to the scalar kernel
+inline bool low_word_wraps(std::uint64_t index, std::uint32_t lanes) {
+  return static_cast<std::uint32_t>(index) > 0xFFFFFFFFu - (lanes - 1);
+}
+
+// ---------------------------------------------------------------------------
+// SSE4.2: 4 counters per step
+// ---------------------------------------------------------------------------
+
+MONTE_CARLO_PI_TARGET("sse4.2")
+inline __m128i mulhilo_sse42(__m128i multiplier, __m128i value, __m128i *hi) {
+  const __m128i even = _mm_mul_epu32(multiplier, value);
+  const __m128i odd = _mm_mul_epu32(multiplier, _mm_srli_epi64(value, 32));
+  *hi = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+  return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+}
+
+MONTE_CARLO_PI_TARGET("sse4.2")
+inline void philox_rounds_sse42(const RoundKeys &keys, __m128i *c0, __m128i *c1, __m128i *c2, __m128i *c3) {
+  const __m128i m0 = _mm_set1_epi32(static_cast<int>(Philox4x32::kMultiplier0));
+  const __m128i m1 = _mm_set1_epi32(static_cast<int>(Philox4x32::kMultiplier1));
+
+  for (int round = 0; round < Philox4x32::kRounds; ++round) {
+    __m128i hi0;
+    __m128i hi1;
+    const __m128i lo0 = mulhilo_sse42(m0, *c0, &hi0);
+    const __m128i lo1 = mulhilo_sse42(m1, *c2, &hi1);
+    *c0 = _mm_xor_si128(_mm_xor_si128(hi1, *c1), _mm_set1_epi32(static_cast<int>(keys.k0[round])));
+    *c1 = lo1;
+    *c2 = _mm_xor_si128(_mm_xor_si128(hi0, *c3), _mm_set1_epi32(static_cast<int>(keys.k1[round])));
+    *c3 = lo0;
+  }
+}
+
+MONTE_CARLO_PI_TARGET("sse4.2")
+inline __m128i inside_mask_sse42(__m128i x_bits, __m128i y_bits) {
+  const __m128i exponent = _mm_set1_epi64x(static_cast<long long>(kOneBits));
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d x = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(x_bits, 12), exponent)), one);
+  const __m128d y = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(y_bits, 12), exponent)), one);
+  return _mm_castpd_si128(_mm_cmple_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)), one));
+}
+
+// Fixed-point carry test on the low 32 bits of each 64-bit lane (upper bits must be zero)
+MONTE_CARLO_PI_TARGET("sse4.2")
+inline __m128i fixed_outside_mask_sse42(__m128i x, __m128i y) {
+  const __m128i sign = _mm_set1_epi64x(static_cast<long long>(kSignBit));
+  const __m128i x_term = _mm_add_epi64(_mm_mul_epu32(x, x), x);
+  const __m128i sum = _mm_add_epi64(x_term, _mm_add_epi64(_mm_mul_epu32(y, y), y));
+  // Unsigned sum < x_term means the 64-bit sum carried out
+  return _mm_cmpgt_epi64(_mm_xor_si128(x_term, sign), _mm_xor_si128(sum, sign));
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 8 counters per step
+// ---------------------------------------------------------------------------
+
+MONTE_CARLO_PI_TARGET("avx2")
+inline __m256i mulhilo_avx2(__m256i multiplier, __m256i value, __m256i *hi) {
+  const __m256i even = _mm256_mul_epu32(multiplier, value);
+  const __m256i odd = _mm256_mul_epu32(multiplier, _mm256_srli_epi64(value, 32));
+  *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+  return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+MONTE_CARLO_PI_TARGET("avx2")
+inline void philox_rounds_avx2(const RoundKeys &keys, __m256i *c0, __m256i *c1, __m256i *c2, __m256i *c3) {
+  const __m256i m0 = _mm256_set1_epi32(static_cast<int>(Philox4x32::kMultiplier0));
+  const __m256i m1 = _mm256_set1_epi32(static_cast<int>(Philox4x32::kMultiplier1));
+
+  for (int round = 0; round < Philox4x32::kRounds; ++round) {
+    __m256i hi0;
+    __m256i hi1;
+    const __m256i lo0 = mulhilo_avx2(m0, *c0, &hi0);
+    const __m256i lo1 = mulhilo_avx2(m1, *c2, &hi1);
+    *c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, *c1), _mm256_set1_epi32(static_cast<int>(keys.k0[round])));
+    *c1 = lo1;
+    *c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, *c3), _mm256_set1_epi32(static_cast<int>(keys.k1[round])));
+    *c3 = lo0;
+  }
+}
+
+MONTE_CARLO_PI_TARGET("avx2")
+inline __m256i inside_mask_avx2(__m256i x_bits, __m256i y_bits) {
+  const __m256i exponent = _mm256_set1_epi64x(static_cast<long long>(kOneBits));
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d x = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(x_bits, 12), exponent)), one);
+  const __m256d y = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(y_bits, 12), exponent)), one);
+  return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y)), one, _CMP_LE_OQ));
+}
+
+MONTE_CARLO_PI_TARGET("avx2")
+inline __m256i fixed_outside_mask_avx2(__m256i x, __m256i y) {
+  const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(kSignBit));
+  const __m256i x_term = _mm256_add_epi64(_mm256_mul_epu32(x, x), x);
+  const __m256i sum = _mm256_add_epi64(x_term, _mm256_add_epi64(_mm256_mul_epu32(y, y), y));
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(x_term, sign), _mm256_xor_si256(sum, sign));
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512: 16 counters per step
+// ---------------------------------------------------------------------------
+
+MONTE_CARLO_PI_TARGET("avx512f")
+inline __m512i mulhilo_avx512(__m512i multiplier, __m512i value, __m512i *hi) {
+  const __m512i even = _mm512_mul_epu32(multiplier, value);
+  const __m512i odd = _mm512_mul_epu32(multiplier, _mm512_srli_epi64(value, 32));
+  *hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+  return _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+}
+
+MONTE_CARLO_PI_TARGET("avx512f")
+inline void philox_rounds_avx512(const RoundKeys &keys, __m512i *c0, __m512i *c1, __m512i *c2, __m512i *c3) {
+  const __m512i m0 = _mm512_set1_epi32(static_cast<int>(Philox4x32::kMultiplier0));
+  const __m512i m1 = _mm512_set1_epi32(static_cast<int>(Philox4x32::kMultiplier1));
+
+  for (int round = 0; round < Philox4x32::kRounds; ++round) {
+    __m512i hi0;
+    __m512i hi1;
+    const __m512i lo0 = mulhilo_avx512(m0, *c0, &hi0);
+    const __m512i lo1 = mulhilo_avx512(m1, *c2, &hi1);
+    *c0 = _mm512_xor_si512(_mm512_xor_si512(hi1, *c1), _mm512_set1_epi32(static_cast<int>(keys.k0[round])));
+    *c1 = lo1;
+    *c2 = _mm512_xor_si512(_mm512_xor_si512(hi0, *c3), _mm512_set1_epi32(static_cast<int>(keys.k1[round])));
+    *c3 = lo0;
+  }
+}
+
+MONTE_CARLO_PI_TARGET("avx512f")
+inline __mmask8 inside_mask_avx512(__m512i x_bits, __m512i y_bits) {
+  const __m512i exponent = _mm512_set1_epi64(static_cast<long long>(kOneBits));
+  const __m512d one = _mm512_set1_pd(1.0);
+  const __m512d x = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(x_bits, 12), exponent)), one);
+  const __m512d y = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(y_bits, 12), exponent)), one);
+  return _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(x, x), _mm512_mul_pd(y, y)), one, _CMP_LE_OQ);
+}
+
+MONTE_CARLO_PI_TARGET("avx512f")
+inline __mmask8 fixed_inside_mask_avx512(__m512i x, __m512i y) {
+  const __m512i x_term = _mm512_add_epi64(_mm512_mul_epu32(x, x), x);
+  const __m512i sum = _mm512_add_epi64(x_term, _mm512_add_epi64(_mm512_mul_epu32(y, y), y));
+  return _mm512_cmp_epu64_mask(sum, x_term, _MM_CMPINT_NLT);
+}
+
+} // namespace
+
+// Each kernel keeps the four Philox words of W counters in four registers (one
+// lane per counter), runs the ten rounds on all lanes at once, then pairs
+// words 0/1 into x and 2/3 into y with 32-bit unpacks. The unpacks reorder
+// lanes, which does not matter because only the number of hits is kept.
+
+MONTE_CARLO_PI_TARGET("sse4.2")
+long long count_inside_sse42(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  constexpr std::uint32_t kLanes = 4;
+  const RoundKeys keys(seed);
+  const __m128i lane_offsets = _mm_setr_epi32(0, 1, 2, 3);
+  __m128i hits = _mm_setzero_si128();
+  long long scalar_hits = 0;
+  std::uint64_t i = first;
+
+  for (; last - i >= kLanes; i += kLanes) {
+    if (low_word_wraps(i, kLanes)) {
+      scalar_hits += count_inside_scalar(seed, i, i + kLanes);
+      continue;
+    }
+
+    __m128i c0 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i))), lane_offsets);
+    __m128i c1 = _mm_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i >> 32)));
+    __m128i c2 = _mm_setzero_si128();
+    __m128i c3 = _mm_setzero_si128();
+
+    philox_rounds_sse42(keys, &c0, &c1, &c2, &c3);
+
+    // Inside lanes compare to all ones (-1), so subtracting the mask counts them
+    hits = _mm_sub_epi64(hits, inside_mask_sse42(_mm_unpacklo_epi32(c0, c1), _mm_unpacklo_epi32(c2, c3)));
+    hits = _mm_sub_epi64(hits, inside_mask_sse42(_mm_unpackhi_epi32(c0, c1), _mm_unpackhi_epi32(c2, c3)));
+  }
+
+  alignas(16) long long lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), hits);
+  return lanes[0] + lanes[1] + scalar_hits + count_inside_scalar(seed, i, last);
+}
+
+MONTE_CARLO_PI_TARGET("avx2")
+long long count_inside_avx2(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  constexpr std::uint32_t kLanes = 8;
+  const RoundKeys keys(seed);
+  const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i hits = _mm256_setzero_si256();
+  long long scalar_hits = 0;
+  std::uint64_t i = first;
+
+  for (; last - i >= kLanes; i += kLanes) {
+    if (low_word_wraps(i, kLanes)) {
+      scalar_hits += count_inside_scalar(seed, i, i + kLanes);
+      continue;
+    }
+
+    __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i))), lane_offsets);
+    __m256i c1 = _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i >> 32)));
+    __m256i c2 = _mm256_setzero_si256();
+    __m256i c3 = _mm256_setzero_si256();
+
+    philox_rounds_avx2(keys, &c0, &c1, &c2, &c3);
+
+    hits = _mm256_sub_epi64(hits, inside_mask_avx2(_mm256_unpacklo_epi32(c0, c1), _mm256_unpacklo_epi32(c2, c3)));
+    hits = _mm256_sub_epi64(hits, inside_mask_avx2(_mm256_unpackhi_epi32(c0, c1), _mm256_unpackhi_epi32(c2, c3)));
+  }
+
+  alignas(32) long long lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), hits);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + scalar_hits + count_inside_scalar(seed, i, last);
+}
+
+MONTE_CARLO_PI_TARGET("avx512f,popcnt")
+long long count_inside_avx512(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  constexpr std::uint32_t kLanes = 16;
+  const RoundKeys keys(seed);
+  const __m512i lane_offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  long long hits = 0;
+  std::uint64_t i = first;
+
+  for (; last - i >= kLanes; i += kLanes) {
+    if (low_word_wraps(i, kLanes)) {
+      hits += count_inside_scalar(seed, i, i + kLanes);
+      continue;
+    }
+
+    __m512i c0 = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i))), lane_offsets);
+    __m512i c1 = _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i >> 32)));
+    __m512i c2 = _mm512_setzero_si512();
+    __m512i c3 = _mm512_setzero_si512();
+
+    philox_rounds_avx512(keys, &c0, &c1, &c2, &c3);
+
+    // Compare masks are plain bitmasks here, so the hits are a popcount
+    hits += _mm_popcnt_u32(inside_mask_avx512(_mm512_unpacklo_epi32(c0, c1), _mm512_unpacklo_epi32(c2, c3)));
+    hits += _mm_popcnt_u32(inside_mask_avx512(_mm512_unpackhi_epi32(c0, c1), _mm512_unpackhi_epi32(c2, c3)));
+  }
+
+  return hits + count_inside_scalar(seed, i, last);
+}
+
+// The fixed-point kernels use the same Philox lanes, but every counter
+// carries two points: (word 0, word 1) and (word 2, word 3). Even 32-bit
+// lanes are masked down to their 64-bit slot and odd lanes shifted into it,
+// so no word is ever converted to floating point.
+
+MONTE_CARLO_PI_TARGET("sse4.2")
+long long count_inside_fixed_sse42(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  constexpr std::uint32_t kLanes = 4;
+  const RoundKeys keys(seed);
+  const __m128i lane_offsets = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128i low_word = _mm_set1_epi64x(static_cast<long long>(kLowWord));
+  __m128i outside = _mm_setzero_si128();
+  long long points_inside = 0;
+  std::uint64_t i = first_counter;
+
+  for (; last_counter - i >= kLanes; i += kLanes) {
+    if (low_word_wraps(i, kLanes)) {
+      points_inside += count_inside_fixed_scalar(seed, i, i + kLanes);
+      continue;
+    }
+
+    __m128i c0 = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i))), lane_offsets);
+    __m128i c1 = _mm_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i >> 32)));
+    __m128i c2 = _mm_setzero_si128();
+    __m128i c3 = _mm_setzero_si128();
+    philox_rounds_sse42(keys, &c0, &c1, &c2, &c3);
+    points_inside += 2 * kLanes;
+    outside = _mm_sub_epi64(outside, fixed_outside_mask_sse42(_mm_and_si128(c0, low_word), _mm_and_si128(c1, low_word)));
+    outside = _mm_sub_epi64(outside, fixed_outside_mask_sse42(_mm_srli_epi64(c0, 32), _mm_srli_epi64(c1, 32)));
+    outside = _mm_sub_epi64(outside, fixed_outside_mask_sse42(_mm_and_si128(c2, low_word), _mm_and_si128(c3, low_word)));
+    outside = _mm_sub_epi64(outside, fixed_outside_mask_sse42(_mm_srli_epi64(c2, 32), _mm_srli_epi64(c3, 32)));
+  }
+
+  alignas(16) long long lanes[2];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes), outside);
+  return points_inside - lanes[0] - lanes[1] + count_inside_fixed_scalar(seed, i, last_counter);
+}
+
+MONTE_CARLO_PI_TARGET("avx2")
+long long count_inside_fixed_avx2(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  constexpr std::uint32_t kLanes = 8;
+  const RoundKeys keys(seed);
+  const __m256i lane_offsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i low_word = _mm256_set1_epi64x(static_cast<long long>(kLowWord));
+  __m256i outside = _mm256_setzero_si256();
+  long long points_inside = 0;
+  std::uint64_t i = first_counter;
+
+  for (; last_counter - i >= kLanes; i += kLanes) {
+    if (low_word_wraps(i, kLanes)) {
+      points_inside += count_inside_fixed_scalar(seed, i, i + kLanes);
+      continue;
+    }
+
+    __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i))), lane_offsets);
+    __m256i c1 = _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i >> 32)));
+    __m256i c2 = _mm256_setzero_si256();
+    __m256i c3 = _mm256_setzero_si256();
+    philox_rounds_avx2(keys, &c0, &c1, &c2, &c3);
+    points_inside += 2 * kLanes;
+    outside = _mm256_sub_epi64(outside, fixed_outside_mask_avx2(_mm256_and_si256(c0, low_word), _mm256_and_si256(c1, low_word)));
+    outside = _mm256_sub_epi64(outside, fixed_outside_mask_avx2(_mm256_srli_epi64(c0, 32), _mm256_srli_epi64(c1, 32)));
+    outside = _mm256_sub_epi64(outside, fixed_outside_mask_avx2(_mm256_and_si256(c2, low_word), _mm256_and_si256(c3, low_word)));
+    outside = _mm256_sub_epi64(outside, fixed_outside_mask_avx2(_mm256_srli_epi64(c2, 32), _mm256_srli_epi64(c3, 32)));
+  }
+
+  alignas(32) long long lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), outside);
+  return points_inside - lanes[0] - lanes[1] - lanes[2] - lanes[3] + count_inside_fixed_scalar(seed, i, last_counter);
+}
+
+MONTE_CARLO_PI_TARGET("avx512f,popcnt")
+long long count_inside_fixed_avx512(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  constexpr std::uint32_t kLanes = 16;
+  const RoundKeys keys(seed);
+  const __m512i lane_offsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m512i low_word = _mm512_set1_epi64(static_cast<long long>(kLowWord));
+  long long points_inside = 0;
+  std::uint64_t i = first_counter;
+
+  for (; last_counter - i >= kLanes; i += kLanes) {
+    if (low_word_wraps(i, kLanes)) {
+      points_inside += count_inside_fixed_scalar(seed, i, i + kLanes);
+      continue;
+    }
+
+    __m512i c0 = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i))), lane_offsets);
+    __m512i c1 = _mm512_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(i >> 32)));
+    __m512i c2 = _mm512_setzero_si512();
+    __m512i c3 = _mm512_setzero_si512();
+    philox_rounds_avx512(keys, &c0, &c1, &c2, &c3);
+    points_inside += _mm_popcnt_u32(fixed_inside_mask_avx512(_mm512_and_si512(c0, low_word), _mm512_and_si512(c1, low_word)));
+    points_inside += _mm_popcnt_u32(fixed_inside_mask_avx512(_mm512_srli_epi64(c0, 32), _mm512_srli_epi64(c1, 32)));
+    points_inside += _mm_popcnt_u32(fixed_inside_mask_avx512(_mm512_and_si512(c2, low_word), _mm512_and_si512(c3, low_word)));
+    points_inside += _mm_popcnt_u32(fixed_inside_mask_avx512(_mm512_srli_epi64(c2, 32), _mm512_srli_epi64(c3, 32)));
+  }
+
+  return points_inside + count_inside_fixed_scalar(seed, i, last_counter);
+}
+
+SimdLevel detect_cpu_simd_level() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const bool sse42 = (info[2] & (1 << 20)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  const bool ymm_state = (xcr0 & 0x6) == 0x6;
+  const bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+  bool avx2 = false;
+  bool avx512f = false;
+
+  if (max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    avx2 = (info[1] & (1 << 5)) != 0;
+    avx512f = (info[1] & (1 << 16)) != 0;
+  }
+
+  if (avx512f && zmm_state) {
+    return SimdLevel::AVX512;
+  }
+
+  if (avx && avx2 && ymm_state) {
+    return SimdLevel::AVX2;
+  }
+
+  return sse42 ? SimdLevel::SSE42 : SimdLevel::Scalar;
+#else
+  // libgcc also checks that the OS saves the wider register state
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::AVX512;
+  }
+
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+    return SimdLevel::SSE42;
+  }
+
+  return SimdLevel::Scalar;
+#endif
+}
+
+#else
+
+// Non-x86 builds only have the portable kernel
+
+long long count_inside_sse42(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  return count_inside_scalar(seed, first, last);
+}
+
+long long count_inside_avx2(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  return count_inside_scalar(seed, first, last);
+}
+
+long long count_inside_avx512(std::uint64_t seed, std::uint64_t first, std::uint64_t last) {
+  return count_inside_scalar(seed, first, last);
+}
+
+long long count_inside_fixed_sse42(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  return count_inside_fixed_scalar(seed, first_counter, last_counter);
+}
+
+long long count_inside_fixed_avx2(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  return count_inside_fixed_scalar(seed, first_counter, last_counter);
+}
+
+long long count_inside_fixed_avx512(std::uint64_t seed, std::uint64_t first_counter, std::uint64_t last_counter) {
+  return count_inside_fixed_scalar(seed, first_counter, last_counter);
+}
+
+SimdLevel detect_cpu_simd_level() {
+  return SimdLevel::Scalar;
+}
+
+#endif // MONTE_CARLO_PI_X86
+
+} // namespace detail
+} // namespace monte_carlo_pi
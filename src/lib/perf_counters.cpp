@@ -0,0 +1,227 @@
+#include "perf_counters.h"
+#include "monte_carlo_engine.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace monte_carlo_pi {
+
+namespace {
+
+#if defined(__linux__)
+
+// Type and config of every HardwareEvent
+struct EventSpec {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+constexpr EventSpec kEventSpecs[kHardwareEventCount] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}
+};
+
+int open_event(const EventSpec &spec) {
+  perf_event_attr attr = {};
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+#endif
+
+// Counters of the sampling thread; begin and end hooks run on the same thread
+thread_local std::unique_ptr<PerfCounters> thread_counters;
+
+// Counters around each thread's share of the engine's block loop
+class CounterObserver : public ThreadObserver {
+ public:
+  void thread_begin(int thread) override {
+    (void)thread;
+    // Opening the counters stays outside the measured region
+    thread_counters.reset(new PerfCounters);
+    thread_counters->start();
+  }
+
+  void thread_end(int thread, long long points) override {
+    ThreadProfile profile;
+    profile.counters = thread_counters->stop();
+    profile.thread = thread;
+    profile.points = points;
+    thread_counters.reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    profiles_[thread] = profile;
+  }
+
+  // Profiles in thread order; the runtime may have given fewer threads than requested
+  std::vector<ThreadProfile> profiles() const {
+    std::vector<ThreadProfile> profiles;
+
+    for (const auto &entry : profiles_) {
+      profiles.push_back(entry.second);
+    }
+
+    return profiles;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<int, ThreadProfile> profiles_;
+};
+
+} // namespace
+
+const char *hardware_event_name(HardwareEvent event) {
+  switch (event) {
+    case HardwareEvent::Cycles:
+      return "cycles";
+
+    case HardwareEvent::Instructions:
+      return "instructions";
+
+    case HardwareEvent::BranchMisses:
+      return "branch_misses";
+
+    case HardwareEvent::L1dMisses:
+      return "l1d_misses";
+
+    case HardwareEvent::LlcMisses:
+      return "llc_misses";
+
+    case HardwareEvent::Count:
+      break;
+  }
+
+  return "unknown";
+}
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < kHardwareEventCount; ++i) {
+#if defined(__linux__)
+    fds_[i] = open_event(kEventSpecs[i]);
+#else
+    fds_[i] = -1;
+#endif
+  }
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+#endif
+}
+
+bool PerfCounters::supported() const {
+  return std::any_of(fds_, fds_ + kHardwareEventCount, [](int fd) {
+    return fd >= 0;
+  });
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+#endif
+}
+
+HardwareCounters PerfCounters::stop() {
+  HardwareCounters counters;
+#if defined(__linux__)
+
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+
+  for (int i = 0; i < kHardwareEventCount; ++i) {
+    // value, time enabled, time running
+    std::uint64_t data[3] = {};
+
+    if (fds_[i] < 0 || read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) {
+      continue;
+    }
+
+    // Extrapolate if the kernel had to multiplex the counter
+    counters.values[i] = data[2] < data[1] ? static_cast<std::uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : data[0];
+    counters.available[i] = true;
+  }
+
+#endif
+  return counters;
+}
+
+ProfiledEstimate generate_points_profiled(long long num_points, std::uint64_t seed) {
+  ProfiledEstimate result;
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  PerfCounters counters;
+  const auto start = std::chrono::steady_clock::now();
+  counters.start();
+  const std::pair<long long, long long> points = generate_points(num_points, seed);
+  ThreadProfile profile;
+  profile.counters = counters.stop();
+  result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  profile.points = points.second;
+  result.hits = points.first;
+  result.points = points.second;
+  result.estimate = 4.0 * result.hits / result.points;
+  result.total = profile.counters;
+  result.threads.push_back(profile);
+  return result;
+}
+
+ProfiledEstimate calculate_pi_parallel_profiled(long long num_points, const EstimateOptions &options) {
+  ProfiledEstimate result;
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  CounterObserver observer;
+  const auto start = std::chrono::steady_clock::now();
+  result.hits = detail::count_range_parallel(0, num_points, options, &observer);
+  result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.threads = observer.profiles();
+
+  for (const ThreadProfile &profile : result.threads) {
+    result.total.add(profile.counters, &profile == &result.threads.front());
+  }
+
+  result.points = num_points;
+  result.estimate = 4.0 * result.hits / num_points;
+  return result;
+}
+
+} // namespace monte_carlo_pi
@@ -0,0 +1,167 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include "monte_carlo_pi.h"
+#include <cstdint>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Hardware events collected around the sampling kernels
+ */
+enum class HardwareEvent {
+  Cycles,        ///< CPU cycles
+  Instructions,  ///< Retired instructions
+  BranchMisses,  ///< Mispredicted branches
+  L1dMisses,     ///< L1 data cache read misses
+  LlcMisses,     ///< Last-level cache misses
+  Count          ///< Number of events, not an event
+};
+
+/// Number of hardware events
+constexpr int kHardwareEventCount = static_cast<int>(HardwareEvent::Count);
+
+/**
+ * @brief Returns a short name of an event
+ * @param event Hardware event
+ * @return Name such as "cycles" or "llc_misses"
+ */
+const char *hardware_event_name(HardwareEvent event);
+
+/**
+ * @brief Counter values of one measured region; events the host cannot count are marked unavailable
+ */
+struct HardwareCounters {
+  std::uint64_t values[kHardwareEventCount] = {};  ///< Counts, scaled up if the kernel multiplexed the counter
+  bool available[kHardwareEventCount] = {};        ///< true for events that were counted
+
+  /**
+   * @brief Returns the count of one event
+   * @param event Hardware event
+   * @return Count, 0 if unavailable
+   */
+  std::uint64_t value(HardwareEvent event) const {
+    return values[static_cast<int>(event)];
+  }
+
+  /**
+   * @brief Checks whether an event was counted
+   * @param event Hardware event
+   * @return true if the value is valid
+   */
+  bool has(HardwareEvent event) const {
+    return available[static_cast<int>(event)];
+  }
+
+  /**
+   * @brief Adds the counts of another region; an event stays available only if it is in both
+   * @param other Counters to add
+   * @param first true if this is the first region added to an empty total
+   */
+  void add(const HardwareCounters &other, bool first) {
+    for (int i = 0; i < kHardwareEventCount; ++i) {
+      values[i] += other.values[i];
+      available[i] = (first || available[i]) && other.available[i];
+    }
+  }
+};
+
+/**
+ * @brief Counters of the calling thread, opened through Linux perf_event_open
+ *
+ * Each event is opened on its own, so an event the PMU or the
+ * perf_event_paranoid setting does not allow only drops that event. Only
+ * user-space execution is counted. On other platforms, or without any
+ * usable event, start and stop work but report nothing available.
+ */
+class PerfCounters {
+ public:
+  /**
+   * @brief Opens the counters for the calling thread, disabled
+   */
+  PerfCounters();
+
+  /**
+   * @brief Closes the counters
+   */
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  /**
+   * @brief Checks whether at least one event could be opened
+   * @return true if counting is supported
+   */
+  bool supported() const;
+
+  /**
+   * @brief Resets and enables the counters
+   */
+  void start();
+
+  /**
+   * @brief Disables the counters and reads them
+   * @return Counts since start
+   */
+  HardwareCounters stop();
+
+ private:
+  int fds_[kHardwareEventCount];
+};
+
+/**
+ * @brief Counters and share of the points of one thread
+ */
+struct ThreadProfile {
+  int thread = 0;             ///< OpenMP thread number
+  long long points = 0;       ///< Points sampled by the thread
+  HardwareCounters counters;  ///< Counters of the thread's share of the work
+};
+
+/**
+ * @brief Estimate together with the hardware counters of its sampling
+ */
+struct ProfiledEstimate {
+  double estimate = 0.0;               ///< Estimated value of Pi
+  long long points = 0;                ///< Points sampled
+  long long hits = 0;                  ///< Points inside the circle
+  double elapsed_seconds = 0.0;        ///< Wall-clock time of the sampling
+  HardwareCounters total;              ///< Sum over all threads
+  std::vector<ThreadProfile> threads;  ///< One entry per thread
+
+  /**
+   * @brief Returns an event count per sampled point
+   * @param event Hardware event
+   * @return Count per point, or a negative value if the event is unavailable
+   */
+  double per_point(HardwareEvent event) const {
+    return total.has(event) && points > 0 ? static_cast<double>(total.value(event)) / static_cast<double>(points) : -1.0;
+  }
+};
+
+/**
+ * @brief generate_points with the calling thread's counters around the kernel
+ * @param num_points Number of points to generate
+ * @param seed Seed of the counter-based point stream
+ * @return Estimate, hits and counters of the single thread
+ */
+ProfiledEstimate generate_points_profiled(long long num_points, std::uint64_t seed);
+
+/**
+ * @brief calculate_pi_parallel with counters around each thread's share of the blocks
+ *
+ * Runs calculate_pi_parallel's own block loop, including thread placement,
+ * with the counters started and stopped on every thread around its share,
+ * so the estimate is identical and the same code path is measured.
+ *
+ * @param num_points Number of points to generate
+ * @param options Thread count, seed, arithmetic and kernel level
+ * @return Estimate, hits and per-thread counters
+ */
+ProfiledEstimate calculate_pi_parallel_profiled(long long num_points, const EstimateOptions &options);
+
+} // namespace monte_carlo_pi
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,93 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Philox4x32-10 counter-based random number generator
+ *
+ * Maps a 128-bit counter and a 64-bit key to 128 random bits with ten
+ * multiply/xor rounds (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC'11). The generator has no sequential state, so any point of
+ * the stream can be produced directly from its index.
+ */
+class Philox4x32 {
+ public:
+  using Counter = std::array<std::uint32_t, 4>;
+  using Key = std::array<std::uint32_t, 2>;
+
+  static constexpr std::uint32_t kMultiplier0 = 0xD2511F53u;
+  static constexpr std::uint32_t kMultiplier1 = 0xCD9E8D57u;
+  static constexpr std::uint32_t kWeyl0 = 0x9E3779B9u;
+  static constexpr std::uint32_t kWeyl1 = 0xBB67AE85u;
+  static constexpr int kRounds = 10;
+
+  /**
+   * @brief Creates a generator keyed by a 64-bit seed
+   * @param seed Seed value, split into the two 32-bit key words
+   */
+  explicit Philox4x32(std::uint64_t seed)
+    : key_{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)} {
+  }
+
+  /**
+   * @brief Returns the key derived from the seed
+   * @return Two 32-bit key words
+   */
+  const Key &key() const {
+    return key_;
+  }
+
+  /**
+   * @brief Generates the 128 random bits for a full counter
+   * @param counter Counter block
+   * @return Four random 32-bit words
+   */
+  Counter operator()(const Counter &counter) const {
+    return generate(counter, key_);
+  }
+
+  /**
+   * @brief Generates the 128 random bits for a 64-bit stream index
+   * @param index Stream index, stored in the low two counter words
+   * @return Four random 32-bit words
+   */
+  Counter operator()(std::uint64_t index) const {
+    return generate({static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32), 0, 0}, key_);
+  }
+
+  /**
+   * @brief Applies the Philox4x32-10 bijection
+   * @param counter Counter block
+   * @param key Key words
+   * @return Four random 32-bit words
+   */
+  static Counter generate(Counter counter, Key key) {
+    for (int round = 0; round < kRounds; ++round) {
+      if (round > 0) {
+        key[0] += kWeyl0;
+        key[1] += kWeyl1;
+      }
+
+      const std::uint64_t product0 = static_cast<std::uint64_t>(kMultiplier0) * counter[0];
+      const std::uint64_t product1 = static_cast<std::uint64_t>(kMultiplier1) * counter[2];
+      counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                 static_cast<std::uint32_t>(product1),
+                 static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                 static_cast<std::uint32_t>(product0)
+                };
+    }
+
+    return counter;
+  }
+
+ private:
+  Key key_;
+};
+
+} // namespace monte_carlo_pi
+
+#endif // PHILOX_H
@@ -0,0 +1,81 @@
+#include "pi_estimator.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// Completion state shared by the chunks of one call
+struct Job {
+  std::atomic<long long> hits{0};
+  std::atomic<bool> finished{false};
+  std::mutex mutex;
+  std::condition_variable done;
+};
+
+} // namespace
+
+PiEstimator::PiEstimator(int num_threads, long long chunk_size)
+  : pool_(num_threads), chunk_size_(std::max(chunk_size, 1LL)) {
+}
+
+int PiEstimator::num_threads() const {
+  return pool_.size();
+}
+
+long long PiEstimator::count_points_inside(long long first, long long last, const EstimateOptions &options) {
+  if (first < 0 || last <= first) {
+    return 0;
+  }
+
+  const long long num_chunks = (last - first + chunk_size_ - 1) / chunk_size_;
+  const long long chunk_size = chunk_size_;
+  auto job = std::make_shared<Job>();
+  // Chunks are claimed on demand, so the queued tasks do not grow with the range
+  pool_.submit_indexed(num_chunks, [job, first, last, chunk_size, options](long long chunk) {
+    const long long chunk_first = first + chunk * chunk_size;
+    const long long chunk_last = std::min(chunk_first + chunk_size, last);
+    job->hits.fetch_add(monte_carlo_pi::count_points_inside(options.seed, chunk_first, chunk_last, options.arithmetic, options.simd_level),
+                        std::memory_order_relaxed);
+  }, [job] {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->finished.store(true);
+    job->done.notify_all();
+  });
+
+  // A worker that calls back into the estimator helps instead of blocking its own pool
+  if (pool_.is_worker_thread()) {
+    while (!job->finished.load()) {
+      if (!pool_.try_run_one()) {
+        std::this_thread::yield();
+      }
+    }
+  } else {
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->done.wait(lock, [&job] {
+      return job->finished.load();
+    });
+  }
+
+  return job->hits.load();
+}
+
+double PiEstimator::calculate_pi(long long num_points, const EstimateOptions &options) {
+  if (num_points <= 0) {
+    return 0.0;
+  }
+
+  return 4.0 * count_points_inside(0, num_points, options) / num_points;
+}
+
+double PiEstimator::calculate_pi(long long num_points, std::uint64_t seed) {
+  EstimateOptions options;
+  options.seed = seed;
+  return calculate_pi(num_points, options);
+}
+
+} // namespace monte_carlo_pi
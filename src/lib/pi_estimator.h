@@ -0,0 +1,71 @@
+#ifndef PI_ESTIMATOR_H
+#define PI_ESTIMATOR_H
+
+#include "monte_carlo_pi.h"
+#include "work_stealing_pool.h"
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Reusable Pi estimator that owns a persistent work-stealing pool
+ *
+ * Every call is split into fixed-size chunks of the seeded stream and run
+ * on the estimator's own workers, so no OpenMP or other process-wide state
+ * is touched per call. Chunks are claimed on demand by at most one queued
+ * task per worker, so memory does not grow with the point count.
+ * Concurrent callers share the workers: their chunks interleave in the
+ * deques and idle workers steal, which also keeps cores of different speed
+ * (P/E cores) evenly loaded. Results depend only on the seed and point
+ * count, never on the pool size or on other callers.
+ */
+class PiEstimator {
+ public:
+  /**
+   * @brief Creates the estimator and starts its workers
+   * @param num_threads Number of workers (0 for the hardware concurrency)
+   * @param chunk_size Points per task; smaller chunks balance better, larger ones cost less to schedule
+   */
+  explicit PiEstimator(int num_threads = 0, long long chunk_size = kDefaultChunkSize);
+
+  /**
+   * @brief Returns the number of worker threads
+   * @return Worker count
+   */
+  int num_threads() const;
+
+  /**
+   * @brief Counts the points of a stream index range inside the circle
+   * @param first Index of the first point (inclusive)
+   * @param last Index one past the last point (exclusive)
+   * @param options Seed, arithmetic and kernel level; num_threads is ignored
+   * @return Number of points in [first, last) inside the circle
+   */
+  long long count_points_inside(long long first, long long last, const EstimateOptions &options);
+
+  /**
+   * @brief Calculates Pi from the seeded stream
+   * @param num_points Number of points to generate
+   * @param options Seed, arithmetic and kernel level; num_threads is ignored
+   * @return Calculated Pi value
+   */
+  double calculate_pi(long long num_points, const EstimateOptions &options);
+
+  /**
+   * @brief Calculates Pi from the seeded stream with the default kernel
+   * @param num_points Number of points to generate
+   * @param seed Seed of the counter-based point stream
+   * @return Calculated Pi value
+   */
+  double calculate_pi(long long num_points, std::uint64_t seed);
+
+  /// Default number of points per task
+  static constexpr long long kDefaultChunkSize = 1 << 18;
+
+ private:
+  WorkStealingPool pool_;
+  long long chunk_size_;
+};
+
+} // namespace monte_carlo_pi
+
+#endif // PI_ESTIMATOR_H
@@ -0,0 +1,221 @@
+#include "result_cache.h"
+#include "monte_carlo_engine.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// First line of a saved cache; bump it whenever the Philox-to-point mapping or a kernel changes hit counts
+const char kFileVersion[] = "# monte_carlo_pi cache v1";
+
+// Samples [first, last) like calculate_pi_parallel with the default placement
+long long sample_range(long long first, long long last, const EstimateOptions &options) {
+  QuarterCircle f;
+  f.arithmetic = options.arithmetic;
+  f.simd_level = options.simd_level;
+  EngineOptions engine;
+  engine.num_threads = options.num_threads;
+  return sample_sum<2, long long>(f, PhiloxPoints(options.seed), first, last, engine);
+}
+
+} // namespace
+
+ResultCache::ResultCache(std::size_t max_entries) : max_entries_(std::max<std::size_t>(max_entries, 1)) {
+}
+
+void ResultCache::insert(const Segment &segment) {
+  for (const Segment &existing : segments_) {
+    // A concurrent request may have stored the same gap
+    if (existing.seed == segment.seed && existing.arithmetic == segment.arithmetic && existing.first == segment.first
+        && existing.last == segment.last) {
+      return;
+    }
+  }
+
+  segments_.push_front(segment);
+
+  while (segments_.size() > max_entries_) {
+    segments_.pop_back();
+    ++stats_.evictions;
+  }
+}
+
+long long ResultCache::count_points_inside(long long first, long long last, const EstimateOptions &options) {
+  if (first < 0 || last <= first) {
+    return 0;
+  }
+
+  long long hits = 0;
+  long long reused = 0;
+  std::vector<std::pair<long long, long long>> gaps;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.lookups;
+    // Usable segments of this stream, by start and then longest first
+    std::vector<std::list<Segment>::iterator> usable;
+
+    for (auto it = segments_.begin(); it != segments_.end(); ++it) {
+      if (it->seed == options.seed && it->arithmetic == options.arithmetic && it->first >= first && it->last <= last) {
+        usable.push_back(it);
+      }
+    }
+
+    std::sort(usable.begin(), usable.end(), [](std::list<Segment>::iterator a, std::list<Segment>::iterator b) {
+      return a->first != b->first ? a->first < b->first : a->last > b->last;
+    });
+
+    // Walk the range, taking the first segment that starts at or after the cursor
+    long long cursor = first;
+
+    for (std::list<Segment>::iterator it : usable) {
+      if (it->first < cursor) {
+        continue;
+      }
+
+      if (it->first > cursor) {
+        gaps.emplace_back(cursor, it->first);
+      }
+
+      hits += it->hits;
+      reused += it->last - it->first;
+      cursor = it->last;
+      segments_.splice(segments_.begin(), segments_, it);
+    }
+
+    if (cursor < last) {
+      gaps.emplace_back(cursor, last);
+    }
+
+    stats_.points_reused += reused;
+
+    if (reused == 0) {
+      ++stats_.misses;
+    } else if (gaps.empty()) {
+      ++stats_.full_hits;
+    } else {
+      ++stats_.partial_hits;
+    }
+  }
+
+  std::vector<Segment> computed;
+
+  for (const std::pair<long long, long long> &gap : gaps) {
+    const long long gap_hits = sample_range(gap.first, gap.second, options);
+    computed.push_back(Segment{options.seed, options.arithmetic, gap.first, gap.second, gap_hits});
+    hits += gap_hits;
+  }
+
+  if (!computed.empty()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const Segment &segment : computed) {
+      insert(segment);
+      stats_.points_computed += segment.last - segment.first;
+    }
+  }
+
+  return hits;
+}
+
+double ResultCache::calculate_pi(long long num_points, const EstimateOptions &options) {
+  if (num_points <= 0) {
+    return 0.0;
+  }
+
+  return 4.0 * count_points_inside(0, num_points, options) / num_points;
+}
+
+CacheStats ResultCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CacheStats stats = stats_;
+  stats.entries = segments_.size();
+  return stats;
+}
+
+void ResultCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  segments_.clear();
+  stats_ = CacheStats();
+}
+
+bool ResultCache::save(const std::string &path) const {
+  std::ofstream file(path);
+
+  if (!file) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  file << kFileVersion << '\n';
+  file << "# seed\tarithmetic\tfirst\tlast\thits\n";
+
+  for (const Segment &segment : segments_) {
+    file << segment.seed << '\t' << static_cast<int>(segment.arithmetic) << '\t' << segment.first << '\t' << segment.last << '\t'
+         << segment.hits << '\n';
+  }
+
+  file.close();
+  return !file.fail();
+}
+
+bool ResultCache::load(const std::string &path) {
+  std::ifstream file(path);
+
+  if (!file) {
+    return false;
+  }
+
+  std::vector<Segment> loaded;
+  std::string line;
+
+  // Counts saved by another version of the streams would be silently wrong
+  if (!std::getline(file, line) || line != kFileVersion) {
+    return false;
+  }
+
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    Segment segment;
+    int arithmetic;
+
+    if (!(fields >> segment.seed >> arithmetic >> segment.first >> segment.last >> segment.hits)
+        || (arithmetic != static_cast<int>(Arithmetic::Double) && arithmetic != static_cast<int>(Arithmetic::FixedPoint))
+        || segment.first < 0 || segment.last <= segment.first || segment.hits < 0 || segment.hits > segment.last - segment.first) {
+      return false;
+    }
+
+    segment.arithmetic = static_cast<Arithmetic>(arithmetic);
+    loaded.push_back(segment);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Behind the segments already held, in the file's recency order
+  for (const Segment &segment : loaded) {
+    if (segments_.size() >= max_entries_) {
+      break;
+    }
+
+    const bool known = std::any_of(segments_.begin(), segments_.end(), [&segment](const Segment &existing) {
+      return existing.seed == segment.seed && existing.arithmetic == segment.arithmetic && existing.first == segment.first
+             && existing.last == segment.last;
+    });
+
+    if (!known) {
+      segments_.push_back(segment);
+    }
+  }
+
+  return true;
+}
+
+} // namespace monte_carlo_pi
@@ -0,0 +1,117 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "monte_carlo_pi.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Counters of a ResultCache
+ */
+struct CacheStats {
+  long long lookups = 0;          ///< Ranges requested
+  long long full_hits = 0;        ///< Requests answered from cached segments alone
+  long long partial_hits = 0;     ///< Requests that reused some segments and sampled the rest
+  long long misses = 0;           ///< Requests that reused nothing
+  long long points_reused = 0;    ///< Points answered from the cache
+  long long points_computed = 0;  ///< Points sampled
+  long long evictions = 0;        ///< Segments dropped as least recently used
+  std::size_t entries = 0;        ///< Segments currently held
+};
+
+/**
+ * @brief In-process cache of hit counts of the counter-based point stream
+ *
+ * Hits are additive over disjoint index ranges of one (seed, arithmetic)
+ * stream, so a request reuses every cached segment that lies inside the
+ * requested range and samples only the gaps. Each sampled gap is stored as
+ * a new segment: after 10^9 and then 2 * 10^9 points the cache holds
+ * [0, 10^9) and [10^9, 2 * 10^9), and 4 * 10^9 points cost only
+ * [2 * 10^9, 4 * 10^9). Segments that overlap the request only partly are
+ * not used.
+ *
+ * The number of segments is bounded; the least recently used ones are
+ * evicted first. Each segment takes under 100 bytes, and a lookup scans all
+ * segments, which is negligible next to sampling. Sampling runs outside the
+ * lock, so concurrent requests proceed in parallel.
+ */
+class ResultCache {
+ public:
+  /**
+   * @brief Creates an empty cache
+   * @param max_entries Maximum number of segments held (at least 1)
+   */
+  explicit ResultCache(std::size_t max_entries = kDefaultMaxEntries);
+
+  /**
+   * @brief Counts the points of a stream index range inside the circle, reusing cached segments
+   * @param first Index of the first point (inclusive)
+   * @param last Index one past the last point (exclusive)
+   * @param options Seed and arithmetic select the stream; threads and kernel only affect the sampling speed
+   * @return Number of points in [first, last) inside the circle, identical to an uncached count
+   */
+  long long count_points_inside(long long first, long long last, const EstimateOptions &options);
+
+  /**
+   * @brief Calculates Pi from the first num_points points of the seeded stream
+   * @param num_points Number of points
+   * @param options Seed, arithmetic, threads and kernel
+   * @return The value calculate_pi_parallel(num_points, options) returns
+   */
+  double calculate_pi(long long num_points, const EstimateOptions &options);
+
+  /**
+   * @brief Returns the counters
+   * @return Statistics since construction or the last clear
+   */
+  CacheStats stats() const;
+
+  /**
+   * @brief Drops all segments and resets the counters
+   */
+  void clear();
+
+  /**
+   * @brief Writes the segments, most recently used first, as a tab-separated file
+   *
+   * The first line tags the file with the format version, which changes whenever the sampled streams do.
+   * @param path Output file
+   * @return true if the file was written
+   */
+  bool save(const std::string &path) const;
+
+  /**
+   * @brief Adds the segments of a file written by save, as least recently used
+   * @param path Input file
+   * @return true if the file was read, false if it is missing, malformed or of another version (the cache is then unchanged)
+   */
+  bool load(const std::string &path);
+
+  /// Default maximum number of segments
+  static constexpr std::size_t kDefaultMaxEntries = 4096;
+
+ private:
+  struct Segment {
+    std::uint64_t seed;
+    Arithmetic arithmetic;
+    long long first;
+    long long last;
+    long long hits;
+  };
+
+  void insert(const Segment &segment);
+
+  std::size_t max_entries_;
+  std::list<Segment> segments_;  // Most recently used first
+  CacheStats stats_;
+  mutable std::mutex mutex_;
+};
+
+} // namespace monte_carlo_pi
+
+#endif // RESULT_CACHE_H
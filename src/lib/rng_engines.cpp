@@ -0,0 +1,59 @@
+#include "rng_engines.h"
+#include <stdexcept>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+EngineOptions engine_options(const EstimateOptions &options) {
+  EngineOptions engine;
+  engine.num_threads = options.num_threads;
+  return engine;
+}
+
+long long count_philox(long long first, long long last, const EstimateOptions &options) {
+  QuarterCircle f;
+  f.arithmetic = options.arithmetic;
+  f.simd_level = options.simd_level;
+  return sample_sum<2, long long>(f, PhiloxPoints(options.seed), first, last, engine_options(options));
+}
+
+template<typename Generator>
+long long count_substreams(long long first, long long last, const EstimateOptions &options) {
+  return sample_sum<2, long long>(UnitBallIndicator<2>(), SubstreamPoints<Generator>(options.seed), first, last,
+                                  engine_options(options));
+}
+
+} // namespace
+
+const std::vector<RngEngine> &rng_engines() {
+  static const std::vector<RngEngine> engines = {
+    {"philox", "Philox4x32-10 counter-based stream with SIMD kernels", count_philox},
+    {"xoshiro256++", "xoshiro256++ 1.0, 256-bit state", count_substreams<Xoshiro256PlusPlus>},
+    {"pcg64", "PCG64 XSL-RR, 128-bit LCG", count_substreams<Pcg64>},
+    {"sfmt19937", "SIMD-oriented Fast Mersenne Twister, period 2^19937 - 1", count_substreams<Sfmt19937>}
+  };
+  return engines;
+}
+
+const RngEngine &find_rng_engine(const std::string &name) {
+  for (const RngEngine &engine : rng_engines()) {
+    if (name == engine.name) {
+      return engine;
+    }
+  }
+
+  throw std::invalid_argument("unknown random number engine: " + name);
+}
+
+double calculate_pi_with_engine(const std::string &engine, long long num_points, const EstimateOptions &options) {
+  const RngEngine &entry = find_rng_engine(engine);
+
+  if (num_points <= 0) {
+    return 0.0;
+  }
+
+  return 4.0 * entry.count_points_inside(0, num_points, options) / num_points;
+}
+
+} // namespace monte_carlo_pi
@@ -0,0 +1,480 @@
+#ifndef RNG_ENGINES_H
+#define RNG_ENGINES_H
+
+#include "monte_carlo_engine.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define MONTE_CARLO_PI_SFMT_SSE2 1
+#endif
+
+namespace monte_carlo_pi {
+
+namespace detail {
+
+/**
+ * @brief Maps a 64-bit random word onto [0, 1) with the exponent-bit trick
+ *
+ * The top 52 bits become the mantissa of a double in [1, 2), and 1.0 is
+ * subtracted; no division or integer-to-float conversion is needed. The
+ * result is identical to to_unit_double.
+ *
+ * @param bits Random word
+ * @return Uniform double in [0, 1)
+ */
+inline double bits_to_unit_double(std::uint64_t bits) {
+  const std::uint64_t one_to_two = (bits >> 12) | 0x3FF0000000000000ull;
+  double value;
+  std::memcpy(&value, &one_to_two, sizeof(value));
+  return value - 1.0;
+}
+
+/**
+ * @brief Rotates a 64-bit word left
+ * @param x Word
+ * @param k Rotation, 0 to 63
+ * @return Rotated word
+ */
+inline std::uint64_t rotate_left(std::uint64_t x, int k) {
+  return (x << k) | (x >> ((64 - k) & 63));
+}
+
+/**
+ * @brief Full 64 x 64 -> 128-bit product, portable
+ * @param a First factor
+ * @param b Second factor
+ * @param high Receives the upper 64 bits
+ * @return Lower 64 bits
+ */
+inline std::uint64_t multiply_wide(std::uint64_t a, std::uint64_t b, std::uint64_t *high) {
+  const std::uint64_t a_lo = a & 0xFFFFFFFFu;
+  const std::uint64_t a_hi = a >> 32;
+  const std::uint64_t b_lo = b & 0xFFFFFFFFu;
+  const std::uint64_t b_hi = b >> 32;
+  const std::uint64_t lo_lo = a_lo * b_lo;
+  const std::uint64_t hi_lo = a_hi * b_lo;
+  const std::uint64_t lo_hi = a_lo * b_hi;
+  const std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+  *high = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+  return (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+}
+
+} // namespace detail
+
+/**
+ * @brief xoshiro256++ 1.0 (Blackman and Vigna), 256-bit state
+ */
+class Xoshiro256PlusPlus {
+ public:
+  /**
+   * @brief Seeds the state from a seed and a stream number with SplitMix64
+   * @param seed Seed
+   * @param stream Independent stream of the same seed
+   */
+  explicit Xoshiro256PlusPlus(std::uint64_t seed, std::uint64_t stream = 0) {
+    const std::uint64_t base = seed ^ detail::mix_seed(stream);
+
+    for (int i = 0; i < 4; ++i) {
+      state_[i] = detail::mix_seed(base + static_cast<std::uint64_t>(i) * 0x9E3779B97F4A7C15ull);
+    }
+  }
+
+  /**
+   * @brief Uses a given state, which must not be all zero
+   * @param state Four state words
+   */
+  explicit Xoshiro256PlusPlus(const std::array<std::uint64_t, 4> &state) : state_(state) {
+  }
+
+  /**
+   * @brief Returns the next 64 random bits
+   * @return Random word
+   */
+  std::uint64_t operator()() {
+    const std::uint64_t result = detail::rotate_left(state_[0] + state_[3], 23) + state_[0];
+    const std::uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = detail::rotate_left(state_[3], 45);
+    return result;
+  }
+
+ private:
+  std::array<std::uint64_t, 4> state_;
+};
+
+/**
+ * @brief PCG64 (O'Neill): 128-bit LCG with the XSL-RR output function
+ *
+ * Equivalent to pcg64 / pcg_setseq_128_xsl_rr_64 of the reference
+ * implementation. The 128-bit arithmetic is written with 64-bit halves so
+ * that it also compiles where no 128-bit integer type exists.
+ */
+class Pcg64 {
+ public:
+  /**
+   * @brief Seeds like pcg64_srandom_r(initstate = seed, initseq = stream)
+   * @param seed Initial state
+   * @param stream Stream selector; every stream is a distinct sequence
+   */
+  explicit Pcg64(std::uint64_t seed, std::uint64_t stream = 0)
+    : increment_hi_(stream >> 63), increment_lo_((stream << 1) | 1u) {
+    step();
+    state_lo_ += seed;
+    state_hi_ += state_lo_ < seed ? 1u : 0u;
+    step();
+  }
+
+  /**
+   * @brief Returns the next 64 random bits
+   * @return Random word
+   */
+  std::uint64_t operator()() {
+    step();
+    return rotate_right(state_hi_ ^ state_lo_, static_cast<int>(state_hi_ >> 58));
+  }
+
+ private:
+  static constexpr std::uint64_t kMultiplierHi = 0x2360ED051FC65DA4ull;
+  static constexpr std::uint64_t kMultiplierLo = 0x4385DF649FCCF645ull;
+
+  static std::uint64_t rotate_right(std::uint64_t x, int k) {
+    return (x >> k) | (x << ((64 - k) & 63));
+  }
+
+  // state = state * multiplier + increment (mod 2^128)
+  void step() {
+    std::uint64_t high;
+    const std::uint64_t low = detail::multiply_wide(state_lo_, kMultiplierLo, &high);
+    high += state_hi_ * kMultiplierLo + state_lo_ * kMultiplierHi;
+    state_lo_ = low + increment_lo_;
+    state_hi_ = high + increment_hi_ + (state_lo_ < low ? 1u : 0u);
+  }
+
+  std::uint64_t state_hi_ = 0;
+  std::uint64_t state_lo_ = 0;
+  std::uint64_t increment_hi_;
+  std::uint64_t increment_lo_;
+};
+
+/**
+ * @brief SFMT19937, the SIMD-oriented Fast Mersenne Twister (Saito and Matsumoto)
+ *
+ * Produces the 64-bit output sequence of the reference SFMT 1.5 with
+ * MEXP = 19937. The state is regenerated 128 bits at a time, with SSE2 on
+ * x86-64 and with 32-bit lanes elsewhere.
+ */
+class Sfmt19937 {
+ public:
+  /**
+   * @brief Seeds like sfmt_init_gen_rand
+   * @param seed 32-bit seed
+   */
+  explicit Sfmt19937(std::uint32_t seed) {
+    state_[0] = seed;
+
+    for (int i = 1; i < kWords; ++i) {
+      state_[i] = 1812433253u * (state_[i - 1] ^ (state_[i - 1] >> 30)) + static_cast<std::uint32_t>(i);
+    }
+
+    certify_period();
+  }
+
+  /**
+   * @brief Seeds like sfmt_init_by_array with the key {seed, stream} as 32-bit words
+   * @param seed Seed
+   * @param stream Independent stream of the same seed
+   */
+  Sfmt19937(std::uint64_t seed, std::uint64_t stream) {
+    const std::uint32_t key[4] = {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                                  static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)
+                                 };
+    init_by_array(key, 4);
+  }
+
+  /**
+   * @brief Returns the next 64 random bits
+   * @return Random word
+   */
+  std::uint64_t operator()() {
+    if (index_ >= kWords) {
+      generate_all();
+      index_ = 0;
+    }
+
+    const std::uint64_t result = state_[index_] | (static_cast<std::uint64_t>(state_[index_ + 1]) << 32);
+    index_ += 2;
+    return result;
+  }
+
+ private:
+  static constexpr int kBlocks = 156;  // 128-bit words of state
+  static constexpr int kWords = 4 * kBlocks;
+  static constexpr int kPos1 = 122;
+  static constexpr int kSl1 = 18;
+  static constexpr int kSr1 = 11;
+  static constexpr std::uint32_t kMask[4] = {0xDFFFFFEFu, 0xDDFECB7Fu, 0xBFFAFFFFu, 0xBFFFFFF6u};
+  static constexpr std::uint32_t kParity[4] = {0x00000001u, 0x00000000u, 0x00000000u, 0x13C9E684u};
+
+  void init_by_array(const std::uint32_t *key, int key_length) {
+    const int lag = 11;
+    const int mid = (kWords - lag) / 2;
+    const int count = key_length + 1 > kWords ? key_length + 1 : kWords;
+    const auto func1 = [](std::uint32_t x) {
+      return (x ^ (x >> 27)) * 1664525u;
+    };
+    const auto func2 = [](std::uint32_t x) {
+      return (x ^ (x >> 27)) * 1566083941u;
+    };
+
+    for (std::uint32_t &word : state_) {
+      word = 0x8B8B8B8Bu;
+    }
+
+    std::uint32_t r = func1(state_[0] ^ state_[mid] ^ state_[kWords - 1]);
+    state_[mid] += r;
+    r += static_cast<std::uint32_t>(key_length);
+    state_[mid + lag] += r;
+    state_[0] = r;
+    int i = 1;
+
+    for (int j = 1; j < count; ++j) {
+      r = func1(state_[i] ^ state_[(i + mid) % kWords] ^ state_[(i + kWords - 1) % kWords]);
+      state_[(i + mid) % kWords] += r;
+      r += (j - 1 < key_length ? key[j - 1] : 0u) + static_cast<std::uint32_t>(i);
+      state_[(i + mid + lag) % kWords] += r;
+      state_[i] = r;
+      i = (i + 1) % kWords;
+    }
+
+    for (int j = 0; j < kWords; ++j) {
+      r = func2(state_[i] + state_[(i + mid) % kWords] + state_[(i + kWords - 1) % kWords]);
+      state_[(i + mid) % kWords] ^= r;
+      r -= static_cast<std::uint32_t>(i);
+      state_[(i + mid + lag) % kWords] ^= r;
+      state_[i] = r;
+      i = (i + 1) % kWords;
+    }
+
+    certify_period();
+  }
+
+  // Flips one bit if needed so that the period is 2^19937 - 1
+  void certify_period() {
+    std::uint32_t inner = 0;
+
+    for (int i = 0; i < 4; ++i) {
+      inner ^= state_[i] & kParity[i];
+    }
+
+    for (int shift = 16; shift > 0; shift >>= 1) {
+      inner ^= inner >> shift;
+    }
+
+    if ((inner & 1u) == 1u) {
+      return;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+      for (int bit = 0; bit < 32; ++bit) {
+        const std::uint32_t work = 1u << bit;
+
+        if ((work & kParity[i]) != 0) {
+          state_[i] ^= work;
+          return;
+        }
+      }
+    }
+  }
+
+#if defined(MONTE_CARLO_PI_SFMT_SSE2)
+
+  void generate_all() {
+    __m128i *blocks = reinterpret_cast<__m128i *>(state_);
+    const __m128i mask = _mm_set_epi32(static_cast<int>(kMask[3]), static_cast<int>(kMask[2]), static_cast<int>(kMask[1]),
+                                       static_cast<int>(kMask[0]));
+    __m128i r1 = _mm_load_si128(blocks + kBlocks - 2);
+    __m128i r2 = _mm_load_si128(blocks + kBlocks - 1);
+
+    for (int i = 0; i < kBlocks; ++i) {
+      const __m128i a = _mm_load_si128(blocks + i);
+      const __m128i b = _mm_load_si128(blocks + (i + kPos1) % kBlocks);
+      __m128i z = _mm_xor_si128(_mm_srli_si128(r1, 1), a);
+      z = _mm_xor_si128(z, _mm_slli_epi32(r2, kSl1));
+      z = _mm_xor_si128(z, _mm_slli_si128(a, 1));
+      z = _mm_xor_si128(z, _mm_and_si128(_mm_srli_epi32(b, kSr1), mask));
+      _mm_store_si128(blocks + i, z);
+      r1 = r2;
+      r2 = z;
+    }
+  }
+
+#else
+
+  void generate_all() {
+    int r1 = kBlocks - 2;
+    int r2 = kBlocks - 1;
+
+    for (int i = 0; i < kBlocks; ++i) {
+      std::uint32_t *a = state_ + 4 * i;
+      const std::uint32_t *b = state_ + 4 * ((i + kPos1) % kBlocks);
+      const std::uint32_t *c = state_ + 4 * r1;
+      const std::uint32_t *d = state_ + 4 * r2;
+      // 128-bit shifts by one byte: a << 8 and c >> 8
+      const std::uint32_t x[4] = {a[0] << 8, (a[1] << 8) | (a[0] >> 24), (a[2] << 8) | (a[1] >> 24), (a[3] << 8) | (a[2] >> 24)};
+      const std::uint32_t y[4] = {(c[0] >> 8) | (c[1] << 24), (c[1] >> 8) | (c[2] << 24), (c[2] >> 8) | (c[3] << 24), c[3] >> 8};
+
+      for (int lane = 0; lane < 4; ++lane) {
+        a[lane] = a[lane] ^ x[lane] ^ ((b[lane] >> kSr1) & kMask[lane]) ^ y[lane] ^ (d[lane] << kSl1);
+      }
+
+      r1 = r2;
+      r2 = i;
+    }
+  }
+
+#endif
+
+  alignas(16) std::uint32_t state_[kWords];
+  int index_ = kWords;
+};
+
+/**
+ * @brief Point source drawing from a sequential generator in fixed-length substreams
+ *
+ * Point i belongs to substream i / kSubstreamPoints, which is a generator
+ * constructed from (seed, substream). Each point takes one 64-bit draw per
+ * coordinate, turned into a double with the exponent-bit trick. Because
+ * the substreams are fixed, the points do not depend on the thread count
+ * or block size.
+ *
+ * @tparam Generator Engine constructible from (seed, stream) with a 64-bit operator()
+ */
+template<typename Generator>
+class SubstreamPoints {
+ public:
+  /// Points per substream, equal to the default block size of the engine
+  static constexpr long long kSubstreamPoints = 1 << 14;
+
+  /**
+   * @brief Creates the point source of a seed
+   * @param seed Seed of all substreams
+   */
+  explicit SubstreamPoints(std::uint64_t seed) : seed_(seed) {
+  }
+
+  /**
+   * @brief Creates the generator of one substream
+   * @param substream Substream number
+   * @return Generator positioned at the first point of the substream
+   */
+  Generator substream(long long substream) const {
+    return Generator(seed_, static_cast<std::uint64_t>(substream));
+  }
+
+  /**
+   * @brief Draws the next point from a generator
+   * @tparam Dimension Number of coordinates
+   * @param generator Generator of the current substream
+   * @return Coordinates in [0, 1)
+   */
+  template<int Dimension>
+  static std::array<double, Dimension> draw(Generator &generator) {
+    return draw<Dimension>(generator, std::make_index_sequence<Dimension>());
+  }
+
+ private:
+  template<int Dimension, std::size_t... I>
+  static std::array<double, Dimension> draw(Generator &generator, std::index_sequence<I...>) {
+    // Braced initialisers are evaluated left to right
+    return {{(static_cast<void>(I), detail::bits_to_unit_double(generator()))...}};
+  }
+
+  std::uint64_t seed_;
+};
+
+/**
+ * @brief Walks the substreams of a range sequentially instead of generating points by index
+ */
+template<int Dimension, typename Sum, typename Integrand, typename Generator>
+struct BlockKernel<Dimension, Sum, Integrand, SubstreamPoints<Generator>> {
+  static Sum run(const Integrand &f, const SubstreamPoints<Generator> &points, long long first, long long last) {
+    constexpr long long length = SubstreamPoints<Generator>::kSubstreamPoints;
+    Sum sum{};
+
+    for (long long begin = first; begin < last;) {
+      const long long substream = begin / length;
+      const long long end = std::min(last, (substream + 1) * length);
+      Generator generator = points.substream(substream);
+
+      // A range that starts inside a substream skips its earlier draws
+      for (long long skip = (begin - substream * length) * Dimension; skip > 0; --skip) {
+        generator();
+      }
+
+      for (long long i = begin; i < end; ++i) {
+        sum += f(SubstreamPoints<Generator>::template draw<Dimension>(generator));
+      }
+
+      begin = end;
+    }
+
+    return sum;
+  }
+};
+
+/**
+ * @brief Entry of the runtime generator registry
+ */
+struct RngEngine {
+  const char *name;         ///< Registry name, e.g. "pcg64"
+  const char *description;  ///< One-line description
+
+  /**
+   * Counts the quarter-circle hits of points [first, last) of the engine's
+   * stream for options.seed with options.num_threads threads
+   */
+  long long (*count_points_inside)(long long first, long long last, const EstimateOptions &options);
+};
+
+/**
+ * @brief Lists the registered generators
+ *
+ * "philox" is the counter-based stream of calculate_pi_parallel with its
+ * SIMD kernels; "xoshiro256++", "pcg64" and "sfmt19937" run the generic
+ * engine over SubstreamPoints.
+ *
+ * @return Registered generators
+ */
+const std::vector<RngEngine> &rng_engines();
+
+/**
+ * @brief Looks up a generator by name
+ * @param name Registry name
+ * @return Registry entry
+ * @throws std::invalid_argument if no generator has this name
+ */
+const RngEngine &find_rng_engine(const std::string &name);
+
+/**
+ * @brief Calculates Pi with a generator selected by name
+ * @param engine Registry name
+ * @param num_points Number of points to generate
+ * @param options Thread count and seed (and kernel settings for "philox")
+ * @return Calculated Pi value
+ * @throws std::invalid_argument if no generator has this name
+ */
+double calculate_pi_with_engine(const std::string &engine, long long num_points, const EstimateOptions &options = EstimateOptions());
+
+} // namespace monte_carlo_pi
+
+#endif // RNG_ENGINES_H
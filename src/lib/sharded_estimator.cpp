@@ -0,0 +1,474 @@
+#include "sharded_estimator.h"
+#include "pi_estimator.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define MONTE_CARLO_PI_POSIX 1
+  #include <poll.h>
+  #include <signal.h>
+  #include <sys/socket.h>
+  #include <sys/types.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+#endif
+
+namespace monte_carlo_pi {
+
+#if defined(MONTE_CARLO_PI_POSIX)
+
+namespace {
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Request: first, last, seed, arithmetic, kernel level. An empty range stops the worker.
+constexpr std::size_t kRequestWords = 5;
+
+// Reply: first, last, hits
+constexpr std::size_t kReplyWords = 3;
+
+// Writes words as little-endian 64-bit fields, so both ends may differ in byte order
+bool send_words(int fd, const std::uint64_t *words, std::size_t count) {
+  unsigned char buffer[8 * kRequestWords];
+
+  for (std::size_t i = 0; i < count; ++i) {
+    for (int byte = 0; byte < 8; ++byte) {
+      buffer[8 * i + byte] = static_cast<unsigned char>(words[i] >> (8 * byte));
+    }
+  }
+
+  std::size_t sent = 0;
+
+  while (sent < 8 * count) {
+    const ssize_t n = send(fd, buffer + sent, 8 * count - sent, kSendFlags);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (n <= 0) {
+      return false;
+    }
+
+    sent += static_cast<std::size_t>(n);
+  }
+
+  return true;
+}
+
+bool receive_words(int fd, std::uint64_t *words, std::size_t count) {
+  unsigned char buffer[8 * kRequestWords];
+  std::size_t received = 0;
+
+  while (received < 8 * count) {
+    const ssize_t n = recv(fd, buffer + received, 8 * count - received, 0);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (n <= 0) {
+      return false;
+    }
+
+    received += static_cast<std::size_t>(n);
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    words[i] = 0;
+
+    for (int byte = 0; byte < 8; ++byte) {
+      words[i] |= static_cast<std::uint64_t>(buffer[8 * i + byte]) << (8 * byte);
+    }
+  }
+
+  return true;
+}
+
+using Clock = std::chrono::steady_clock;
+
+// Connection to one worker; shard is -1 while the worker is idle
+struct WorkerLink {
+  int fd = -1;
+  pid_t pid = 0;
+  long long shard = -1;
+  Clock::time_point deadline;  // Reply due by then, if the run has a shard timeout
+};
+
+// Owns the worker connections and stops and reaps the workers on every exit path
+class WorkerSet {
+ public:
+  WorkerSet(int threads_per_worker, bool can_spawn)
+    : threads_per_worker_(threads_per_worker), can_spawn_(can_spawn) {
+  }
+
+  // A worker still on a shard would only read the stop request once it is done,
+  // and a hung one never is, so those are killed
+  ~WorkerSet() {
+    for (const WorkerLink &link : links_) {
+      stop(link, link.shard >= 0);
+    }
+  }
+
+  WorkerSet(const WorkerSet &) = delete;
+  WorkerSet &operator=(const WorkerSet &) = delete;
+
+  std::vector<WorkerLink> &links() {
+    return links_;
+  }
+
+  bool can_spawn() const {
+    return can_spawn_;
+  }
+
+  void adopt(int fd) {
+    WorkerLink link;
+    link.fd = fd;
+    links_.push_back(link);
+  }
+
+  // Forks a worker that serves shards on its end of a socket pair
+  void spawn() {
+    int ends[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) != 0) {
+      throw std::runtime_error("Cannot create a socket pair for a shard worker.");
+    }
+
+    const pid_t pid = fork();
+
+    if (pid < 0) {
+      close(ends[0]);
+      close(ends[1]);
+      throw std::runtime_error("Cannot start a shard worker process.");
+    }
+
+    if (pid == 0) {
+      // The child only keeps its own connection; it must not run OpenMP, whose
+      // runtime state does not survive fork, so it counts with its own threads
+      close(ends[0]);
+
+      for (const WorkerLink &link : links_) {
+        close(link.fd);
+      }
+
+      // An exception must not unwind into the parent's code in this process
+      try {
+        serve_shards(ends[1], threads_per_worker_);
+      } catch (...) {
+        _exit(1);
+      }
+
+      _exit(0);
+    }
+
+    close(ends[1]);
+    WorkerLink link;
+    link.fd = ends[0];
+    link.pid = pid;
+    links_.push_back(link);
+  }
+
+  // Drops a failed worker, killing it if it is still alive
+  void remove(std::size_t index) {
+    stop(links_[index], true);
+    links_.erase(links_.begin() + static_cast<std::ptrdiff_t>(index));
+  }
+
+ private:
+  static void stop(const WorkerLink &link, bool failed) {
+    if (failed && link.pid > 0) {
+      kill(link.pid, SIGKILL);
+    } else {
+      const std::uint64_t stop_request[kRequestWords] = {};
+      send_words(link.fd, stop_request, kRequestWords);
+    }
+
+    close(link.fd);
+
+    if (link.pid > 0) {
+      while (waitpid(link.pid, nullptr, 0) < 0 && errno == EINTR) {
+      }
+    }
+  }
+
+  std::vector<WorkerLink> links_;
+  int threads_per_worker_;
+  bool can_spawn_;
+};
+
+// Hands out shards, merges replies and requeues the shards of failed workers
+ShardedResult coordinate(long long num_points, const ShardOptions &options, WorkerSet *workers,
+                         const detail::ShardAssignHook &on_assign) {
+  ShardedResult result;
+
+  if (num_points <= 0) {
+    return result;
+  }
+
+  const long long shard_size = options.shard_size;
+  const long long num_shards = (num_points + shard_size - 1) / shard_size;
+  std::deque<long long> pending;
+  std::vector<int> attempts(static_cast<std::size_t>(num_shards), 0);
+  long long shards_done = 0;
+
+  for (long long shard = 0; shard < num_shards; ++shard) {
+    pending.push_back(shard);
+  }
+
+  result.shards = num_shards;
+  std::vector<WorkerLink> &links = workers->links();
+  const bool timed = options.shard_timeout > 0.0;
+  // Capped at about 30 years so the conversion to clock ticks cannot overflow
+  const auto timeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::min(options.shard_timeout, 1e9)));
+
+  const auto fail_worker = [&](std::size_t index) {
+    const long long shard = links[index].shard;
+    workers->remove(index);
+    ++result.lost_workers;
+
+    if (shard >= 0) {
+      if (attempts[static_cast<std::size_t>(shard)] >= options.max_attempts) {
+        throw std::runtime_error("Shard failed on every worker it was assigned to.");
+      }
+
+      pending.push_front(shard);
+      ++result.reassigned_shards;
+    }
+
+    if (workers->can_spawn()) {
+      workers->spawn();
+    }
+  };
+
+  while (shards_done < num_shards) {
+    // Give every idle worker the next shard
+    for (std::size_t i = 0; i < links.size() && !pending.empty();) {
+      if (links[i].shard >= 0) {
+        ++i;
+        continue;
+      }
+
+      const long long shard = pending.front();
+      pending.pop_front();
+      const long long first = shard * shard_size;
+      const std::uint64_t request[kRequestWords] = {
+        static_cast<std::uint64_t>(first),
+        static_cast<std::uint64_t>(std::min(first + shard_size, num_points)),
+        options.estimate.seed,
+        static_cast<std::uint64_t>(options.estimate.arithmetic),
+        static_cast<std::uint64_t>(options.estimate.simd_level)
+      };
+      links[i].shard = shard;
+      links[i].deadline = Clock::now() + timeout;
+      ++attempts[static_cast<std::size_t>(shard)];
+
+      if (on_assign) {
+        on_assign(static_cast<int>(links[i].pid), shard);
+      }
+
+      if (send_words(links[i].fd, request, kRequestWords)) {
+        ++i;
+      } else {
+        fail_worker(i);
+      }
+    }
+
+    if (links.empty()) {
+      throw std::runtime_error("All shard workers failed.");
+    }
+
+    std::vector<pollfd> polled;
+    // Wake up by the earliest deadline, so a hung worker cannot block the run
+    int wait_ms = -1;
+
+    for (const WorkerLink &link : links) {
+      pollfd entry = {};
+      entry.fd = link.fd;
+      entry.events = link.shard >= 0 ? POLLIN : 0;
+      polled.push_back(entry);
+
+      if (timed && link.shard >= 0) {
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(link.deadline - Clock::now()).count() + 1;
+        const int ms = static_cast<int>(std::max<long long>(0, std::min<long long>(remaining, 1 << 30)));
+        wait_ms = wait_ms < 0 ? ms : std::min(wait_ms, ms);
+      }
+    }
+
+    if (poll(polled.data(), static_cast<nfds_t>(polled.size()), wait_ms) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      throw std::runtime_error("Waiting for shard workers failed.");
+    }
+
+    // Walk backwards so removing a failed worker keeps the remaining indices valid
+    for (std::size_t i = polled.size(); i-- > 0;) {
+      if (polled[i].revents == 0) {
+        continue;
+      }
+
+      // An idle worker only reports a hang-up or an error
+      if (links[i].shard < 0) {
+        fail_worker(i);
+        continue;
+      }
+
+      const long long first = links[i].shard * shard_size;
+      const long long last = std::min(first + shard_size, num_points);
+      std::uint64_t reply[kReplyWords];
+
+      if (!receive_words(links[i].fd, reply, kReplyWords) || reply[0] != static_cast<std::uint64_t>(first)
+          || reply[1] != static_cast<std::uint64_t>(last) || reply[2] > static_cast<std::uint64_t>(last - first)) {
+        fail_worker(i);
+        continue;
+      }
+
+      result.hits += static_cast<long long>(reply[2]);
+      links[i].shard = -1;
+      ++shards_done;
+    }
+
+    // A worker past its deadline is treated like a dead one
+    if (timed) {
+      const Clock::time_point now = Clock::now();
+
+      for (std::size_t i = links.size(); i-- > 0;) {
+        if (links[i].shard >= 0 && now >= links[i].deadline) {
+          fail_worker(i);
+        }
+      }
+    }
+  }
+
+  result.points = num_points;
+  result.estimate = 4.0 * result.hits / num_points;
+  return result;
+}
+
+void check_options(const ShardOptions &options) {
+  if (options.shard_size <= 0 || options.max_attempts <= 0) {
+    throw std::invalid_argument("Shard size and attempt limit must be positive.");
+  }
+
+  if (!(options.shard_timeout >= 0.0)) {
+    throw std::invalid_argument("Shard timeout must not be negative.");
+  }
+}
+
+} // namespace
+
+namespace detail {
+
+ShardedResult calculate_pi_sharded(long long num_points, const ShardOptions &options, const ShardAssignHook &on_assign) {
+  check_options(options);
+
+  if (options.num_workers <= 0) {
+    throw std::invalid_argument("At least one shard worker is required.");
+  }
+
+  if (num_points <= 0) {
+    return ShardedResult();
+  }
+
+  WorkerSet workers(std::max(options.worker_threads, 1), true);
+  const long long num_shards = (num_points + options.shard_size - 1) / options.shard_size;
+
+  for (long long i = 0; i < std::min<long long>(options.num_workers, num_shards); ++i) {
+    workers.spawn();
+  }
+
+  return coordinate(num_points, options, &workers, on_assign);
+}
+
+} // namespace detail
+
+ShardedResult calculate_pi_sharded(long long num_points, const ShardOptions &options) {
+  return detail::calculate_pi_sharded(num_points, options, detail::ShardAssignHook());
+}
+
+ShardedResult calculate_pi_sharded(long long num_points, const ShardOptions &options, const std::vector<int> &worker_fds) {
+  WorkerSet workers(1, false);
+
+  for (int fd : worker_fds) {
+    workers.adopt(fd);
+  }
+
+  check_options(options);
+  return coordinate(num_points, options, &workers, detail::ShardAssignHook());
+}
+
+long long serve_shards(int fd, int num_threads) {
+  std::unique_ptr<PiEstimator> estimator;
+  long long served = 0;
+
+  if (num_threads != 1) {
+    estimator.reset(new PiEstimator(num_threads));
+  }
+
+  for (;;) {
+    std::uint64_t request[kRequestWords];
+
+    if (!receive_words(fd, request, kRequestWords)) {
+      return served;
+    }
+
+    const long long first = static_cast<long long>(request[0]);
+    const long long last = static_cast<long long>(request[1]);
+
+    if (first < 0 || last <= first || request[3] > static_cast<std::uint64_t>(Arithmetic::FixedPoint)
+        || request[4] > static_cast<std::uint64_t>(SimdLevel::AVX512)) {
+      return served;
+    }
+
+    EstimateOptions options;
+    options.seed = request[2];
+    options.arithmetic = static_cast<Arithmetic>(request[3]);
+    options.simd_level = static_cast<SimdLevel>(request[4]);
+    const long long hits = estimator ? estimator->count_points_inside(first, last, options)
+                           : count_points_inside(options.seed, first, last, options.arithmetic, options.simd_level);
+    const std::uint64_t reply[kReplyWords] = {request[0], request[1], static_cast<std::uint64_t>(hits)};
+
+    if (!send_words(fd, reply, kReplyWords)) {
+      return served;
+    }
+
+    ++served;
+  }
+}
+
+#else
+
+namespace detail {
+
+ShardedResult calculate_pi_sharded(long long, const ShardOptions &, const ShardAssignHook &) {
+  throw std::runtime_error("Sharded estimation requires a POSIX platform.");
+}
+
+} // namespace detail
+
+ShardedResult calculate_pi_sharded(long long, const ShardOptions &) {
+  throw std::runtime_error("Sharded estimation requires a POSIX platform.");
+}
+
+ShardedResult calculate_pi_sharded(long long, const ShardOptions &, const std::vector<int> &) {
+  throw std::runtime_error("Sharded estimation requires a POSIX platform.");
+}
+
+long long serve_shards(int, int) {
+  return 0;
+}
+
+#endif // MONTE_CARLO_PI_POSIX
+
+} // namespace monte_carlo_pi
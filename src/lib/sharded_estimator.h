@@ -0,0 +1,99 @@
+#ifndef SHARDED_ESTIMATOR_H
+#define SHARDED_ESTIMATOR_H
+
+#include "monte_carlo_pi.h"
+#include <functional>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Settings of a sharded multi-process estimate
+ */
+struct ShardOptions {
+  int num_workers = 2;               ///< Local worker processes to start
+  int worker_threads = 1;            ///< Threads per worker (1 counts on the worker's main thread)
+  long long shard_size = 1LL << 24;  ///< Points per shard
+  int max_attempts = 3;              ///< Assignments of one shard before the run fails
+  double shard_timeout = 60.0;       ///< Seconds a worker may take for one shard before it counts as failed (0 waits forever)
+  EstimateOptions estimate;          ///< Seed, arithmetic and kernel level; num_threads and placement are ignored
+};
+
+/**
+ * @brief Outcome of a sharded estimate
+ */
+struct ShardedResult {
+  double estimate = 0.0;      ///< Estimated value of Pi
+  long long points = 0;       ///< Points sampled
+  long long hits = 0;         ///< Points inside the circle
+  long long shards = 0;       ///< Shards the stream was cut into
+  int reassigned_shards = 0;  ///< Shards handed to another worker after a failure
+  int lost_workers = 0;       ///< Workers that died, timed out or broke the protocol
+};
+
+/**
+ * @brief Calculates Pi across local worker processes
+ *
+ * Shard k covers points [k * shard_size, (k + 1) * shard_size) of the seeded
+ * stream, so the shards never overlap and the merged estimate is
+ * bit-identical to calculate_pi_parallel with the same seed. Workers are
+ * forked from the calling process and exchange fixed-size little-endian
+ * messages with it over a socket pair. A shard whose worker dies or misses
+ * the shard timeout is put back in the queue, the worker is killed and a
+ * replacement is started. POSIX only.
+ *
+ * @param num_points Number of points to generate
+ * @param options Worker count, shard size, retry limit and stream settings
+ * @return Merged estimate and failure statistics
+ * @throws std::invalid_argument if the options are out of range
+ * @throws std::runtime_error if a shard fails max_attempts times or workers cannot be started
+ */
+ShardedResult calculate_pi_sharded(long long num_points, const ShardOptions &options);
+
+/**
+ * @brief Calculates Pi across already connected workers, such as remote nodes
+ *
+ * Each descriptor is a connected stream socket whose peer runs
+ * serve_shards. Shards of a failed or timed-out worker are reassigned to
+ * the survivors; no replacements are started. The descriptors are closed on return.
+ *
+ * @param num_points Number of points to generate
+ * @param options Shard size, retry limit and stream settings
+ * @param worker_fds Connected worker sockets
+ * @return Merged estimate and failure statistics
+ * @throws std::runtime_error if a shard fails max_attempts times or all workers fail
+ */
+ShardedResult calculate_pi_sharded(long long num_points, const ShardOptions &options, const std::vector<int> &worker_fds);
+
+/**
+ * @brief Runs the worker side of the shard protocol until the coordinator stops it
+ * @param fd Connected stream socket to the coordinator
+ * @param num_threads Counting threads (1 counts on the calling thread)
+ * @return Number of shards served
+ */
+long long serve_shards(int fd, int num_threads = 1);
+
+namespace detail {
+
+/**
+ * @brief Hook called whenever a shard is sent to a worker
+ *
+ * Receives the worker's process id (0 for connected workers) and the shard
+ * index. Used to inject worker failures in tests.
+ */
+using ShardAssignHook = std::function<void(int worker_pid, long long shard)>;
+
+/**
+ * @brief calculate_pi_sharded with local workers and an assignment hook
+ * @param num_points Number of points to generate
+ * @param options Worker count, shard size, retry limit and stream settings
+ * @param on_assign Hook called on every assignment, may be empty
+ * @return Merged estimate and failure statistics
+ */
+ShardedResult calculate_pi_sharded(long long num_points, const ShardOptions &options, const ShardAssignHook &on_assign);
+
+} // namespace detail
+
+} // namespace monte_carlo_pi
+
+#endif // SHARDED_ESTIMATOR_H
@@ -0,0 +1,172 @@
+#include "timing_harness.h"
+#include "mathUtility.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+double median_of(const std::vector<double> &values) {
+  return Can::Utility::MathUtility::calculateMedian(values.data(), static_cast<int>(values.size()));
+}
+
+} // namespace
+
+double percentile(const std::vector<double> &sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+
+  const double position = std::min(std::max(fraction, 0.0), 1.0) * static_cast<double>(sorted.size() - 1);
+  const std::size_t lower = static_cast<std::size_t>(position);
+  const std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+  return sorted[lower] + (position - static_cast<double>(lower)) * (sorted[upper] - sorted[lower]);
+}
+
+TimingStats summarize_times(const std::vector<double> &times, const TimingOptions &options) {
+  TimingStats stats;
+
+  if (times.empty()) {
+    return stats;
+  }
+
+  // Reject outliers by their modified z-score; with MAD = 0 every run is kept
+  const double median = median_of(times);
+  std::vector<double> deviations;
+
+  for (double time : times) {
+    deviations.push_back(std::abs(time - median));
+  }
+
+  const double mad = median_of(deviations);
+  std::vector<double> kept;
+
+  for (double time : times) {
+    if (options.outlier_threshold > 0.0 && mad > 0.0 && 0.6745 * std::abs(time - median) / mad > options.outlier_threshold) {
+      ++stats.outliers;
+    } else {
+      kept.push_back(time);
+    }
+  }
+
+  const Can::Utility::RunningMoments running = Can::Utility::MathUtility::calculateMoments(kept.data(), kept.size());
+  std::sort(kept.begin(), kept.end());
+  stats.runs = static_cast<int>(kept.size());
+  stats.mean = running.mean();
+  stats.std_dev = running.stdDev();
+  stats.min = running.min();
+  stats.max = running.max();
+  stats.median = percentile(kept, 0.5);
+  stats.p90 = percentile(kept, 0.9);
+  stats.p99 = percentile(kept, 0.99);
+  stats.ci_lower = stats.median;
+  stats.ci_upper = stats.median;
+
+  // Percentile bootstrap of the median
+  if (kept.size() > 1 && options.bootstrap_resamples > 0) {
+    std::mt19937_64 engine(options.bootstrap_seed);
+    std::uniform_int_distribution<std::size_t> pick(0, kept.size() - 1);
+    std::vector<double> medians;
+    std::vector<double> resample(kept.size());
+    medians.reserve(options.bootstrap_resamples);
+
+    for (int i = 0; i < options.bootstrap_resamples; ++i) {
+      for (double &value : resample) {
+        value = kept[pick(engine)];
+      }
+
+      medians.push_back(median_of(resample));
+    }
+
+    std::sort(medians.begin(), medians.end());
+    const double tail = (1.0 - options.confidence) / 2.0;
+    stats.ci_lower = percentile(medians, tail);
+    stats.ci_upper = percentile(medians, 1.0 - tail);
+  }
+
+  return stats;
+}
+
+bool save_baseline(const std::string &path, const std::map<std::string, TimingStats> &stats) {
+  std::ofstream file(path);
+
+  if (!file) {
+    return false;
+  }
+
+  file << "# name\truns\tmedian\tci_lower\tci_upper\tmean\tstd_dev\n" << std::setprecision(17);
+
+  for (const auto &entry : stats) {
+    const TimingStats &s = entry.second;
+    file << entry.first << '\t' << s.runs << '\t' << s.median << '\t' << s.ci_lower << '\t' << s.ci_upper << '\t'
+         << s.mean << '\t' << s.std_dev << '\n';
+  }
+
+  file.close();
+  return !file.fail();
+}
+
+bool load_baseline(const std::string &path, std::map<std::string, TimingStats> *stats) {
+  std::ifstream file(path);
+
+  if (!file) {
+    return false;
+  }
+
+  std::map<std::string, TimingStats> loaded;
+  std::string line;
+
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    const std::size_t tab = line.find('\t');
+
+    if (tab == std::string::npos) {
+      return false;
+    }
+
+    TimingStats s;
+    std::istringstream fields(line.substr(tab + 1));
+
+    if (!(fields >> s.runs >> s.median >> s.ci_lower >> s.ci_upper >> s.mean >> s.std_dev)) {
+      return false;
+    }
+
+    loaded[line.substr(0, tab)] = s;
+  }
+
+  *stats = loaded;
+  return true;
+}
+
+std::vector<RegressionCheck> compare_to_baseline(const std::map<std::string, TimingStats> &baseline,
+                                                 const std::map<std::string, TimingStats> &current, double min_slowdown) {
+  std::vector<RegressionCheck> checks;
+
+  for (const auto &entry : current) {
+    const auto found = baseline.find(entry.first);
+
+    if (found == baseline.end() || found->second.median <= 0.0) {
+      continue;
+    }
+
+    RegressionCheck check;
+    check.name = entry.first;
+    check.baseline_median = found->second.median;
+    check.current_median = entry.second.median;
+    check.ratio = check.current_median / check.baseline_median;
+    check.regression = entry.second.ci_lower > found->second.ci_upper && check.ratio > 1.0 + min_slowdown;
+    checks.push_back(check);
+  }
+
+  return checks;
+}
+
+} // namespace monte_carlo_pi
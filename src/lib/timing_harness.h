@@ -0,0 +1,137 @@
+#ifndef TIMING_HARNESS_H
+#define TIMING_HARNESS_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Settings of a timing measurement
+ */
+struct TimingOptions {
+  int warmup_runs = 2;               ///< Untimed runs before measuring (caches, page faults, frequency ramp-up)
+  int runs = 10;                     ///< Timed runs
+  double outlier_threshold = 3.5;    ///< Modified z-score above which a run is rejected (0 keeps all runs)
+  int bootstrap_resamples = 2000;    ///< Resamples of the bootstrap confidence interval
+  double confidence = 0.95;          ///< Level of the confidence interval of the median
+  std::uint64_t bootstrap_seed = 1;  ///< Seed of the bootstrap resampling, for reproducible intervals
+};
+
+/**
+ * @brief Robust summary of repeated timings, in seconds
+ */
+struct TimingStats {
+  int runs = 0;            ///< Runs kept after outlier rejection
+  int outliers = 0;        ///< Runs rejected as outliers
+  double mean = 0.0;       ///< Mean of the kept runs
+  double std_dev = 0.0;    ///< Standard deviation of the kept runs
+  double min = 0.0;        ///< Fastest kept run
+  double max = 0.0;        ///< Slowest kept run
+  double median = 0.0;     ///< Median of the kept runs
+  double p90 = 0.0;        ///< 90th percentile of the kept runs
+  double p99 = 0.0;        ///< 99th percentile of the kept runs
+  double ci_lower = 0.0;   ///< Lower bound of the bootstrap confidence interval of the median
+  double ci_upper = 0.0;   ///< Upper bound of the bootstrap confidence interval of the median
+};
+
+/**
+ * @brief Verdict of comparing one measurement with its baseline
+ */
+struct RegressionCheck {
+  std::string name;              ///< Measurement name
+  double baseline_median = 0.0;  ///< Median time of the baseline
+  double current_median = 0.0;   ///< Median time of the current run
+  double ratio = 1.0;            ///< current_median / baseline_median
+  bool regression = false;       ///< true for a statistically significant slowdown
+};
+
+/**
+ * @brief Returns a percentile of sorted samples with linear interpolation
+ * @param sorted Samples in ascending order
+ * @param fraction Percentile as a fraction in [0, 1]
+ * @return Interpolated percentile, 0 for no samples
+ */
+double percentile(const std::vector<double> &sorted, double fraction);
+
+/**
+ * @brief Summarises timings: rejects outliers, then computes moments, percentiles and a bootstrap interval
+ *
+ * Outliers are runs whose modified z-score 0.6745 * |x - median| / MAD
+ * exceeds options.outlier_threshold (Iglewicz and Hoaglin). The mean and
+ * standard deviation come from Can::Utility::MathUtility::calculateMoments.
+ *
+ * @param times Run times in seconds
+ * @param options Outlier threshold and bootstrap settings
+ * @return Summary of the kept runs
+ */
+TimingStats summarize_times(const std::vector<double> &times, const TimingOptions &options = TimingOptions());
+
+/**
+ * @brief Times a callable with warmup runs on a steady clock
+ * @param f Callable to time
+ * @param options Warmup, run count, outlier and bootstrap settings
+ * @return Summary of the timed runs
+ */
+template<typename Func>
+TimingStats measure_time(Func f, const TimingOptions &options = TimingOptions()) {
+  for (int i = 0; i < options.warmup_runs; ++i) {
+    f();
+  }
+
+  std::vector<double> times;
+  times.reserve(options.runs);
+
+  for (int i = 0; i < options.runs; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    times.push_back(std::chrono::duration<double>(end - start).count());
+  }
+
+  return summarize_times(times, options);
+}
+
+/**
+ * @brief Writes named timing summaries as a baseline file
+ *
+ * One line per measurement: name, runs, median, lower and upper bound of
+ * the median's confidence interval, mean and standard deviation. Names must
+ * not contain tabs or newlines.
+ *
+ * @param path Baseline file
+ * @param stats Summaries by name
+ * @return true if the file was written
+ */
+bool save_baseline(const std::string &path, const std::map<std::string, TimingStats> &stats);
+
+/**
+ * @brief Reads a baseline file written by save_baseline
+ * @param path Baseline file
+ * @param stats Receives the summaries by name
+ * @return true if the file was read, false if it is missing or malformed
+ */
+bool load_baseline(const std::string &path, std::map<std::string, TimingStats> *stats);
+
+/**
+ * @brief Flags measurements that became significantly slower than their baseline
+ *
+ * A measurement regresses when the confidence intervals of the two medians
+ * do not overlap (current lower bound above the baseline upper bound) and
+ * the median grew by more than min_slowdown. Names missing from either side
+ * are skipped.
+ *
+ * @param baseline Baseline summaries by name
+ * @param current Current summaries by name
+ * @param min_slowdown Relative slowdown to ignore even if significant (0.05 = 5%)
+ * @return One check per measurement present on both sides
+ */
+std::vector<RegressionCheck> compare_to_baseline(const std::map<std::string, TimingStats> &baseline,
+                                                 const std::map<std::string, TimingStats> &current, double min_slowdown = 0.05);
+
+} // namespace monte_carlo_pi
+
+#endif // TIMING_HARNESS_H
@@ -0,0 +1,193 @@
+#include "trace.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+namespace detail {
+
+std::atomic<bool> g_tracing_enabled{false};
+
+} // namespace detail
+
+namespace {
+
+// Spans kept per thread; a power of two so the ring index is a mask
+constexpr std::size_t kRingCapacity = 1 << 15;
+
+struct Span {
+  const char *name;
+  std::int64_t begin_ns;
+  std::int64_t end_ns;
+  long long arg;
+};
+
+// Written only by its owning thread; head is published with release so a
+// reader that acquires it sees every span below it. clear_trace only moves
+// tail, the first visible span, so it never races with the writer on head.
+struct RingBuffer {
+  explicit RingBuffer(int track) : spans(kRingCapacity), track(track) {
+  }
+
+  // Index of the oldest span still held
+  std::uint64_t first_visible(std::uint64_t head_index) const {
+    const std::uint64_t cleared = tail.load(std::memory_order_acquire);
+    const std::uint64_t oldest = head_index > kRingCapacity ? head_index - kRingCapacity : 0;
+    return cleared > oldest ? cleared : oldest;
+  }
+
+  std::vector<Span> spans;
+  std::atomic<std::uint64_t> head{0};
+  std::atomic<std::uint64_t> tail{0};
+  int track;
+};
+
+// Buffers live until the process exits, so spans of finished threads can
+// still be written; buffers of exited threads wait in free for a new thread
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<RingBuffer>> buffers;
+  std::vector<RingBuffer *> free;
+};
+
+// Never destroyed, so threads that exit after main still find it
+Registry &registry() {
+  static Registry *instance = new Registry;
+  return *instance;
+}
+
+// Returns the calling thread's buffer to the free list when the thread exits
+struct BufferOwner {
+  RingBuffer *buffer = nullptr;
+
+  ~BufferOwner() {
+    if (buffer != nullptr) {
+      Registry &r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.free.push_back(buffer);
+    }
+  }
+};
+
+const std::chrono::steady_clock::time_point &trace_epoch() {
+  static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  return epoch;
+}
+
+// The registry lock is taken once per thread, on its first span
+RingBuffer &thread_buffer() {
+  thread_local BufferOwner owner;
+
+  if (owner.buffer == nullptr) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    if (!r.free.empty()) {
+      owner.buffer = r.free.back();
+      r.free.pop_back();
+    } else {
+      r.buffers.emplace_back(new RingBuffer(static_cast<int>(r.buffers.size())));
+      owner.buffer = r.buffers.back().get();
+    }
+  }
+
+  return *owner.buffer;
+}
+
+} // namespace
+
+namespace detail {
+
+std::int64_t trace_clock_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch()).count();
+}
+
+void record_span(const char *name, std::int64_t begin_ns, std::int64_t end_ns, long long arg) {
+  RingBuffer &buffer = thread_buffer();
+  const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  buffer.spans[head & (kRingCapacity - 1)] = Span{name, begin_ns, end_ns, arg};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+void set_tracing_enabled(bool enabled) {
+  // Fix the epoch before the first span so timestamps never go negative
+  trace_epoch();
+  detail::g_tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void clear_trace() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+
+  for (const std::unique_ptr<RingBuffer> &buffer : r.buffers) {
+    buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+}
+
+std::size_t trace_span_count() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::size_t count = 0;
+
+  for (const std::unique_ptr<RingBuffer> &buffer : r.buffers) {
+    const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+    count += static_cast<std::size_t>(head - buffer->first_visible(head));
+  }
+
+  return count;
+}
+
+void write_chrome_trace(std::ostream &out) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  const std::ios_base::fmtflags flags = out.flags();
+  const std::streamsize precision = out.precision();
+  bool first = true;
+  out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  out << std::fixed << std::setprecision(3);
+
+  for (const std::unique_ptr<RingBuffer> &buffer : r.buffers) {
+    const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const std::uint64_t begin = buffer->first_visible(head);
+
+    if (begin == head) {
+      continue;
+    }
+
+    out << (first ? "\n" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->track
+        << ", \"args\": {\"name\": \"thread " << buffer->track << "\"}}";
+    first = false;
+
+    // Oldest surviving span first
+    for (std::uint64_t i = begin; i < head; ++i) {
+      const Span &span = buffer->spans[i & (kRingCapacity - 1)];
+      out << ",\n  {\"name\": \"" << span.name << "\", \"cat\": \"monte_carlo_pi\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+          << buffer->track << ", \"ts\": " << span.begin_ns / 1000.0 << ", \"dur\": " << (span.end_ns - span.begin_ns) / 1000.0
+          << ", \"args\": {\"arg\": " << span.arg << "}}";
+    }
+  }
+
+  out << "\n]}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+bool write_chrome_trace(const std::string &path) {
+  std::ofstream file(path);
+
+  if (!file) {
+    return false;
+  }
+
+  write_chrome_trace(file);
+  file.close();
+  return !file.fail();
+}
+
+} // namespace monte_carlo_pi
@@ -0,0 +1,108 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "trace_control.h"
+#include <atomic>
+#include <cstdint>
+
+// Trace points for library code. Code that only switches tracing or exports
+// it, such as the C++/CLI application, includes trace_control.h instead.
+
+namespace monte_carlo_pi {
+
+namespace detail {
+
+/// Runtime switch read by every trace point
+extern std::atomic<bool> g_tracing_enabled;
+
+/**
+ * @brief Returns nanoseconds on the steady clock since the trace epoch
+ * @return Timestamp of the trace clock
+ */
+std::int64_t trace_clock_ns();
+
+/**
+ * @brief Appends a finished span to the calling thread's ring buffer
+ * @param name Span name with static storage duration
+ * @param begin_ns Start on the trace clock
+ * @param end_ns End on the trace clock
+ * @param arg Numeric argument shown with the span (e.g. first point of a block)
+ */
+void record_span(const char *name, std::int64_t begin_ns, std::int64_t end_ns, long long arg);
+
+} // namespace detail
+
+/**
+ * @brief Checks whether tracing is on
+ * @return true if spans are recorded
+ */
+inline bool tracing_enabled() {
+  return detail::g_tracing_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns a timestamp for trace_since
+ * @return Current trace clock in nanoseconds, or -1 while tracing is off
+ */
+inline std::int64_t trace_now() {
+  return tracing_enabled() ? detail::trace_clock_ns() : -1;
+}
+
+/**
+ * @brief Records a span of the calling thread from a timestamp until now
+ *
+ * Covers intervals that start on another thread, such as the delay between
+ * opening a parallel region and a worker entering it.
+ *
+ * @param name Span name with static storage duration
+ * @param begin_ns Timestamp from trace_now; -1 records nothing
+ * @param arg Numeric argument shown with the span
+ */
+inline void trace_since(const char *name, std::int64_t begin_ns, long long arg = 0) {
+  if (begin_ns >= 0) {
+    detail::record_span(name, begin_ns, detail::trace_clock_ns(), arg);
+  }
+}
+
+/**
+ * @brief Records the lifetime of a scope as a span of the calling thread
+ *
+ * Each thread writes into its own fixed-size ring buffer without locks; once
+ * a buffer is full the oldest spans of that thread are overwritten. When
+ * the thread exits, its buffer, spans included, is handed to the next new
+ * thread that traces, so short-lived threads do not add memory. The switch
+ * is sampled at construction, so a scope that began while tracing was on is
+ * always completed.
+ */
+class TraceScope {
+ public:
+  /**
+   * @brief Starts a span if tracing is on
+   * @param name Span name with static storage duration, such as a string literal
+   * @param arg Numeric argument shown with the span
+   */
+  explicit TraceScope(const char *name, long long arg = 0)
+    : name_(name), arg_(arg), begin_ns_(tracing_enabled() ? detail::trace_clock_ns() : -1) {
+  }
+
+  /**
+   * @brief Ends the span
+   */
+  ~TraceScope() {
+    if (begin_ns_ >= 0) {
+      detail::record_span(name_, begin_ns_, detail::trace_clock_ns(), arg_);
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+ private:
+  const char *name_;
+  long long arg_;
+  std::int64_t begin_ns_;
+};
+
+} // namespace monte_carlo_pi
+
+#endif // TRACE_H
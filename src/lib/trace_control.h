@@ -0,0 +1,58 @@
+#ifndef TRACE_CONTROL_H
+#define TRACE_CONTROL_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Enables or disables tracing for all threads
+ *
+ * While tracing is off a trace point costs one relaxed atomic load and a
+ * predictable branch; no clock is read and nothing is written. This header
+ * holds only the control and export functions and includes no <atomic>, so
+ * C++/CLI code can use it; the trace points themselves are in trace.h.
+ *
+ * @param enabled true to record spans
+ */
+void set_tracing_enabled(bool enabled);
+
+/**
+ * @brief Discards the recorded spans of all threads
+ *
+ * Safe while other threads trace: only the spans published before the call
+ * are dropped, and a span being recorded meanwhile is kept.
+ */
+void clear_trace();
+
+/**
+ * @brief Returns the number of spans currently held in the ring buffers
+ * @return Span count over all threads
+ */
+std::size_t trace_span_count();
+
+/**
+ * @brief Writes the recorded spans as Chrome trace event JSON
+ *
+ * The output loads in chrome://tracing and ui.perfetto.dev. Every span is a
+ * complete ("X") event with microsecond timestamps. Each ring buffer gets
+ * its own track; a buffer freed by an exited thread is reused by the next
+ * new thread, so a track may hold the spans of several threads one after
+ * another. Must not run concurrently with traced work.
+ *
+ * @param out Stream to write to
+ */
+void write_chrome_trace(std::ostream &out);
+
+/**
+ * @brief Writes the recorded spans as Chrome trace event JSON to a file
+ * @param path Output file
+ * @return true if the file was written
+ */
+bool write_chrome_trace(const std::string &path);
+
+} // namespace monte_carlo_pi
+
+#endif // TRACE_CONTROL_H
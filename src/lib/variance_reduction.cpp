@@ -0,0 +1,225 @@
+#include "variance_reduction.h"
+#include "monte_carlo_engine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// Mean of the control (x^2 + y^2)^2 over the unit square: 1/5 + 2/9 + 1/5
+constexpr double kControlMean = 28.0 / 45.0;
+
+// 4 * indicator of the quarter circle, the plain per-point estimator of Pi
+double pi_sample(double x, double y) {
+  return x * x + y * y <= 1.0 ? 4.0 : 0.0;
+}
+
+// Point source placing the coordinate pairs of point c jittered inside cell c of an m x m grid
+class StratifiedPoints {
+ public:
+  StratifiedPoints(std::uint64_t seed, long long cells_per_side) : points_(seed), cells_per_side_(cells_per_side) {
+  }
+
+  template<int Dimension>
+  std::array<double, Dimension> point(std::uint64_t cell) const {
+    std::array<double, Dimension> x = points_.point<Dimension>(cell);
+    const double scale = 1.0 / static_cast<double>(cells_per_side_);
+    const double column = static_cast<double>(static_cast<long long>(cell) % cells_per_side_);
+    const double row = static_cast<double>(static_cast<long long>(cell) / cells_per_side_);
+
+    for (int i = 0; i < Dimension; ++i) {
+      x[i] = ((i % 2 == 0 ? column : row) + x[i]) * scale;
+    }
+
+    return x;
+  }
+
+ private:
+  PhiloxPoints points_;
+  long long cells_per_side_;
+};
+
+// Cell mean and unbiased variance estimate of the cell mean from its two points
+struct StratumSample {
+  double mean;
+  double mean_variance;
+};
+
+struct StratumSums {
+  double sum = 0.0;
+  double sum_variance = 0.0;
+
+  StratumSums &operator+=(const StratumSample &sample) {
+    sum += sample.mean;
+    sum_variance += sample.mean_variance;
+    return *this;
+  }
+
+  StratumSums &operator+=(const StratumSums &other) {
+    sum += other.sum;
+    sum_variance += other.sum_variance;
+    return *this;
+  }
+};
+
+struct StratumIntegrand {
+  StratumSample operator()(const std::array<double, 4> &x) const {
+    const double first = pi_sample(x[0], x[1]);
+    const double second = pi_sample(x[2], x[3]);
+    // s^2 = (a - b)^2 / 2 of the two points, divided by 2 for the variance of their mean
+    return StratumSample{(first + second) / 2.0, (first - second) * (first - second) / 4.0};
+  }
+};
+
+struct AntitheticIntegrand {
+  double operator()(const std::array<double, 2> &x) const {
+    return (pi_sample(x[0], x[1]) + pi_sample(1.0 - x[0], 1.0 - x[1])) / 2.0;
+  }
+};
+
+// Sample of the estimator f and the control g
+struct ControlSample {
+  double f;
+  double g;
+};
+
+struct ControlSums {
+  double f = 0.0;
+  double g = 0.0;
+  double ff = 0.0;
+  double gg = 0.0;
+  double fg = 0.0;
+
+  ControlSums &operator+=(const ControlSample &sample) {
+    f += sample.f;
+    g += sample.g;
+    ff += sample.f * sample.f;
+    gg += sample.g * sample.g;
+    fg += sample.f * sample.g;
+    return *this;
+  }
+
+  ControlSums &operator+=(const ControlSums &other) {
+    f += other.f;
+    g += other.g;
+    ff += other.ff;
+    gg += other.gg;
+    fg += other.fg;
+    return *this;
+  }
+};
+
+struct ControlIntegrand {
+  ControlSample operator()(const std::array<double, 2> &x) const {
+    // Of the powers of x^2 + y^2 the square correlates best with the indicator (rho^2 about 0.67)
+    const double r2 = x[0] * x[0] + x[1] * x[1];
+    return ControlSample{pi_sample(x[0], x[1]), r2 * r2};
+  }
+};
+
+// Unbiased sample variance from n samples with the given sum and sum of squares
+double sample_variance(double sum, double sum_squares, double n) {
+  return n > 1.0 ? std::max(sum_squares - sum * sum / n, 0.0) / (n - 1.0) : 0.0;
+}
+
+} // namespace
+
+const char *variance_reduction_name(VarianceReduction mode) {
+  switch (mode) {
+    case VarianceReduction::None:
+      return "none";
+
+    case VarianceReduction::Stratified:
+      return "stratified";
+
+    case VarianceReduction::Antithetic:
+      return "antithetic";
+
+    case VarianceReduction::ControlVariate:
+      return "control_variate";
+  }
+
+  return "unknown";
+}
+
+VarianceReducedResult calculate_pi_variance_reduced(long long num_points, VarianceReduction mode, const EstimateOptions &options) {
+  VarianceReducedResult result;
+  EngineOptions engine;
+  engine.num_threads = options.num_threads;
+  const PhiloxPoints points(options.seed);
+  double estimator_variance = 0.0;
+
+  switch (mode) {
+    case VarianceReduction::None: {
+      if (num_points < 2) {
+        return result;
+      }
+
+      const Moments moments = sample_sum<2, Moments>([](const std::array<double, 2> &x) {
+        return pi_sample(x[0], x[1]);
+      }, points, 0, num_points, engine);
+      result.points = num_points;
+      result.estimate = moments.mean();
+      estimator_variance = moments.variance() / static_cast<double>(num_points);
+      break;
+    }
+
+    case VarianceReduction::Stratified: {
+      const long long side = static_cast<long long>(std::sqrt(static_cast<double>(std::max(num_points, 0LL) / 2)));
+
+      if (side < 1) {
+        return result;
+      }
+
+      const long long cells = side * side;
+      const StratumSums sums = sample_sum<4, StratumSums>(StratumIntegrand(), StratifiedPoints(options.seed, side), 0, cells, engine);
+      const double m = static_cast<double>(cells);
+      result.points = 2 * cells;
+      result.estimate = sums.sum / m;
+      estimator_variance = sums.sum_variance / (m * m);
+      break;
+    }
+
+    case VarianceReduction::Antithetic: {
+      const long long pairs = num_points / 2;
+
+      if (pairs < 2) {
+        return result;
+      }
+
+      const Moments moments = sample_sum<2, Moments>(AntitheticIntegrand(), points, 0, pairs, engine);
+      result.points = 2 * pairs;
+      result.estimate = moments.mean();
+      estimator_variance = moments.variance() / static_cast<double>(pairs);
+      break;
+    }
+
+    case VarianceReduction::ControlVariate: {
+      if (num_points < 3) {
+        return result;
+      }
+
+      const ControlSums sums = sample_sum<2, ControlSums>(ControlIntegrand(), points, 0, num_points, engine);
+      const double n = static_cast<double>(num_points);
+      const double var_f = sample_variance(sums.f, sums.ff, n);
+      const double var_g = sample_variance(sums.g, sums.gg, n);
+      const double cov = (sums.fg - sums.f * sums.g / n) / (n - 1.0);
+      // Fitted coefficient; its O(1/n) bias is negligible next to the standard error
+      const double beta = var_g > 0.0 ? cov / var_g : 0.0;
+      result.points = num_points;
+      result.estimate = sums.f / n - beta * (sums.g / n - kControlMean);
+      estimator_variance = std::max(var_f - beta * cov, 0.0) / (n - 2.0);
+      break;
+    }
+  }
+
+  const double p = std::min(std::max(result.estimate / 4.0, 0.0), 1.0);
+  result.std_error = std::sqrt(estimator_variance);
+  result.plain_variance = 16.0 * p * (1.0 - p);
+  result.variance = estimator_variance * static_cast<double>(result.points);
+  result.variance_reduction = result.variance > 0.0 ? result.plain_variance / result.variance : 0.0;
+  return result;
+}
+
+} // namespace monte_carlo_pi
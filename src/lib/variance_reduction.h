@@ -0,0 +1,57 @@
+#ifndef VARIANCE_REDUCTION_H
+#define VARIANCE_REDUCTION_H
+
+#include "monte_carlo_pi.h"
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Sampling strategy of calculate_pi_variance_reduced
+ */
+enum class VarianceReduction {
+  None,           ///< Independent points over the whole square
+  Stratified,     ///< m x m grid of cells with two jittered points per cell
+  Antithetic,     ///< Each draw (x, y) also samples the mirrored point (1 - x, 1 - y)
+  ControlVariate  ///< Control (x^2 + y^2)^2 with known mean 28/45 and a fitted coefficient
+};
+
+/**
+ * @brief Estimate of Pi together with the efficiency of its sampling strategy
+ */
+struct VarianceReducedResult {
+  double estimate = 0.0;            ///< Estimated value of Pi
+  double std_error = 0.0;           ///< Standard error of the estimate
+  long long points = 0;             ///< Points evaluated (can be fewer than requested, see the strategies)
+  double plain_variance = 0.0;      ///< Variance per point of independent sampling, 16 p (1 - p) with p = estimate / 4
+  double variance = 0.0;            ///< Variance per point of this strategy, points * std_error^2
+  double variance_reduction = 1.0;  ///< plain_variance / variance, the factor of points saved for equal accuracy (0 if variance is 0)
+};
+
+/**
+ * @brief Returns a printable name for a sampling strategy
+ * @param mode Sampling strategy
+ * @return Name such as "stratified"
+ */
+const char *variance_reduction_name(VarianceReduction mode);
+
+/**
+ * @brief Estimates Pi with a variance-reduction strategy and measures its gain
+ *
+ * All strategies draw from the Philox stream of options.seed and run on the
+ * generic engine with options.num_threads threads; arithmetic, kernel level
+ * and placement do not apply. Stratified sampling uses the largest grid with
+ * m^2 <= num_points / 2 cells, antithetic sampling floor(num_points / 2) pairs.
+ * The standard error of every strategy is estimated from the sample itself,
+ * for stratified sampling from the two points of each cell.
+ *
+ * @param num_points Number of points to evaluate
+ * @param mode Sampling strategy
+ * @param options Thread count and seed
+ * @return Estimate, standard error and variance reduction over plain sampling
+ */
+VarianceReducedResult calculate_pi_variance_reduced(long long num_points, VarianceReduction mode,
+                                                    const EstimateOptions &options = EstimateOptions());
+
+} // namespace monte_carlo_pi
+
+#endif // VARIANCE_REDUCTION_H
@@ -0,0 +1,204 @@
+#include "work_stealing_pool.h"
+#include <utility>
+
+namespace monte_carlo_pi {
+
+namespace {
+
+// Pool and queue index of the current worker thread, if any
+thread_local const WorkStealingPool *current_pool = nullptr;
+thread_local std::size_t current_queue = 0;
+
+} // namespace
+
+// Shared state of one submit_indexed call
+struct WorkStealingPool::IndexedJob {
+  long long count = 0;
+  std::atomic<long long> next{0};
+  std::atomic<long long> finished{0};
+  std::function<void(long long)> body;
+  std::function<void()> on_done;
+  TaskPriority priority = TaskPriority::Normal;
+};
+
+WorkStealingPool::WorkStealingPool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+
+  if (num_threads <= 0) {
+    num_threads = 1;
+  }
+
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(&WorkStealingPool::run, this, static_cast<std::size_t>(i));
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+
+  wake_.notify_all();
+
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+int WorkStealingPool::size() const {
+  return static_cast<int>(workers_.size());
+}
+
+bool WorkStealingPool::is_worker_thread() const {
+  return current_pool == this;
+}
+
+void WorkStealingPool::push(std::size_t queue_index, Task task, TaskPriority priority) {
+  Queue &queue = *queues_[queue_index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.tasks[static_cast<int>(priority)].push_back(std::move(task));
+}
+
+void WorkStealingPool::submit(Task task, TaskPriority priority) {
+  // Workers keep their own follow-up work local; outside callers are spread round-robin
+  const std::size_t queue_index = is_worker_thread() ? current_queue
+                                  : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+  push(queue_index, std::move(task), priority);
+  pending_.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  wake_.notify_one();
+}
+
+void WorkStealingPool::submit(std::vector<Task> tasks, TaskPriority priority) {
+  const std::size_t first = next_queue_.fetch_add(tasks.size(), std::memory_order_relaxed);
+
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    push((first + i) % queues_.size(), std::move(tasks[i]), priority);
+  }
+
+  pending_.fetch_add(static_cast<long long>(tasks.size()));
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  wake_.notify_all();
+}
+
+void WorkStealingPool::submit_indexed(long long count, std::function<void(long long)> body, std::function<void()> on_done,
+                                      TaskPriority priority) {
+  if (count <= 0) {
+    on_done();
+    return;
+  }
+
+  auto job = std::make_shared<IndexedJob>();
+  job->count = count;
+  job->body = std::move(body);
+  job->on_done = std::move(on_done);
+  job->priority = priority;
+  std::vector<Task> tasks;
+
+  for (long long i = 0; i < count && i < static_cast<long long>(queues_.size()); ++i) {
+    tasks.push_back([this, job] {
+      run_indexed(job);
+    });
+  }
+
+  submit(std::move(tasks), priority);
+}
+
+void WorkStealingPool::run_indexed(const std::shared_ptr<IndexedJob> &job) {
+  const long long index = job->next.fetch_add(1);
+
+  if (index >= job->count) {
+    return;
+  }
+
+  job->body(index);
+
+  if (job->finished.fetch_add(1) + 1 == job->count) {
+    job->on_done();
+  } else if (job->next.load() < job->count) {
+    // Requeued behind the tasks already waiting in this worker's deque
+    submit([this, job] {
+      run_indexed(job);
+    }, job->priority);
+  }
+}
+
+bool WorkStealingPool::try_pop(std::size_t home, Task *task) {
+  for (int level = kPriorityLevels - 1; level >= 0; --level) {
+    // Own deque first, oldest task first
+    {
+      Queue &queue = *queues_[home];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      if (!queue.tasks[level].empty()) {
+        *task = std::move(queue.tasks[level].front());
+        queue.tasks[level].pop_front();
+        return true;
+      }
+    }
+
+    // Then steal the newest task of the next non-empty deque
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+      Queue &victim = *queues_[(home + offset) % queues_.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+
+      if (!victim.tasks[level].empty()) {
+        *task = std::move(victim.tasks[level].back());
+        victim.tasks[level].pop_back();
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool WorkStealingPool::try_run_one() {
+  Task task;
+  const std::size_t home = is_worker_thread() ? current_queue : next_queue_.load(std::memory_order_relaxed) % queues_.size();
+
+  if (!try_pop(home, &task)) {
+    return false;
+  }
+
+  pending_.fetch_sub(1);
+  task();
+  return true;
+}
+
+void WorkStealingPool::run(std::size_t index) {
+  current_pool = this;
+  current_queue = index;
+
+  for (;;) {
+    Task task;
+
+    if (try_pop(index, &task)) {
+      pending_.fetch_sub(1);
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] {
+      return stopping_ || pending_.load() > 0;
+    });
+
+    if (stopping_ && pending_.load() == 0) {
+      return;
+    }
+  }
+}
+
+} // namespace monte_carlo_pi
@@ -0,0 +1,133 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monte_carlo_pi {
+
+/**
+ * @brief Scheduling class of a pool task
+ */
+enum class TaskPriority {
+  Low,     ///< Background work, runs when nothing else is queued
+  Normal,  ///< Default
+  High     ///< Runs before any queued task of a lower class
+};
+
+/**
+ * @brief Persistent thread pool with one task deque per worker and work stealing
+ *
+ * Tasks submitted from outside the pool are dealt round-robin across the
+ * worker deques. A worker takes the oldest task of its own deque first, so
+ * concurrent submitters are served in arrival order, and steals from the
+ * opposite end of the other deques when its own is empty. Idle workers
+ * sleep on a condition variable instead of spinning. Each deque is split
+ * into priority classes; a worker looks for a task of the highest class in
+ * its own deque and then in the others before it considers a lower class.
+ */
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+  /**
+   * @brief Starts the worker threads
+   * @param num_threads Number of workers (0 for std::thread::hardware_concurrency)
+   */
+  explicit WorkStealingPool(int num_threads = 0);
+
+  /**
+   * @brief Finishes the queued tasks and joins the workers
+   */
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  /**
+   * @brief Returns the number of worker threads
+   * @return Worker count
+   */
+  int size() const;
+
+  /**
+   * @brief Queues one task
+   * @param task Callable to run on a worker
+   * @param priority Scheduling class
+   */
+  void submit(Task task, TaskPriority priority = TaskPriority::Normal);
+
+  /**
+   * @brief Queues several tasks, spread across the worker deques
+   * @param tasks Callables to run on the workers
+   * @param priority Scheduling class of all tasks
+   */
+  void submit(std::vector<Task> tasks, TaskPriority priority = TaskPriority::Normal);
+
+  /**
+   * @brief Runs body(index) for every index in [0, count), one index per task
+   *
+   * At most size() tasks of the call are queued at any time. Each task
+   * claims the next index from a shared counter and queues itself again
+   * while indices remain, so memory does not grow with count and the tasks
+   * of other submitters still interleave at index granularity.
+   *
+   * @param count Number of indices
+   * @param body Called once per index on a worker
+   * @param on_done Called once, after the last body returns, on the thread that ran it
+   * @param priority Scheduling class of all tasks
+   */
+  void submit_indexed(long long count, std::function<void(long long)> body, std::function<void()> on_done,
+                      TaskPriority priority = TaskPriority::Normal);
+
+  /**
+   * @brief Runs one queued task on the calling thread, if any is available
+   *
+   * Lets a thread that waits for pool work help instead of blocking, which
+   * is required when the waiting thread is itself a worker.
+   *
+   * @return true if a task was run
+   */
+  bool try_run_one();
+
+  /**
+   * @brief Checks whether the calling thread is a worker of this pool
+   * @return true on a worker thread of this pool
+   */
+  bool is_worker_thread() const;
+
+ private:
+  static constexpr int kPriorityLevels = 3;
+
+  // One deque per worker and priority class, on its own cache lines
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks[kPriorityLevels];
+  };
+
+  struct IndexedJob;
+
+  void push(std::size_t queue_index, Task task, TaskPriority priority);
+  void run_indexed(const std::shared_ptr<IndexedJob> &job);
+  bool try_pop(std::size_t home, Task *task);
+  void run(std::size_t index);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::size_t> next_queue_{0};
+  std::atomic<long long> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+};
+
+} // namespace monte_carlo_pi
+
+#endif // WORK_STEALING_POOL_H
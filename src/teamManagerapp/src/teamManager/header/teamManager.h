@@ -2,12 +2,15 @@
  * @file teamManager.h
  *
  * @brief Provides functions for math. utilities
+ *
+ * Every operation exists for one pair of values and, without heap
+ * allocation, for whole arrays.
  */
 
 #ifndef teamManager_H
 #define teamManager_H
 
-#include "../../utility/header/commonTypes.h"
+#include "commonTypes.h"
 
 namespace Coruh {
 namespace teamManager {
@@ -51,7 +54,66 @@ class teamManager {
    */
   static double divide(double a, double b);
 
+  /**
+   * Adds two arrays element by element.
+   * @param a First operands.
+   * @param b Second operands.
+   * @param out Receives a[i] + b[i]; may be a or b.
+   * @param count Number of elements.
+   * @param numThreads OpenMP threads; 1 runs on the calling thread, 0 uses the OpenMP default.
+   */
+  static void add(const double *a, const double *b, double *out, size_t count, int numThreads = 1);
+
+  /**
+   * Subtracts two arrays element by element.
+   * @param a Minuends.
+   * @param b Subtrahends.
+   * @param out Receives a[i] - b[i]; may be a or b.
+   * @param count Number of elements.
+   * @param numThreads OpenMP threads; 1 runs on the calling thread, 0 uses the OpenMP default.
+   */
+  static void subtract(const double *a, const double *b, double *out, size_t count, int numThreads = 1);
+
+  /**
+   * Multiplies two arrays element by element.
+   * @param a First operands.
+   * @param b Second operands.
+   * @param out Receives a[i] * b[i]; may be a or b.
+   * @param count Number of elements.
+   * @param numThreads OpenMP threads; 1 runs on the calling thread, 0 uses the OpenMP default.
+   */
+  static void multiply(const double *a, const double *b, double *out, size_t count, int numThreads = 1);
+
+  /**
+   * Divides two arrays element by element without throwing.
+   * Zero divisors are reported instead: their bit is set in errors and
+   * their result is NaN, while every other element is divided.
+   * @param a Dividends.
+   * @param b Divisors.
+   * @param out Receives a[i] / b[i], or NaN where b[i] is zero; may be a or b.
+   * @param count Number of elements.
+   * @param errors Receives the zero-divisor bitmap, bit i % 64 of word i / 64, in errorWords(count) words; may be null.
+   * @param numThreads OpenMP threads; 1 runs on the calling thread, 0 uses the OpenMP default.
+   * @return Number of zero divisors.
+   */
+  static size_t divide(const double *a, const double *b, double *out, size_t count, uint64_t *errors = nullptr,
+                       int numThreads = 1);
+
+  /**
+   * Returns the size of the error bitmap of a batched divide.
+   * @param count Number of elements.
+   * @return Number of 64-bit words.
+   */
+  static size_t errorWords(size_t count);
+
+  /**
+   * Checks whether the batched operations use AVX2 kernels.
+   * @return true if the processor and operating system support AVX2.
+   */
+  static bool usesAvx2();
 
+  /// Elements per OpenMP work item, a multiple of 64 so threads never share an error word
+  static constexpr size_t kChunkSize = 1 << 16;
 };
 }
 }
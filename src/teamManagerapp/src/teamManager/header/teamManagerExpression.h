@@ -0,0 +1,361 @@
+/**
+ * @file teamManagerExpression.h
+ *
+ * @brief Provides fused array expressions over the teamManager operations
+ */
+
+#ifndef teamManager_EXPRESSION_H
+#define teamManager_EXPRESSION_H
+
+#include "teamManager.h"
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Coruh {
+namespace teamManager {
+namespace detail {
+
+/// Operation of an expression node
+enum class BinaryOperation {
+  Add,
+  Subtract,
+  Multiply,
+  Divide
+};
+
+/// Elements evaluated per block; every intermediate of a block stays in the L1 cache
+constexpr size_t kBlockSize = 256;
+
+/// Length of an expression without arrays, such as a scalar
+constexpr size_t kAnySize = std::numeric_limits<size_t>::max();
+
+/**
+ * Applies one operation to at most kBlockSize elements with the batched kernels.
+ * @param operation Operation.
+ * @param a First operands.
+ * @param b Second operands.
+ * @param out Receives the results; may be a or b.
+ * @param count Number of elements.
+ * @param errors Zero-divisor bitmap of the block, ORed with the zero divisors of a Divide.
+ */
+void applyBlock(BinaryOperation operation, const double *a, const double *b, double *out, size_t count,
+                uint64_t *errors);
+
+/// Evaluates the elements [first, first + count) of a type-erased expression into out and ORs its zero divisors into errors
+typedef void (*BlockEvaluator)(const void *expression, double *out, size_t first, size_t count, uint64_t *errors);
+
+/**
+ * Runs a block evaluator over [0, count), in parallel when numThreads allows.
+ * @param expression Expression passed to the evaluator.
+ * @param evaluator Block evaluator.
+ * @param out Result array.
+ * @param count Number of elements.
+ * @param errors Receives the zero-divisor bitmap, errorWords(count) words; may be null.
+ * @param numThreads OpenMP threads; 1 runs on the calling thread, 0 uses the OpenMP default.
+ * @return Number of elements with a zero divisor.
+ */
+size_t evaluateBlocks(const void *expression, BlockEvaluator evaluator, double *out, size_t count, uint64_t *errors,
+                      int numThreads);
+
+} // namespace detail
+
+/**
+    @class ArrayExpression
+    @brief Leaf of an expression: an existing array, read in place
+*/
+class ArrayExpression {
+ public:
+  /**
+   * Wraps an array without copying it.
+   * @param data Values; they must outlive the evaluation.
+   * @param size Number of values.
+   */
+  ArrayExpression(const double *data, size_t size) : data_(data), size_(size) {
+  }
+
+  /**
+   * Returns the number of elements.
+   * @return Array length.
+   */
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+   * Returns the elements of a block.
+   * @param first Index of the first element.
+   * @param count Number of elements.
+   * @param buffer Unused; arrays are read in place.
+   * @param errors Unused.
+   * @return Pointer to the elements.
+   */
+  const double *evaluateBlock(size_t first, size_t count, double *buffer, uint64_t *errors) const {
+    (void)count;
+    (void)buffer;
+    (void)errors;
+    return data_ + first;
+  }
+
+ private:
+  const double *data_;
+  size_t size_;
+};
+
+/**
+    @class ScalarExpression
+    @brief Leaf of an expression: one value used for every element
+*/
+class ScalarExpression {
+ public:
+  /**
+   * Wraps a value.
+   * @param value Value of every element.
+   */
+  explicit ScalarExpression(double value) {
+    for (size_t i = 0; i < detail::kBlockSize; ++i) {
+      block_[i] = value;
+    }
+  }
+
+  /**
+   * Returns the number of elements.
+   * @return detail::kAnySize, as a scalar fits any length.
+   */
+  size_t size() const {
+    return detail::kAnySize;
+  }
+
+  /**
+   * Returns a block of the value.
+   * @param first Unused.
+   * @param count Unused; the block holds detail::kBlockSize copies.
+   * @param buffer Unused; the value is broadcast once, at construction.
+   * @param errors Unused.
+   * @return Pointer to the copies.
+   */
+  const double *evaluateBlock(size_t first, size_t count, double *buffer, uint64_t *errors) const {
+    (void)first;
+    (void)count;
+    (void)buffer;
+    (void)errors;
+    return block_;
+  }
+
+ private:
+  double block_[detail::kBlockSize];
+};
+
+namespace detail {
+
+/// Scratch block a node operand is evaluated into
+template<typename Expression>
+struct BlockBuffer {
+  double values[kBlockSize];
+
+  double *data() {
+    return values;
+  }
+};
+
+/// Leaves return their own elements, so they get no scratch block
+template<>
+struct BlockBuffer<ArrayExpression> {
+  double *data() {
+    return nullptr;
+  }
+};
+
+template<>
+struct BlockBuffer<ScalarExpression> {
+  double *data() {
+    return nullptr;
+  }
+};
+
+} // namespace detail
+
+/**
+    @class BinaryExpression
+    @brief Node of an expression: an operation on two subexpressions
+
+    Building the node computes nothing; the tree is a compile-time type and
+    evaluate walks it one cache block at a time.
+*/
+template<detail::BinaryOperation Operation, typename Left, typename Right>
+class BinaryExpression {
+ public:
+  /**
+   * Combines two subexpressions.
+   * @param left First operand.
+   * @param right Second operand.
+   * @throws std::invalid_argument If both operands have arrays of different lengths.
+   */
+  BinaryExpression(const Left &left, const Right &right) : left_(left), right_(right) {
+    if (left.size() != detail::kAnySize && right.size() != detail::kAnySize && left.size() != right.size()) {
+      throw std::invalid_argument("Operands must have the same length.");
+    }
+  }
+
+  /**
+   * Returns the number of elements.
+   * @return Length of the array operands, detail::kAnySize if there are none.
+   */
+  size_t size() const {
+    return left_.size() != detail::kAnySize ? left_.size() : right_.size();
+  }
+
+  /**
+   * Evaluates a block of the subtree.
+   * @param first Index of the first element.
+   * @param count Number of elements, at most detail::kBlockSize.
+   * @param buffer Receives the results.
+   * @param errors Zero-divisor bitmap of the block.
+   * @return buffer.
+   */
+  const double *evaluateBlock(size_t first, size_t count, double *buffer, uint64_t *errors) const {
+    detail::BlockBuffer<Left> leftBuffer;
+    detail::BlockBuffer<Right> rightBuffer;
+    const double *a = left_.evaluateBlock(first, count, leftBuffer.data(), errors);
+    const double *b = right_.evaluateBlock(first, count, rightBuffer.data(), errors);
+    detail::applyBlock(Operation, a, b, buffer, count, errors);
+    return buffer;
+  }
+
+ private:
+  Left left_;
+  Right right_;
+};
+
+/**
+ * Wraps an array for use in an expression.
+ * @param data Values; they must outlive the evaluation.
+ * @param size Number of values.
+ * @return Leaf expression.
+ */
+inline ArrayExpression expression(const double *data, size_t size) {
+  return ArrayExpression(data, size);
+}
+
+/// True for the expression types above
+template<typename T>
+struct isExpression : std::false_type {};
+
+template<>
+struct isExpression<ArrayExpression> : std::true_type {};
+
+template<>
+struct isExpression<ScalarExpression> : std::true_type {};
+
+template<detail::BinaryOperation Operation, typename Left, typename Right>
+struct isExpression<BinaryExpression<Operation, Left, Right>> : std::true_type {};
+
+namespace detail {
+
+/// Turns a double operand into a ScalarExpression and keeps expressions as they are
+template<typename T>
+using Operand = typename std::conditional<isExpression<T>::value, T, ScalarExpression>::type;
+
+/// Enables the operators when one operand is an expression and the other an expression or a double
+template<typename Left, typename Right>
+using EnableOperator = typename std::enable_if<(isExpression<Left>::value
+                       || isExpression<Right>::value)
+                       && (isExpression<Left>::value || std::is_arithmetic<Left>::value)
+                       && (isExpression<Right>::value || std::is_arithmetic<Right>::value)>::type;
+
+template<BinaryOperation Operation, typename Left, typename Right>
+BinaryExpression<Operation, Operand<Left>, Operand<Right>> combine(const Left &left, const Right &right) {
+  return BinaryExpression<Operation, Operand<Left>, Operand<Right>>(Operand<Left>(left), Operand<Right>(right));
+}
+
+template<typename Expression>
+void evaluateExpressionBlock(const void *expression, double *out, size_t first, size_t count, uint64_t *errors) {
+  const double *result = static_cast<const Expression *>(expression)->evaluateBlock(first, count, out + first, errors);
+
+  // A bare array is copied; every other expression already wrote into out
+  if (result != out + first) {
+    for (size_t i = 0; i < count; ++i) {
+      out[first + i] = result[i];
+    }
+  }
+}
+
+} // namespace detail
+
+/**
+ * Builds an addition node.
+ * @param left Expression or double.
+ * @param right Expression or double.
+ * @return Unevaluated sum.
+ */
+template<typename Left, typename Right, typename = detail::EnableOperator<Left, Right>>
+BinaryExpression<detail::BinaryOperation::Add, detail::Operand<Left>, detail::Operand<Right>>
+operator+(const Left &left, const Right &right) {
+  return detail::combine<detail::BinaryOperation::Add>(left, right);
+}
+
+/**
+ * Builds a subtraction node.
+ * @param left Expression or double.
+ * @param right Expression or double.
+ * @return Unevaluated difference.
+ */
+template<typename Left, typename Right, typename = detail::EnableOperator<Left, Right>>
+BinaryExpression<detail::BinaryOperation::Subtract, detail::Operand<Left>, detail::Operand<Right>>
+operator-(const Left &left, const Right &right) {
+  return detail::combine<detail::BinaryOperation::Subtract>(left, right);
+}
+
+/**
+ * Builds a multiplication node.
+ * @param left Expression or double.
+ * @param right Expression or double.
+ * @return Unevaluated product.
+ */
+template<typename Left, typename Right, typename = detail::EnableOperator<Left, Right>>
+BinaryExpression<detail::BinaryOperation::Multiply, detail::Operand<Left>, detail::Operand<Right>>
+operator*(const Left &left, const Right &right) {
+  return detail::combine<detail::BinaryOperation::Multiply>(left, right);
+}
+
+/**
+ * Builds a division node; zero divisors are reported by evaluate as in teamManager::divide.
+ * @param left Expression or double.
+ * @param right Expression or double.
+ * @return Unevaluated quotient.
+ */
+template<typename Left, typename Right, typename = detail::EnableOperator<Left, Right>>
+BinaryExpression<detail::BinaryOperation::Divide, detail::Operand<Left>, detail::Operand<Right>>
+operator/(const Left &left, const Right &right) {
+  return detail::combine<detail::BinaryOperation::Divide>(left, right);
+}
+
+/**
+ * Evaluates an expression in one fused pass over memory.
+ *
+ * Every input is read once and out is written once. Blocks of
+ * detail::kBlockSize elements go through the whole tree, with the
+ * intermediates in stack buffers, using the batched AVX2 kernels. Nothing
+ * is allocated. As with the array teamManager::divide, a zero divisor
+ * anywhere in the tree makes that element NaN and sets its error bit.
+ *
+ * @param expression Expression with at least one array.
+ * @param out Receives the results; may be one of the input arrays.
+ * @param errors Receives the zero-divisor bitmap, teamManager::errorWords(size) words; may be null.
+ * @param numThreads OpenMP threads; 1 runs on the calling thread, 0 uses the OpenMP default.
+ * @return Number of elements with a zero divisor.
+ * @throws std::invalid_argument If the expression has no array operand.
+ */
+template<typename Expression, typename = typename std::enable_if<isExpression<Expression>::value>::type>
+size_t evaluate(const Expression &expression, double *out, uint64_t *errors = nullptr, int numThreads = 1) {
+  if (expression.size() == detail::kAnySize) {
+    throw std::invalid_argument("An expression needs at least one array.");
+  }
+
+  return detail::evaluateBlocks(&expression, detail::evaluateExpressionBlock<Expression>, out, expression.size(), errors,
+                                numThreads);
+}
+}
+}
+
+#endif // teamManager_EXPRESSION_H
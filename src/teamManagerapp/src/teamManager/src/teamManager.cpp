@@ -1,8 +1,196 @@
 #include "../header/teamManager.h"
+#include "../header/teamManagerExpression.h"
+#include <algorithm>
+#include <bitset>
+#include <limits>
 #include <stdexcept>
+#include <omp.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define TEAM_MANAGER_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+
+// GCC and Clang need per-function target attributes to emit AVX2 above the build baseline
+#if defined(__GNUC__) || defined(__clang__)
+  #define TEAM_MANAGER_TARGET(isa) __attribute__((target(isa)))
+#else
+  #define TEAM_MANAGER_TARGET(isa)
+#endif
 
 using namespace Coruh::teamManager;
 
+namespace {
+
+const size_t kErrorBits = 64;
+
+struct AddOp {
+  static double apply(double a, double b) {
+    return a + b;
+  }
+
+#ifdef TEAM_MANAGER_X86
+  TEAM_MANAGER_TARGET("avx2")
+  static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_add_pd(a, b);
+  }
+#endif
+};
+
+struct SubtractOp {
+  static double apply(double a, double b) {
+    return a - b;
+  }
+
+#ifdef TEAM_MANAGER_X86
+  TEAM_MANAGER_TARGET("avx2")
+  static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_sub_pd(a, b);
+  }
+#endif
+};
+
+struct MultiplyOp {
+  static double apply(double a, double b) {
+    return a * b;
+  }
+
+#ifdef TEAM_MANAGER_X86
+  TEAM_MANAGER_TARGET("avx2")
+  static __m256d apply(__m256d a, __m256d b) {
+    return _mm256_mul_pd(a, b);
+  }
+#endif
+};
+
+template<typename Op>
+void binaryScalar(const double *a, const double *b, double *out, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = Op::apply(a[i], b[i]);
+  }
+}
+
+// Divides up to 64 elements and returns the bitmap of zero divisors
+uint64_t divideScalar(const double *a, const double *b, double *out, size_t count) {
+  uint64_t errors = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (b[i] == 0) {
+      out[i] = std::numeric_limits<double>::quiet_NaN();
+      errors |= uint64_t(1) << i;
+    } else {
+      out[i] = a[i] / b[i];
+    }
+  }
+
+  return errors;
+}
+
+#ifdef TEAM_MANAGER_X86
+
+template<typename Op>
+TEAM_MANAGER_TARGET("avx2")
+void binaryAvx2(const double *a, const double *b, double *out, size_t count) {
+  size_t i = 0;
+
+  for (; i < count - count % 4; i += 4) {
+    _mm256_storeu_pd(out + i, Op::apply(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  }
+
+  binaryScalar<Op>(a + i, b + i, out + i, count - i);
+}
+
+TEAM_MANAGER_TARGET("avx2")
+uint64_t divideAvx2(const double *a, const double *b, double *out, size_t count) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+  uint64_t errors = 0;
+  size_t i = 0;
+
+  // Zero lanes are divided too and then replaced, so the loop never branches
+  for (; i < count - count % 4; i += 4) {
+    const __m256d divisor = _mm256_loadu_pd(b + i);
+    const __m256d zeros = _mm256_cmp_pd(divisor, zero, _CMP_EQ_OQ);
+    const __m256d quotient = _mm256_div_pd(_mm256_loadu_pd(a + i), divisor);
+    _mm256_storeu_pd(out + i, _mm256_blendv_pd(quotient, nan, zeros));
+    errors |= static_cast<uint64_t>(_mm256_movemask_pd(zeros)) << i;
+  }
+
+  // A shift by 64 would be undefined, so a full block returns before the tail
+  return i == count ? errors : errors | (divideScalar(a + i, b + i, out + i, count - i) << i);
+}
+
+bool detectAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] < 7) {
+    return false;
+  }
+
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0;
+  return osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#else
+
+template<typename Op>
+void binaryAvx2(const double *a, const double *b, double *out, size_t count) {
+  binaryScalar<Op>(a, b, out, count);
+}
+
+uint64_t divideAvx2(const double *a, const double *b, double *out, size_t count) {
+  return divideScalar(a, b, out, count);
+}
+
+bool detectAvx2() {
+  return false;
+}
+
+#endif // TEAM_MANAGER_X86
+
+bool hasAvx2() {
+  static const bool avx2 = detectAvx2();
+  return avx2;
+}
+
+int threadCount(int numThreads) {
+  return numThreads > 0 ? numThreads : omp_get_max_threads();
+}
+
+template<typename Op>
+void binary(const double *a, const double *b, double *out, size_t count, int numThreads) {
+  const long long chunks = static_cast<long long>((count + teamManager::kChunkSize - 1) / teamManager::kChunkSize);
+  const int threads = threadCount(numThreads);
+  const bool avx2 = hasAvx2();
+  #pragma omp parallel for schedule(static) num_threads(threads) if(threads > 1 && chunks > 1)
+
+  for (long long chunk = 0; chunk < chunks; ++chunk) {
+    const size_t first = static_cast<size_t>(chunk) * teamManager::kChunkSize;
+    const size_t length = std::min(teamManager::kChunkSize, count - first);
+
+    if (avx2) {
+      binaryAvx2<Op>(a + first, b + first, out + first, length);
+    } else {
+      binaryScalar<Op>(a + first, b + first, out + first, length);
+    }
+  }
+}
+
+} // namespace
+
 double teamManager::add(double a, double b) {
   return a + b;
 }
@@ -22,3 +210,104 @@ double teamManager::divide(double a, double b) {
 
   return a / b;
 }
+
+void teamManager::add(const double *a, const double *b, double *out, size_t count, int numThreads) {
+  binary<AddOp>(a, b, out, count, numThreads);
+}
+
+void teamManager::subtract(const double *a, const double *b, double *out, size_t count, int numThreads) {
+  binary<SubtractOp>(a, b, out, count, numThreads);
+}
+
+void teamManager::multiply(const double *a, const double *b, double *out, size_t count, int numThreads) {
+  binary<MultiplyOp>(a, b, out, count, numThreads);
+}
+
+size_t teamManager::divide(const double *a, const double *b, double *out, size_t count, uint64_t *errors,
+                           int numThreads) {
+  const long long words = static_cast<long long>(errorWords(count));
+  const int threads = threadCount(numThreads);
+  const bool avx2 = hasAvx2();
+  long long zeros = 0;
+  // Each thread takes whole chunks, so no two threads write the same error word
+  #pragma omp parallel for schedule(static, kChunkSize / kErrorBits) num_threads(threads) \
+  if(threads > 1 && count > kChunkSize) reduction(+ : zeros)
+
+  for (long long word = 0; word < words; ++word) {
+    const size_t first = static_cast<size_t>(word) * kErrorBits;
+    const size_t length = std::min(kErrorBits, count - first);
+    const uint64_t mask = avx2 ? divideAvx2(a + first, b + first, out + first, length)
+                          : divideScalar(a + first, b + first, out + first, length);
+
+    if (errors != nullptr) {
+      errors[word] = mask;
+    }
+
+    zeros += static_cast<long long>(std::bitset<64>(mask).count());
+  }
+
+  return static_cast<size_t>(zeros);
+}
+
+size_t teamManager::errorWords(size_t count) {
+  return (count + kErrorBits - 1) / kErrorBits;
+}
+
+bool teamManager::usesAvx2() {
+  return hasAvx2();
+}
+
+void detail::applyBlock(BinaryOperation operation, const double *a, const double *b, double *out, size_t count,
+                        uint64_t *errors) {
+  const bool avx2 = hasAvx2();
+
+  switch (operation) {
+    case BinaryOperation::Add:
+      avx2 ? binaryAvx2<AddOp>(a, b, out, count) : binaryScalar<AddOp>(a, b, out, count);
+      break;
+
+    case BinaryOperation::Subtract:
+      avx2 ? binaryAvx2<SubtractOp>(a, b, out, count) : binaryScalar<SubtractOp>(a, b, out, count);
+      break;
+
+    case BinaryOperation::Multiply:
+      avx2 ? binaryAvx2<MultiplyOp>(a, b, out, count) : binaryScalar<MultiplyOp>(a, b, out, count);
+      break;
+
+    case BinaryOperation::Divide:
+      for (size_t first = 0; first < count; first += kErrorBits) {
+        const size_t length = std::min(kErrorBits, count - first);
+        errors[first / kErrorBits] |= avx2 ? divideAvx2(a + first, b + first, out + first, length)
+                                      : divideScalar(a + first, b + first, out + first, length);
+      }
+
+      break;
+  }
+}
+
+size_t detail::evaluateBlocks(const void *expression, BlockEvaluator evaluator, double *out, size_t count,
+                              uint64_t *errors, int numThreads) {
+  const long long blocks = static_cast<long long>((count + kBlockSize - 1) / kBlockSize);
+  const int threads = threadCount(numThreads);
+  long long zeros = 0;
+  // Whole chunks per thread, as in the array divide
+  #pragma omp parallel for schedule(static, teamManager::kChunkSize / kBlockSize) num_threads(threads) \
+  if(threads > 1 && count > teamManager::kChunkSize) reduction(+ : zeros)
+
+  for (long long block = 0; block < blocks; ++block) {
+    const size_t first = static_cast<size_t>(block) * kBlockSize;
+    const size_t length = std::min(kBlockSize, count - first);
+    uint64_t blockErrors[kBlockSize / kErrorBits] = {};
+    evaluator(expression, out, first, length, blockErrors);
+
+    for (size_t word = 0; word < (length + kErrorBits - 1) / kErrorBits; ++word) {
+      if (errors != nullptr) {
+        errors[first / kErrorBits + word] = blockErrors[word];
+      }
+
+      zeros += static_cast<long long>(std::bitset<64>(blockErrors[word]).count());
+    }
+  }
+
+  return static_cast<size_t>(zeros);
+}
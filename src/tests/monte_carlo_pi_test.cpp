@@ -1,12 +1,38 @@
 #include <gtest/gtest.h>
 #include "monte_carlo_pi.h"
+#include "philox.h"
+#include "monte_carlo_pi_kernels.h"
+#include "pi_estimator.h"
+#include "cpu_topology.h"
+#include "sharded_estimator.h"
+#include "long_run.h"
+#include "timing_harness.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include "monte_carlo_engine.h"
+#include "variance_reduction.h"
+#include "rng_engines.h"
+#include "async_estimator.h"
+#include "result_cache.h"
+#include "mathUtility.h"
+#include <omp.h>
 #include <cmath>
 #include <thread>
 #include <vector>
 #include <future>
-#include <chrono>
 #include <numeric>
 #include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <map>
+#include <sstream>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <signal.h>
+#endif
 
 // Define M_PI if not defined (for Windows)
 #ifndef M_PI
@@ -15,15 +41,6 @@
 
 namespace {
 
-// Helper function to measure execution time
-template<typename Func>
-double measure_time(Func f) {
-  auto start = std::chrono::high_resolution_clock::now();
-  f();
-  auto end = std::chrono::high_resolution_clock::now();
-  return std::chrono::duration<double>(end - start).count();
-}
-
 // Basic functionality tests
 TEST(MonteCarloPiTest, SequentialCalculation) {
   const long long num_points = 1000000;
@@ -74,37 +91,6 @@ TEST(MonteCarloPiTest, EdgeCases) {
   EXPECT_TRUE(std::isfinite(pi_neg));
 }
 
-// Performance tests
-TEST(MonteCarloPiTest, PerformanceComparison) {
-  const long long num_points = 1000000;
-  const int num_runs = 5;
-  // Measure sequential performance
-  double seq_time = 0.0;
-
-  for (int i = 0; i < num_runs; ++i) {
-    seq_time += measure_time([num_points]() {
-      monte_carlo_pi::calculate_pi_sequential(num_points);
-    });
-  }
-
-  seq_time /= num_runs;  // Average time
-
-  // Measure parallel performance with different thread counts
-  for (int threads = 1; threads <= 8; threads *= 2) {
-    double par_time = 0.0;
-
-    for (int i = 0; i < num_runs; ++i) {
-      par_time += measure_time([num_points, threads]() {
-        monte_carlo_pi::calculate_pi_parallel(num_points, threads);
-      });
-    }
-
-    par_time /= num_runs;  // Average time
-    // Parallel version should be faster with sufficient points
-    EXPECT_LE(par_time, seq_time * 1.5); // Allow some overhead
-  }
-}
-
 // Thread safety tests
 TEST(MonteCarloPiTest, ThreadSafety) {
   const long long num_points = 1000000;
@@ -165,4 +151,863 @@ TEST(MonteCarloPiTest, ResultConsistency) {
   EXPECT_LT(std::sqrt(par_variance), 0.01);
 }
 
+// Reproducibility tests
+TEST(MonteCarloPiTest, PhiloxKnownAnswers) {
+  // Known-answer vectors from the Random123 distribution
+  using monte_carlo_pi::Philox4x32;
+  EXPECT_EQ(Philox4x32::generate({0, 0, 0, 0}, {0, 0}),
+            (Philox4x32::Counter{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}));
+  EXPECT_EQ(Philox4x32::generate({0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu}, {0xffffffffu, 0xffffffffu}),
+            (Philox4x32::Counter{0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}));
+  EXPECT_EQ(Philox4x32::generate({0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u}, {0xa4093822u, 0x299f31d0u}),
+            (Philox4x32::Counter{0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}));
+}
+
+TEST(MonteCarloPiTest, SeededResultIndependentOfThreadCount) {
+  const long long num_points = 1000003;
+  const std::uint64_t seed = 20240917;
+  double pi_seq = monte_carlo_pi::calculate_pi_sequential(num_points, seed);
+  EXPECT_NEAR(pi_seq, M_PI, 0.01);
+
+  for (int threads = 1; threads <= 64; threads *= 2) {
+    EXPECT_EQ(monte_carlo_pi::calculate_pi_parallel(num_points, threads, seed), pi_seq);
+  }
+
+  EXPECT_EQ(monte_carlo_pi::generate_points(num_points, seed), monte_carlo_pi::generate_points(num_points, seed));
+  EXPECT_NE(monte_carlo_pi::calculate_pi_sequential(num_points, seed + 1), pi_seq);
+}
+
+TEST(MonteCarloPiTest, CounterRangesSplitAtAnyBoundary) {
+  const std::uint64_t seed = 7;
+  const long long total = monte_carlo_pi::count_points_inside(seed, 0, 100000);
+  EXPECT_EQ(total, monte_carlo_pi::generate_points(100000, seed).first);
+
+  for (long long split : {1LL, 777LL, 65536LL, 99999LL}) {
+    EXPECT_EQ(monte_carlo_pi::count_points_inside(seed, 0, split) + monte_carlo_pi::count_points_inside(seed, split, 100000), total);
+  }
+}
+
+// Vector kernel tests
+TEST(MonteCarloPiTest, SimdKernelsMatchScalar) {
+  using monte_carlo_pi::SimdLevel;
+  const std::uint64_t seed = 42;
+  // Ragged ranges, including one across the 2^32 boundary of the low counter word
+  const std::vector<std::pair<long long, long long>> ranges = {
+    {0, 100003}, {5, 6}, {17, 1000}, {(1LL << 32) - 13, (1LL << 32) + 29}
+  };
+
+  for (const auto &range : ranges) {
+    const long long expected = monte_carlo_pi::count_points_inside(seed, range.first, range.second, SimdLevel::Scalar);
+
+    for (SimdLevel level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+      EXPECT_EQ(monte_carlo_pi::count_points_inside(seed, range.first, range.second, level), expected)
+          << monte_carlo_pi::simd_level_name(level);
+    }
+  }
+}
+
+// Fixed-point kernel tests
+TEST(MonteCarloPiTest, FixedPointKernelsMatchScalar) {
+  using monte_carlo_pi::Arithmetic;
+  using monte_carlo_pi::SimdLevel;
+  const std::uint64_t seed = 99;
+  const std::vector<std::pair<long long, long long>> ranges = {
+    {0, 200001}, {5, 6}, {4, 5}, {3, 1000}, {(1LL << 33) - 27, (1LL << 33) + 61}
+  };
+
+  for (const auto &range : ranges) {
+    const long long expected = monte_carlo_pi::count_points_inside(seed, range.first, range.second, Arithmetic::FixedPoint, SimdLevel::Scalar);
+    // Splitting at an odd index must not change the count
+    const long long middle = (range.first + (range.second - range.first) / 2) | 1;
+    EXPECT_EQ(monte_carlo_pi::count_points_inside(seed, range.first, middle, Arithmetic::FixedPoint, SimdLevel::Scalar)
+              + monte_carlo_pi::count_points_inside(seed, middle, range.second, Arithmetic::FixedPoint, SimdLevel::Scalar),
+              expected);
+
+    for (SimdLevel level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+      EXPECT_EQ(monte_carlo_pi::count_points_inside(seed, range.first, range.second, Arithmetic::FixedPoint, level), expected)
+          << monte_carlo_pi::simd_level_name(level);
+    }
+  }
+}
+
+TEST(MonteCarloPiTest, FixedPointInsideTestIsExact) {
+#ifdef __SIZEOF_INT128__
+  using monte_carlo_pi::detail::fixed_point_inside;
+  // (x + 1/2)^2 + (y + 1/2)^2 <= 2^64 in exact arithmetic: 4x^2 + 4x + 4y^2 + 4y + 2 <= 2^66
+  auto reference = [](std::uint32_t x, std::uint32_t y) {
+    using uint128 = unsigned __int128;
+    const uint128 lhs = 4 * (static_cast<uint128>(x) * x + x) + 4 * (static_cast<uint128>(y) * y + y) + 2;
+    return lhs <= (static_cast<uint128>(1) << 66);
+  };
+  EXPECT_TRUE(fixed_point_inside(0, 0));
+  EXPECT_TRUE(fixed_point_inside(0xFFFFFFFFu, 0));
+  EXPECT_FALSE(fixed_point_inside(0xFFFFFFFFu, 0xFFFFFFFFu));
+  // Probe around the boundary, where y is the largest coordinate still inside for each x
+  monte_carlo_pi::Philox4x32 philox(3);
+
+  for (std::uint64_t i = 0; i < 20000; ++i) {
+    const std::uint32_t x = philox(i)[0];
+    const long double y_limit = std::sqrt(18446744073709551616.0L - (x + 0.5L) * (x + 0.5L)) - 0.5L;
+    const std::uint32_t y = static_cast<std::uint32_t>(std::min<long double>(y_limit, 4294967295.0L));
+
+    for (std::uint32_t probe : {y - 1, y, y + 1}) {
+      EXPECT_EQ(fixed_point_inside(x, probe), reference(x, probe)) << x << " " << probe;
+    }
+  }
+
+#else
+  GTEST_SKIP() << "128-bit reference arithmetic not available";
+#endif
+}
+
+TEST(MonteCarloPiTest, FixedPointEstimate) {
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 1234;
+  options.arithmetic = monte_carlo_pi::Arithmetic::FixedPoint;
+  double pi = monte_carlo_pi::calculate_pi_parallel(1000000, options);
+  EXPECT_NEAR(pi, M_PI, 0.01);
+  options.num_threads = 3;
+  EXPECT_EQ(monte_carlo_pi::calculate_pi_parallel(1000000, options), pi);
+}
+
+// Quasi-Monte Carlo tests
+TEST(MonteCarloPiTest, QuasiMonteCarloConvergesFaster) {
+  using monte_carlo_pi::Sequence;
+  // Plain Monte Carlo has a standard error of about 6e-3 at this size
+  const long long num_points = 1 << 16;
+
+  for (Sequence sequence : {Sequence::Sobol, Sequence::Halton, Sequence::R2}) {
+    monte_carlo_pi::QmcResult result = monte_carlo_pi::calculate_pi_qmc(num_points, sequence, 8, 0, 11);
+    ASSERT_EQ(result.replica_estimates.size(), 8u);
+    EXPECT_NEAR(result.pi, M_PI, 1e-3) << monte_carlo_pi::sequence_name(sequence);
+    EXPECT_GT(result.standard_error, 0.0);
+    EXPECT_LT(result.standard_error, 1e-3) << monte_carlo_pi::sequence_name(sequence);
+  }
+}
+
+TEST(MonteCarloPiTest, QuasiMonteCarloIndependentOfThreadCount) {
+  using monte_carlo_pi::Sequence;
+
+  for (Sequence sequence : {Sequence::Sobol, Sequence::Halton, Sequence::R2}) {
+    const long long whole = monte_carlo_pi::count_points_inside_qmc(sequence, 5, 0, 50000);
+    EXPECT_EQ(monte_carlo_pi::count_points_inside_qmc(sequence, 5, 0, 12345)
+              + monte_carlo_pi::count_points_inside_qmc(sequence, 5, 12345, 50000), whole);
+    EXPECT_EQ(monte_carlo_pi::calculate_pi_qmc(50000, sequence, 2, 1, 5).pi,
+              monte_carlo_pi::calculate_pi_qmc(50000, sequence, 2, 4, 5).pi);
+  }
+
+  EXPECT_THROW(monte_carlo_pi::count_points_inside_qmc(Sequence::Sobol, 5, 0, (1LL << 32) + 1), std::invalid_argument);
+  EXPECT_THROW(monte_carlo_pi::count_points_inside_qmc(Sequence::Halton, 5, 0, (1LL << 32) + 1), std::invalid_argument);
+}
+
+// Adaptive estimation tests
+TEST(MonteCarloPiTest, AdaptiveEstimateStopsAtTargetError) {
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 77;
+  monte_carlo_pi::EstimateResult result = monte_carlo_pi::estimate_pi(2e-3, 100000000, options);
+  EXPECT_LE(result.standard_error, 2e-3);
+  // About (4 * 0.41 / 2e-3)^2 = 6.7e5 points are enough
+  EXPECT_LT(result.points, 2000000);
+  EXPECT_EQ(result.hits, monte_carlo_pi::count_points_inside(options.seed, 0, result.points));
+  EXPECT_DOUBLE_EQ(result.estimate, 4.0 * result.hits / result.points);
+  EXPECT_LT(result.ci_lower, result.estimate);
+  EXPECT_GT(result.ci_upper, result.estimate);
+  EXPECT_NEAR(result.estimate, M_PI, 5 * 2e-3);
+  EXPECT_GT(result.points_per_second, 0.0);
+}
+
+TEST(MonteCarloPiTest, AdaptiveEstimateRespectsPointBudget) {
+  monte_carlo_pi::EstimateResult result = monte_carlo_pi::estimate_pi(1e-9, 300000, 2);
+  EXPECT_EQ(result.points, 300000);
+  EXPECT_GT(result.standard_error, 1e-9);
+  EXPECT_NEAR(result.estimate, M_PI, 0.05);
+}
+
+// Progress and cancellation tests
+TEST(MonteCarloPiTest, ProgressReportsAndFinalResult) {
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 5;
+  options.num_threads = 4;
+  std::vector<monte_carlo_pi::Progress> reports;
+  monte_carlo_pi::EstimateResult result = monte_carlo_pi::calculate_pi_parallel(
+      1000000, options, [&reports](const monte_carlo_pi::Progress & progress) {
+    reports.push_back(progress);
+  }, nullptr, 100000);
+  EXPECT_FALSE(result.cancelled);
+  EXPECT_EQ(result.points, 1000000);
+  EXPECT_DOUBLE_EQ(result.estimate, monte_carlo_pi::calculate_pi_parallel(1000000, options));
+  ASSERT_GE(reports.size(), 5u);
+  EXPECT_EQ(reports.back().points_done, 1000000);
+  EXPECT_EQ(reports.back().hits, result.hits);
+
+  for (size_t i = 1; i < reports.size(); ++i) {
+    EXPECT_GE(reports[i].points_done, reports[i - 1].points_done);
+  }
+}
+
+TEST(MonteCarloPiTest, CancellationReturnsPartialEstimate) {
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 6;
+  monte_carlo_pi::CancellationToken token;
+  // Cancel from inside the first progress report
+  monte_carlo_pi::EstimateResult result = monte_carlo_pi::calculate_pi_parallel(
+      1LL << 40, options, [&token](const monte_carlo_pi::Progress &) {
+    token.cancel();
+  }, &token, 1 << 20);
+  EXPECT_TRUE(token.is_cancelled());
+  EXPECT_TRUE(result.cancelled);
+  EXPECT_GT(result.points, 0);
+  EXPECT_LT(result.points, 1LL << 30);
+  EXPECT_NEAR(result.estimate, M_PI, 0.02);
+  token.reset();
+  EXPECT_FALSE(token.is_cancelled());
+}
+
+TEST(MonteCarloPiTest, EstimatorMatchesParallel) {
+  monte_carlo_pi::PiEstimator estimator(3, 1 << 16);
+  EXPECT_EQ(estimator.num_threads(), 3);
+  EXPECT_DOUBLE_EQ(estimator.calculate_pi(1000003, 7), monte_carlo_pi::calculate_pi_parallel(1000003, 2, 7));
+  EXPECT_EQ(estimator.count_points_inside(12345, 12345, monte_carlo_pi::EstimateOptions()), 0);
+  EXPECT_DOUBLE_EQ(estimator.calculate_pi(0, 7), 0.0);
+}
+
+TEST(MonteCarloPiTest, EstimatorServesConcurrentCallers) {
+  monte_carlo_pi::PiEstimator estimator(2, 1 << 15);
+  std::vector<std::future<double>> futures;
+
+  for (std::uint64_t seed = 1; seed <= 4; ++seed) {
+    futures.push_back(std::async(std::launch::async, [&estimator, seed] {
+      return estimator.calculate_pi(500000, seed);
+    }));
+  }
+
+  for (std::uint64_t seed = 1; seed <= 4; ++seed) {
+    EXPECT_DOUBLE_EQ(futures[seed - 1].get(), monte_carlo_pi::calculate_pi_sequential(500000, seed));
+  }
+}
+
+TEST(MonteCarloPiTest, PoolClaimsIndicesOnDemand) {
+  monte_carlo_pi::WorkStealingPool pool(3);
+  const long long count = 100000;
+  std::vector<std::atomic<int>> runs(count);
+  std::atomic<int> done_calls{0};
+  std::promise<void> done;
+  pool.submit_indexed(count, [&runs](long long index) {
+    runs[index].fetch_add(1);
+  }, [&done_calls, &done] {
+    done_calls.fetch_add(1);
+    done.set_value();
+  });
+  done.get_future().wait();
+
+  for (const std::atomic<int> &run : runs) {
+    EXPECT_EQ(run.load(), 1);
+  }
+
+  EXPECT_EQ(done_calls.load(), 1);
+  // Many small chunks give the same result as a few large ones
+  monte_carlo_pi::PiEstimator estimator(3, 64);
+  EXPECT_DOUBLE_EQ(estimator.calculate_pi(1000003, 7), monte_carlo_pi::calculate_pi_parallel(1000003, 2, 7));
+}
+
+TEST(MonteCarloPiTest, ThreadCountDoesNotChangeGlobalOpenMpState) {
+  const int max_threads = omp_get_max_threads();
+  monte_carlo_pi::calculate_pi_parallel(100000, max_threads + 2, 1);
+  EXPECT_EQ(omp_get_max_threads(), max_threads);
+}
+
+TEST(MonteCarloPiTest, BatchMatchesIndividualEstimates) {
+  std::vector<monte_carlo_pi::BatchRequest> requests;
+
+  for (long long n : {10000LL, 0LL, 250001LL, 16384LL, 1000000LL, 3LL}) {
+    monte_carlo_pi::BatchRequest request;
+    request.num_points = n;
+    request.seed = static_cast<std::uint64_t>(n) * 31 + 5;
+    requests.push_back(request);
+  }
+
+  monte_carlo_pi::EstimateOptions options;
+  options.num_threads = 3;
+  std::vector<double> results(requests.size(), -1.0);
+  monte_carlo_pi::calculate_pi_batch(requests.data(), requests.size(), results.data(), options);
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    options.seed = requests[i].seed;
+    EXPECT_DOUBLE_EQ(results[i], monte_carlo_pi::calculate_pi_parallel(requests[i].num_points, options));
+  }
+}
+
+TEST(MonteCarloPiTest, PlacementOrders) {
+  using monte_carlo_pi::ThreadPlacement;
+  // Two sockets with two cores each; CPU n + 4 is the SMT sibling of CPU n
+  std::vector<monte_carlo_pi::detail::LogicalCpu> cpus;
+
+  for (int cpu = 0; cpu < 8; ++cpu) {
+    monte_carlo_pi::detail::LogicalCpu logical;
+    logical.cpu = cpu;
+    logical.socket = (cpu % 4) / 2;
+    logical.core = cpu % 2;
+    logical.smt = cpu / 4;
+    cpus.push_back(logical);
+  }
+
+  const auto cpu_numbers = [&cpus](ThreadPlacement placement) {
+    std::vector<int> numbers;
+
+    for (const auto &logical : monte_carlo_pi::detail::placement_order(cpus, placement)) {
+      numbers.push_back(logical.cpu);
+    }
+
+    return numbers;
+  };
+  EXPECT_TRUE(cpu_numbers(ThreadPlacement::Default).empty());
+  EXPECT_EQ(cpu_numbers(ThreadPlacement::Compact), std::vector<int>({0, 4, 1, 5, 2, 6, 3, 7}));
+  EXPECT_EQ(cpu_numbers(ThreadPlacement::Scatter), std::vector<int>({0, 2, 1, 3, 4, 6, 5, 7}));
+  EXPECT_EQ(cpu_numbers(ThreadPlacement::PhysicalCores), std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}));
+  EXPECT_EQ(cpu_numbers(ThreadPlacement::NoSmt), std::vector<int>({0, 1, 2, 3}));
+}
+
+TEST(MonteCarloPiTest, PlacementDoesNotChangeResult) {
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 9;
+  options.num_threads = 3;
+  const double expected = monte_carlo_pi::calculate_pi_parallel(300001, options);
+#if defined(__linux__)
+  EXPECT_FALSE(monte_carlo_pi::detail::detect_cpu_topology().empty());
+#endif
+
+  for (auto placement : {monte_carlo_pi::ThreadPlacement::Compact, monte_carlo_pi::ThreadPlacement::Scatter,
+                         monte_carlo_pi::ThreadPlacement::PhysicalCores, monte_carlo_pi::ThreadPlacement::NoSmt
+                        }) {
+    options.placement = placement;
+    EXPECT_DOUBLE_EQ(monte_carlo_pi::calculate_pi_parallel(300001, options), expected);
+    EXPECT_DOUBLE_EQ(monte_carlo_pi::calculate_pi_parallel(300001, options, nullptr, nullptr).estimate, expected);
+  }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(MonteCarloPiTest, ShardedMatchesSingleProcess) {
+  monte_carlo_pi::ShardOptions options;
+  options.num_workers = 3;
+  options.shard_size = 100000;
+  options.estimate.seed = 10;
+  const monte_carlo_pi::ShardedResult result = monte_carlo_pi::calculate_pi_sharded(1234567, options);
+  EXPECT_EQ(result.shards, 13);
+  EXPECT_EQ(result.points, 1234567);
+  EXPECT_EQ(result.lost_workers, 0);
+  EXPECT_DOUBLE_EQ(result.estimate, monte_carlo_pi::calculate_pi_parallel(1234567, 2, 10));
+}
+
+TEST(MonteCarloPiTest, ShardOfDeadWorkerIsReassigned) {
+  monte_carlo_pi::ShardOptions options;
+  options.num_workers = 2;
+  options.worker_threads = 2;
+  options.shard_size = 50000;
+  options.estimate.seed = 11;
+  options.estimate.arithmetic = monte_carlo_pi::Arithmetic::FixedPoint;
+  int kills = 0;
+  // Kill the worker that receives shard 3, the first time only
+  const monte_carlo_pi::ShardedResult result = monte_carlo_pi::detail::calculate_pi_sharded(
+  500000, options, [&kills](int worker_pid, long long shard) {
+    if (shard == 3 && kills++ == 0) {
+      kill(worker_pid, SIGKILL);
+    }
+  });
+  EXPECT_EQ(kills, 2);
+  EXPECT_EQ(result.lost_workers, 1);
+  EXPECT_EQ(result.reassigned_shards, 1);
+  options.estimate.num_threads = 1;
+  EXPECT_DOUBLE_EQ(result.estimate, monte_carlo_pi::calculate_pi_parallel(500000, options.estimate));
+}
+
+TEST(MonteCarloPiTest, ShardOfHungWorkerIsReassigned) {
+  monte_carlo_pi::ShardOptions options;
+  options.num_workers = 2;
+  options.shard_size = 50000;
+  options.shard_timeout = 1.0;
+  options.estimate.seed = 12;
+  int stops = 0;
+  // Freeze the worker that receives shard 2, the first time only; it never dies on its own
+  const monte_carlo_pi::ShardedResult result = monte_carlo_pi::detail::calculate_pi_sharded(
+  300000, options, [&stops](int worker_pid, long long shard) {
+    if (shard == 2 && stops++ == 0) {
+      kill(worker_pid, SIGSTOP);
+    }
+  });
+  EXPECT_EQ(result.lost_workers, 1);
+  EXPECT_EQ(result.reassigned_shards, 1);
+  options.estimate.num_threads = 1;
+  EXPECT_DOUBLE_EQ(result.estimate, monte_carlo_pi::calculate_pi_parallel(300000, options.estimate));
+}
+
+TEST(MonteCarloPiTest, ShardRetriesAreBounded) {
+  monte_carlo_pi::ShardOptions options;
+  options.num_workers = 1;
+  options.shard_size = 1000;
+  options.max_attempts = 2;
+  EXPECT_THROW(monte_carlo_pi::detail::calculate_pi_sharded(5000, options, [](int worker_pid, long long shard) {
+    if (shard == 1) {
+      kill(worker_pid, SIGKILL);
+    }
+  }), std::runtime_error);
+  options.shard_size = 0;
+  EXPECT_THROW(monte_carlo_pi::calculate_pi_sharded(5000, options), std::invalid_argument);
+}
+
+TEST(MonteCarloPiTest, FailedShardRunKillsBusyWorkers) {
+  monte_carlo_pi::ShardOptions options;
+  options.num_workers = 2;
+  options.shard_size = 1000;
+  options.max_attempts = 1;
+  options.shard_timeout = 0.0;
+  // Shard 0 hangs without a timeout; the run must still give up once shard 1 fails
+  EXPECT_THROW(monte_carlo_pi::detail::calculate_pi_sharded(5000, options, [](int worker_pid, long long shard) {
+    kill(worker_pid, shard == 0 ? SIGSTOP : SIGKILL);
+  }), std::runtime_error);
+}
+#endif
+
+TEST(MonteCarloPiTest, UInt128Carries) {
+  monte_carlo_pi::UInt128 value;
+  value.add(~0ull);
+  value.add(2);
+  EXPECT_EQ(value.low, 1u);
+  EXPECT_EQ(value.high, 1u);
+  value.add(value);
+  EXPECT_EQ(value.low, 2u);
+  EXPECT_EQ(value.high, 2u);
+  EXPECT_DOUBLE_EQ(value.to_double(), 2.0 * 18446744073709551616.0 + 2.0);
+}
+
+TEST(MonteCarloPiTest, LongRunResumesFromCheckpoint) {
+  const std::string path = ::testing::TempDir() + "monte_carlo_pi_long_run.ckpt";
+  std::remove(path.c_str());
+  monte_carlo_pi::LongRunOptions options;
+  options.estimate.seed = 12;
+  options.estimate.num_threads = 2;
+  options.shards = 5;
+  options.round_points = 100000;
+  options.checkpoint_interval_seconds = 0.0;
+  const monte_carlo_pi::LongRunResult uninterrupted = monte_carlo_pi::calculate_pi_long_run(1000003, options);
+  EXPECT_FALSE(uninterrupted.cancelled);
+  EXPECT_EQ(uninterrupted.points.low, 1000003u);
+  EXPECT_DOUBLE_EQ(uninterrupted.estimate, monte_carlo_pi::calculate_pi_parallel(1000003, options.estimate));
+  // Stop the first session after its third checkpoint, then resume
+  options.checkpoint_path = path;
+  monte_carlo_pi::CancellationToken token;
+  int checkpoints = 0;
+  options.cancellation = &token;
+  options.on_checkpoint = [&token, &checkpoints](const monte_carlo_pi::Progress &) {
+    if (++checkpoints == 3) {
+      token.cancel();
+    }
+  };
+  const monte_carlo_pi::LongRunResult first = monte_carlo_pi::calculate_pi_long_run(1000003, options);
+  EXPECT_TRUE(first.cancelled);
+  EXPECT_FALSE(first.resumed);
+  EXPECT_EQ(first.points.low, 300000u);
+  token.reset();
+  options.on_checkpoint = nullptr;
+  const monte_carlo_pi::LongRunResult second = monte_carlo_pi::calculate_pi_long_run(1000003, options);
+  EXPECT_TRUE(second.resumed);
+  EXPECT_FALSE(second.cancelled);
+  EXPECT_TRUE(second.hits == uninterrupted.hits);
+  EXPECT_DOUBLE_EQ(second.estimate, uninterrupted.estimate);
+  // A checkpoint of another run is rejected
+  options.estimate.seed = 13;
+  EXPECT_THROW(monte_carlo_pi::calculate_pi_long_run(1000003, options), std::invalid_argument);
+  std::remove(path.c_str());
+}
+
+TEST(MonteCarloPiTest, RunningMomentsIsStableForLargeOffsets) {
+  // E[x^2] - mean^2 loses every digit here; Welford keeps them
+  Can::Utility::RunningMoments stats;
+
+  for (double x : {1e9 + 4.0, 1e9 + 7.0, 1e9 + 13.0, 1e9 + 16.0}) {
+    stats.add(x);
+  }
+
+  EXPECT_DOUBLE_EQ(stats.mean(), 1e9 + 10.0);
+  EXPECT_DOUBLE_EQ(stats.variance(), 30.0);
+  EXPECT_DOUBLE_EQ(stats.min(), 1e9 + 4.0);
+  EXPECT_DOUBLE_EQ(stats.max(), 1e9 + 16.0);
+}
+
+TEST(MonteCarloPiTest, TimingSummaryRejectsOutliers) {
+  std::vector<double> times = {1.00, 1.02, 0.98, 1.01, 0.99, 1.03, 0.97, 1.00, 5.00};
+  const monte_carlo_pi::TimingStats stats = monte_carlo_pi::summarize_times(times);
+  EXPECT_EQ(stats.outliers, 1);
+  EXPECT_EQ(stats.runs, 8);
+  EXPECT_NEAR(stats.median, 1.0, 1e-12);
+  EXPECT_LT(stats.max, 1.1);
+  EXPECT_LE(stats.ci_lower, stats.median);
+  EXPECT_GE(stats.ci_upper, stats.median);
+  EXPECT_GE(stats.p99, stats.p90);
+  EXPECT_DOUBLE_EQ(monte_carlo_pi::percentile({1.0, 2.0, 3.0, 4.0}, 0.5), 2.5);
+  monte_carlo_pi::TimingOptions keep_all;
+  keep_all.outlier_threshold = 0.0;
+  EXPECT_EQ(monte_carlo_pi::summarize_times(times, keep_all).runs, 9);
+}
+
+TEST(MonteCarloPiTest, BaselineFlagsSignificantSlowdown) {
+  std::vector<double> fast;
+  std::vector<double> slow;
+  std::vector<double> noisy;
+
+  for (int i = 0; i < 20; ++i) {
+    fast.push_back(1.0 + 0.001 * (i % 5));
+    slow.push_back(1.2 + 0.001 * (i % 5));
+    noisy.push_back(1.0 + 0.001 * (i % 5) + (i % 2 == 0 ? 0.3 : -0.3));
+  }
+
+  std::map<std::string, monte_carlo_pi::TimingStats> baseline = {
+    {"a", monte_carlo_pi::summarize_times(fast)}, {"b", monte_carlo_pi::summarize_times(fast)}, {"c", monte_carlo_pi::summarize_times(fast)}
+  };
+  const std::string path = ::testing::TempDir() + "monte_carlo_pi_baseline.tsv";
+  ASSERT_TRUE(monte_carlo_pi::save_baseline(path, baseline));
+  std::map<std::string, monte_carlo_pi::TimingStats> loaded;
+  ASSERT_TRUE(monte_carlo_pi::load_baseline(path, &loaded));
+  std::remove(path.c_str());
+  ASSERT_EQ(loaded.size(), 3u);
+  EXPECT_DOUBLE_EQ(loaded["a"].median, baseline["a"].median);
+  const std::map<std::string, monte_carlo_pi::TimingStats> current = {
+    {"a", monte_carlo_pi::summarize_times(fast)}, {"b", monte_carlo_pi::summarize_times(slow)}, {"c", monte_carlo_pi::summarize_times(noisy)}
+  };
+  const std::vector<monte_carlo_pi::RegressionCheck> checks = monte_carlo_pi::compare_to_baseline(loaded, current);
+  ASSERT_EQ(checks.size(), 3u);
+  EXPECT_FALSE(checks[0].regression);
+  EXPECT_TRUE(checks[1].regression);
+  EXPECT_NEAR(checks[1].ratio, 1.2, 0.01);
+  EXPECT_FALSE(checks[2].regression);
+}
+
+TEST(MonteCarloPiTest, ProfiledEstimatesMatchUninstrumented) {
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 14;
+  options.num_threads = 3;
+  const monte_carlo_pi::ProfiledEstimate parallel = monte_carlo_pi::calculate_pi_parallel_profiled(1000003, options);
+  EXPECT_DOUBLE_EQ(parallel.estimate, monte_carlo_pi::calculate_pi_parallel(1000003, options));
+  ASSERT_FALSE(parallel.threads.empty());
+  long long points = 0;
+
+  for (const monte_carlo_pi::ThreadProfile &thread : parallel.threads) {
+    points += thread.points;
+  }
+
+  EXPECT_EQ(points, 1000003);
+  // Placement takes the placed reduction, which is profiled the same way
+  options.placement = monte_carlo_pi::ThreadPlacement::Compact;
+  const monte_carlo_pi::ProfiledEstimate placed = monte_carlo_pi::calculate_pi_parallel_profiled(1000003, options);
+  EXPECT_DOUBLE_EQ(placed.estimate, parallel.estimate);
+  points = 0;
+
+  for (const monte_carlo_pi::ThreadProfile &thread : placed.threads) {
+    points += thread.points;
+  }
+
+  EXPECT_EQ(points, 1000003);
+  const monte_carlo_pi::ProfiledEstimate sequential = monte_carlo_pi::generate_points_profiled(100000, 14);
+  EXPECT_DOUBLE_EQ(sequential.estimate, monte_carlo_pi::calculate_pi_sequential(100000, 14));
+  ASSERT_EQ(sequential.threads.size(), 1u);
+
+  // Counters are optional; when the host provides them they must be plausible
+  if (monte_carlo_pi::PerfCounters().supported() && parallel.total.has(monte_carlo_pi::HardwareEvent::Instructions)) {
+    EXPECT_GT(parallel.per_point(monte_carlo_pi::HardwareEvent::Instructions), 1.0);
+  } else {
+    EXPECT_LT(parallel.per_point(monte_carlo_pi::HardwareEvent::Instructions), 0.0);
+  }
+}
+
+TEST(MonteCarloPiTest, TraceRecordsThreadTimeline) {
+  const long long num_points = 1 << 20;
+  const double expected = monte_carlo_pi::calculate_pi_parallel(num_points, 2, 42);
+  monte_carlo_pi::clear_trace();
+  monte_carlo_pi::set_tracing_enabled(true);
+  const double traced = monte_carlo_pi::calculate_pi_parallel(num_points, 2, 42);
+  monte_carlo_pi::set_tracing_enabled(false);
+  EXPECT_EQ(traced, expected);
+
+  // 64 blocks, the region itself, and start and reduction of each thread
+  const std::size_t spans = monte_carlo_pi::trace_span_count();
+  EXPECT_GE(spans, 64u + 1u + 2u);
+  std::ostringstream out;
+  monte_carlo_pi::write_chrome_trace(out);
+  const std::string json = out.str();
+  EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\": \"block\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\": \"reduction\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\": \"thread_start\""), std::string::npos);
+
+  // Nothing is recorded while tracing is off
+  monte_carlo_pi::calculate_pi_parallel(num_points, 2, 42);
+  EXPECT_EQ(monte_carlo_pi::trace_span_count(), spans);
+  monte_carlo_pi::clear_trace();
+  EXPECT_EQ(monte_carlo_pi::trace_span_count(), 0u);
+}
+
+TEST(MonteCarloPiTest, TraceReusesBuffersOfExitedThreads) {
+  const auto count_tracks = [] {
+    std::ostringstream out;
+    monte_carlo_pi::write_chrome_trace(out);
+    const std::string json = out.str();
+    std::size_t tracks = 0;
+
+    for (std::size_t at = json.find("thread_name"); at != std::string::npos; at = json.find("thread_name", at + 1)) {
+      ++tracks;
+    }
+
+    return tracks;
+  };
+
+  monte_carlo_pi::clear_trace();
+  monte_carlo_pi::set_tracing_enabled(true);
+
+  // Short-lived threads one after another share a single buffer
+  for (int i = 0; i < 20; ++i) {
+    std::thread([i] {
+      const monte_carlo_pi::TraceScope span("short_lived", i);
+    }).join();
+  }
+
+  monte_carlo_pi::set_tracing_enabled(false);
+  EXPECT_EQ(monte_carlo_pi::trace_span_count(), 20u);
+  EXPECT_EQ(count_tracks(), 1u);
+  monte_carlo_pi::clear_trace();
+}
+
+TEST(MonteCarloPiTest, EngineMatchesKernelsAndIntegrates) {
+  // The inlined per-point loop reproduces the SIMD kernels bit for bit
+  const monte_carlo_pi::PhiloxPoints points(21);
+  const long long generic = monte_carlo_pi::sample_sum<2, long long>(monte_carlo_pi::UnitBallIndicator<2>(), points, 1000, 250000);
+  EXPECT_EQ(generic, monte_carlo_pi::count_points_inside(21, 1000, 250000));
+
+  monte_carlo_pi::EngineOptions options;
+  options.block_size = 4096;
+
+  for (int threads : {1, 3}) {
+    options.num_threads = threads;
+    const long long hits = monte_carlo_pi::sample_sum<2, long long>(monte_carlo_pi::UnitBallIndicator<2>(), points, 1000, 250000, options);
+    EXPECT_EQ(hits, generic);
+  }
+
+  // Volume of the 3-ball is 4/3 Pi; the estimate has a relative error of about 0.3%
+  EXPECT_NEAR(monte_carlo_pi::hypersphere_volume<3>(1000000, 5), 4.0 / 3.0 * std::acos(-1.0), 0.05);
+
+  // Integral of x1 * x2 * ... * x5 over the unit cube is 2^-5
+  const monte_carlo_pi::IntegrationResult product = monte_carlo_pi::integrate<5>([](const std::array<double, 5> &x) {
+    return x[0] * x[1] * x[2] * x[3] * x[4];
+  }, 1000000, 9);
+  EXPECT_EQ(product.points, 1000000);
+  EXPECT_GT(product.std_error, 0.0);
+  EXPECT_NEAR(product.value, 1.0 / 32.0, 5.0 * product.std_error);
+
+  // A large offset must not cancel the spread: x + 1e9 has variance 1/12
+  const monte_carlo_pi::IntegrationResult offset = monte_carlo_pi::integrate<1>([](const std::array<double, 1> &x) {
+    return x[0] + 1e9;
+  }, 100000, 9, options);
+  EXPECT_NEAR(offset.std_error, std::sqrt(1.0 / 12.0 / 100000.0), 1e-4);
+}
+
+TEST(MonteCarloPiTest, VarianceReductionBeatsPlainSampling) {
+  const double pi = std::acos(-1.0);
+  monte_carlo_pi::EstimateOptions options;
+  options.num_threads = 2;
+  options.seed = 7;
+  // Minimum variance reduction of every strategy at 200000 points
+  const std::map<monte_carlo_pi::VarianceReduction, double> expected_gain = {
+    {monte_carlo_pi::VarianceReduction::None, 0.9},
+    {monte_carlo_pi::VarianceReduction::Stratified, 50.0},
+    {monte_carlo_pi::VarianceReduction::Antithetic, 1.2},
+    {monte_carlo_pi::VarianceReduction::ControlVariate, 2.5}
+  };
+
+  for (const auto &entry : expected_gain) {
+    const monte_carlo_pi::VarianceReducedResult result = monte_carlo_pi::calculate_pi_variance_reduced(200000, entry.first, options);
+    SCOPED_TRACE(monte_carlo_pi::variance_reduction_name(entry.first));
+    EXPECT_GT(result.points, 199000);
+    EXPECT_LE(result.points, 200000);
+    EXPECT_GT(result.std_error, 0.0);
+    EXPECT_NEAR(result.estimate, pi, 5.0 * result.std_error);
+    EXPECT_GT(result.variance_reduction, entry.second);
+  }
+
+  EXPECT_EQ(monte_carlo_pi::calculate_pi_variance_reduced(1, monte_carlo_pi::VarianceReduction::Stratified, options).points, 0);
+}
+
+TEST(MonteCarloPiTest, RngEnginesMatchReferenceOutputs) {
+  monte_carlo_pi::Xoshiro256PlusPlus xoshiro(std::array<std::uint64_t, 4> {1, 2, 3, 4});
+  EXPECT_EQ(xoshiro(), 41943041u);
+
+  // pcg64_srandom_r(&rng, 42, 54) of the reference implementation
+  monte_carlo_pi::Pcg64 pcg(42, 54);
+  EXPECT_EQ(pcg(), 0x86B1DA1D72062B68ull);
+  EXPECT_EQ(pcg(), 0x1304AA46C9853D39ull);
+  EXPECT_EQ(pcg(), 0xA3670E9E0DD50358ull);
+
+  // sfmt_init_gen_rand(1234): 32-bit outputs 3440181298 1564997079 1510669302 2930277156
+  monte_carlo_pi::Sfmt19937 sfmt(1234u);
+  EXPECT_EQ(sfmt(), 3440181298ull | (1564997079ull << 32));
+  EXPECT_EQ(sfmt(), 1510669302ull | (2930277156ull << 32));
+
+  for (std::uint64_t bits : {0ull, 1ull << 12, 0xFFFFFFFFFFFFFFFFull, 0x123456789ABCDEF0ull}) {
+    EXPECT_EQ(monte_carlo_pi::detail::bits_to_unit_double(bits), monte_carlo_pi::detail::to_unit_double(bits));
+  }
+}
+
+TEST(MonteCarloPiTest, RngEnginesAreSelectableByName) {
+  const double pi = std::acos(-1.0);
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 5;
+
+  for (const monte_carlo_pi::RngEngine &engine : monte_carlo_pi::rng_engines()) {
+    SCOPED_TRACE(engine.name);
+    options.num_threads = 1;
+    const double single = monte_carlo_pi::calculate_pi_with_engine(engine.name, 1000000, options);
+    EXPECT_NEAR(single, pi, 0.01);
+
+    // Substreams make every engine independent of the thread count and of unaligned ranges
+    options.num_threads = 3;
+    EXPECT_EQ(monte_carlo_pi::calculate_pi_with_engine(engine.name, 1000000, options), single);
+    EXPECT_EQ(engine.count_points_inside(0, 30000, options),
+              engine.count_points_inside(0, 12345, options) + engine.count_points_inside(12345, 30000, options));
+  }
+
+  EXPECT_EQ(monte_carlo_pi::calculate_pi_with_engine("philox", 100000, options), monte_carlo_pi::calculate_pi_parallel(100000, options));
+  EXPECT_THROW(monte_carlo_pi::calculate_pi_with_engine("mt19937", 1000, options), std::invalid_argument);
+}
+
+TEST(MonteCarloPiTest, AsyncEstimatesShareOneExecutor) {
+  monte_carlo_pi::AsyncExecutor executor(2, 1 << 16);
+  monte_carlo_pi::EstimateOptions options;
+  std::vector<monte_carlo_pi::EstimateFuture<double>> futures;
+
+  // Hundreds of outstanding requests run on the same two workers
+  for (int i = 0; i < 200; ++i) {
+    options.seed = static_cast<std::uint64_t>(i);
+    futures.push_back(executor.calculate_pi(100000 + i, options));
+  }
+
+  const monte_carlo_pi::EstimateFuture<std::vector<double>> all = monte_carlo_pi::when_all(futures);
+  const monte_carlo_pi::EstimateFuture<double> mean = all.then([](const std::vector<double> &values) {
+    return std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+  });
+  const std::vector<double> values = all.get();
+  ASSERT_EQ(values.size(), 200u);
+
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(values[i], monte_carlo_pi::calculate_pi_parallel(100000 + i, 1, static_cast<std::uint64_t>(i)));
+  }
+
+  EXPECT_NEAR(mean.get(), M_PI, 0.01);
+
+  // Continuations chain, and an exception skips the rest of the chain
+  options.seed = 3;
+  const double chained = executor.calculate_pi(1 << 20, options).then([](double pi) {
+    return pi / 4.0;
+  }).then([](double quarter) {
+    return quarter * 4.0;
+  }).get();
+  EXPECT_EQ(chained, monte_carlo_pi::calculate_pi_parallel(1 << 20, options));
+  const monte_carlo_pi::EstimateFuture<int> failed = executor.submit([]() -> int {
+    throw std::runtime_error("failed");
+  }).then([](int value) {
+    return value + 1;
+  });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+  EXPECT_THROW(monte_carlo_pi::when_all(std::vector<monte_carlo_pi::EstimateFuture<int>> {failed}).get(), std::runtime_error);
+}
+
+TEST(MonteCarloPiTest, AsyncExecutorRunsHigherPriorityFirst) {
+  monte_carlo_pi::AsyncExecutor executor(1);
+  std::promise<void> gate;
+  std::shared_future<void> open = gate.get_future().share();
+  std::mutex mutex;
+  std::vector<int> order;
+  const auto record = [&mutex, &order](int value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    order.push_back(value);
+    return value;
+  };
+
+  // Occupy the only worker so that the next three tasks queue up
+  const monte_carlo_pi::EstimateFuture<int> blocker = executor.submit([open] {
+    open.wait();
+    return 0;
+  });
+  const auto low = executor.submit([&record] {
+    return record(0);
+  }, monte_carlo_pi::TaskPriority::Low);
+  const auto normal = executor.submit([&record] {
+    return record(1);
+  });
+  const auto high = executor.submit([&record] {
+    return record(2);
+  }, monte_carlo_pi::TaskPriority::High);
+  gate.set_value();
+  low.get();
+  normal.get();
+  high.get();
+  blocker.get();
+  EXPECT_EQ(order, (std::vector<int> {2, 1, 0}));
+}
+
+TEST(MonteCarloPiTest, ResultCacheComputesOnlyMissingRanges) {
+  monte_carlo_pi::ResultCache cache;
+  monte_carlo_pi::EstimateOptions options;
+  options.seed = 17;
+  options.num_threads = 2;
+
+  // Growing requests sample only the new range and still match an uncached run
+  for (long long points : {1LL << 20, 1LL << 21, 1LL << 21, 3LL << 20}) {
+    EXPECT_EQ(cache.calculate_pi(points, options), monte_carlo_pi::calculate_pi_parallel(points, options));
+  }
+
+  monte_carlo_pi::CacheStats stats = cache.stats();
+  EXPECT_EQ(stats.lookups, 4);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.partial_hits, 2);
+  EXPECT_EQ(stats.full_hits, 1);
+  EXPECT_EQ(stats.points_computed, 3LL << 20);
+  EXPECT_EQ(stats.entries, 3u);
+
+  // Another seed or arithmetic is another stream
+  options.arithmetic = monte_carlo_pi::Arithmetic::FixedPoint;
+  EXPECT_EQ(cache.calculate_pi(1 << 20, options), monte_carlo_pi::calculate_pi_parallel(1 << 20, options));
+  EXPECT_EQ(cache.stats().misses, 2);
+  options.arithmetic = monte_carlo_pi::Arithmetic::Double;
+
+  // A reloaded cache answers from the file
+  const std::string path = ::testing::TempDir() + "monte_carlo_pi_cache.tsv";
+  ASSERT_TRUE(cache.save(path));
+  monte_carlo_pi::ResultCache reloaded(4);
+  ASSERT_TRUE(reloaded.load(path));
+  std::ifstream saved(path);
+  std::string version;
+  std::getline(saved, version);
+  EXPECT_EQ(version, "# monte_carlo_pi cache v1");
+  saved.close();
+
+  // A file of another version is rejected rather than trusted
+  {
+    std::ofstream stale(path);
+    stale << "# monte_carlo_pi cache v0\n17\t0\t0\t1024\t800\n";
+  }
+  monte_carlo_pi::ResultCache rejected(4);
+  EXPECT_FALSE(rejected.load(path));
+  EXPECT_EQ(rejected.stats().entries, 0u);
+  std::remove(path.c_str());
+  EXPECT_EQ(reloaded.stats().entries, 4u);
+  EXPECT_EQ(reloaded.calculate_pi(1LL << 21, options), monte_carlo_pi::calculate_pi_parallel(1LL << 21, options));
+  EXPECT_EQ(reloaded.stats().full_hits, 1);
+
+  // The least recently used segment, [2^21, 3 * 2^20), goes first
+  options.seed = 18;
+  reloaded.calculate_pi(1 << 16, options);
+  EXPECT_EQ(reloaded.stats().evictions, 1);
+  EXPECT_EQ(reloaded.stats().entries, 4u);
+  options.seed = 17;
+  reloaded.calculate_pi(3LL << 20, options);
+  EXPECT_EQ(reloaded.stats().partial_hits, 1);
+}
+
 } // namespace
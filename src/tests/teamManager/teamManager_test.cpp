@@ -1,9 +1,15 @@
 //#define ENABLE_teamManager_TEST  // Uncomment this line to enable the teamManager tests
 
 #include "gtest/gtest.h"
-#include "../../teamManager/header/teamManager.h"  // Adjust this include path based on your project structure
+#include "teamManager.h"
+#include "teamManagerExpression.h"
 
-using namespace Can::teamManager;
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+using namespace Coruh::teamManager;
 
 class teamManagerTest : public ::testing::Test {
  protected:
@@ -40,6 +46,116 @@ TEST_F(teamManagerTest, TestDivideByZero) {
   EXPECT_THROW(teamManager::divide(5.0, 0.0), std::invalid_argument);
 }
 
+TEST_F(teamManagerTest, TestBatchedMatchesScalar) {
+  // Two chunks and a tail that is not a multiple of the vector width
+  const size_t count = 2 * teamManager::kChunkSize + 7;
+  std::vector<double> a(count);
+  std::vector<double> b(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    a[i] = 0.25 * static_cast<double>(i) - 1000.0;
+    b[i] = 1.0 + static_cast<double>(i % 97);
+  }
+
+  for (int threads : { 1, 4 }) {
+    std::vector<double> sum(count);
+    std::vector<double> difference(count);
+    std::vector<double> product(count);
+    teamManager::add(a.data(), b.data(), sum.data(), count, threads);
+    teamManager::subtract(a.data(), b.data(), difference.data(), count, threads);
+    teamManager::multiply(a.data(), b.data(), product.data(), count, threads);
+
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(sum[i], teamManager::add(a[i], b[i]));
+      ASSERT_EQ(difference[i], teamManager::subtract(a[i], b[i]));
+      ASSERT_EQ(product[i], teamManager::multiply(a[i], b[i]));
+    }
+  }
+
+  // The output may be one of the inputs
+  std::vector<double> inPlace = a;
+  teamManager::add(inPlace.data(), b.data(), inPlace.data(), count);
+  EXPECT_EQ(inPlace[count - 1], a[count - 1] + b[count - 1]);
+}
+
+TEST_F(teamManagerTest, TestBatchedDivideReportsZeros) {
+  const size_t count = teamManager::kChunkSize + 130;
+  std::vector<double> a(count, 6.0);
+  std::vector<double> b(count, 3.0);
+  const size_t zeros[] = { 0, 5, 63, 64, 65, teamManager::kChunkSize, count - 1 };
+
+  for (size_t zero : zeros) {
+    b[zero] = zero % 2 == 0 ? 0.0 : -0.0;
+  }
+
+  for (int threads : { 1, 3 }) {
+    std::vector<double> quotient(count);
+    std::vector<uint64_t> errors(teamManager::errorWords(count), ~uint64_t(0));
+    EXPECT_EQ(teamManager::divide(a.data(), b.data(), quotient.data(), count, errors.data(), threads), 7u);
+
+    for (size_t i = 0; i < count; ++i) {
+      const bool zero = std::find(std::begin(zeros), std::end(zeros), i) != std::end(zeros);
+      ASSERT_EQ(((errors[i / 64] >> (i % 64)) & 1) != 0, zero) << "i = " << i;
+      ASSERT_TRUE(zero ? std::isnan(quotient[i]) : quotient[i] == 2.0) << "i = " << i;
+    }
+  }
+
+  // Without a bitmap only the count is reported
+  std::vector<double> quotient(count);
+  EXPECT_EQ(teamManager::divide(a.data(), b.data(), quotient.data(), count), 7u);
+  EXPECT_EQ(teamManager::errorWords(64), 1u);
+  EXPECT_EQ(teamManager::errorWords(65), 2u);
+}
+
+TEST_F(teamManagerTest, TestExpressionMatchesChainedCalls) {
+  const size_t count = teamManager::kChunkSize + 300;
+  std::vector<double> a(count);
+  std::vector<double> b(count);
+  std::vector<double> c(count);
+  std::vector<double> d(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    a[i] = 0.5 * static_cast<double>(i);
+    b[i] = 3.0 - static_cast<double>(i % 7);
+    c[i] = 1.0 + static_cast<double>(i % 5);
+    d[i] = static_cast<double>(i % 11) - 5.0;
+  }
+
+  // Reference: one batched call per operation, with full temporaries
+  std::vector<double> expected(count);
+  std::vector<uint64_t> expectedErrors(teamManager::errorWords(count));
+  teamManager::add(a.data(), b.data(), expected.data(), count);
+  teamManager::multiply(expected.data(), c.data(), expected.data(), count);
+  const size_t expectedZeros = teamManager::divide(expected.data(), d.data(), expected.data(), count,
+                               expectedErrors.data());
+  ASSERT_GT(expectedZeros, 0u);
+  const auto A = expression(a.data(), count);
+  const auto B = expression(b.data(), count);
+  const auto C = expression(c.data(), count);
+  const auto D = expression(d.data(), count);
+
+  for (int threads : { 1, 3 }) {
+    std::vector<double> result(count);
+    std::vector<uint64_t> errors(teamManager::errorWords(count));
+    EXPECT_EQ(evaluate((A + B) * C / D, result.data(), errors.data(), threads), expectedZeros);
+    EXPECT_TRUE(errors == expectedErrors);
+
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_TRUE(std::isnan(expected[i]) ? std::isnan(result[i]) : result[i] == expected[i]) << "i = " << i;
+    }
+  }
+
+  // Scalars mix with arrays, and the result may overwrite an input
+  std::vector<double> scaled = a;
+  EXPECT_EQ(evaluate(2.0 * expression(scaled.data(), count) - 1.0, scaled.data()), 0u);
+  EXPECT_EQ(scaled[10], 2.0 * a[10] - 1.0);
+  // A scalar zero divisor flags every element
+  std::vector<double> result(count);
+  EXPECT_EQ(evaluate(A / 0.0 + B, result.data()), count);
+  EXPECT_TRUE(std::isnan(result[0]));
+  EXPECT_THROW(evaluate(A + expression(b.data(), count - 1), result.data()), std::invalid_argument);
+}
+
 /**
  * @brief The main function of the test program.
  *
@@ -7,6 +7,10 @@
 #include <fstream>
 #include <sys/stat.h>
 #include <cstdio>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
 #ifdef _WIN32
   #include <direct.h>
 #elif __linux__
@@ -117,6 +121,159 @@ TEST_F(MathUtilityTest, CalculateMinMaxTest_2) {
 
 
 
+TEST_F(MathUtilityTest, CalculateMeanEmptyThrows) {
+  const double data[] = { 1.0 };
+  EXPECT_THROW(MathUtility::calculateMean(data, 0), std::invalid_argument);
+  EXPECT_THROW(MathUtility::calculateMedian(nullptr, 3), std::invalid_argument);
+}
+
+TEST_F(MathUtilityTest, CalculateMomentsLargeOffset) {
+  // Values 1e9 + i % 1000 with an odd length, so blocks and chunks have tails
+  std::vector<double> data(3 * MathUtility::kChunkSize + 12345);
+  long double sum = 0.0L;
+
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = 1e9 + static_cast<double>(i % 1000);
+    sum += data[i];
+  }
+
+  const long double mean = sum / data.size();
+  long double m2 = 0.0L;
+
+  for (double value : data) {
+    m2 += (value - mean) * (value - mean);
+  }
+
+  const RunningMoments moments = MathUtility::calculateMoments(data.data(), data.size(), 4);
+  EXPECT_EQ(moments.count(), static_cast<int64_t>(data.size()));
+  EXPECT_NEAR(moments.mean(), static_cast<double>(mean), 1e-6);
+  EXPECT_NEAR(moments.variance(), static_cast<double>(m2 / (data.size() - 1)), 1e-6);
+  EXPECT_DOUBLE_EQ(moments.min(), 1e9);
+  EXPECT_DOUBLE_EQ(moments.max(), 1e9 + 999.0);
+  // Chunks merge in a fixed order, so the thread count does not change the result
+  const RunningMoments single = MathUtility::calculateMoments(data.data(), data.size(), 1);
+  EXPECT_EQ(single.mean(), moments.mean());
+  EXPECT_EQ(single.variance(), moments.variance());
+}
+
+TEST_F(MathUtilityTest, RunningMomentsMerge) {
+  RunningMoments all;
+  RunningMoments left;
+  RunningMoments right;
+
+  for (int i = 0; i < 1000; ++i) {
+    const double value = 0.5 * i - 3.0;
+    all.add(value);
+    (i < 300 ? left : right).add(value);
+  }
+
+  left.merge(right);
+  EXPECT_EQ(left.count(), 1000);
+  EXPECT_NEAR(left.mean(), all.mean(), 1e-12);
+  EXPECT_NEAR(left.variance(), all.variance(), 1e-9);
+  EXPECT_DOUBLE_EQ(left.min(), -3.0);
+  EXPECT_DOUBLE_EQ(left.max(), 496.5);
+}
+
+TEST_F(MathUtilityTest, PairwiseSumAccuracy) {
+  // Naive summation of 10^7 tenths is off by about 1.6e-4
+  std::vector<double> data(10000000, 0.1);
+  EXPECT_NEAR(MathUtility::pairwiseSum(data.data(), data.size()), 1e6, 1e-8);
+  PairwiseSum first;
+  PairwiseSum second;
+  first.add(data.data(), 4000001);
+  second.add(0.1);
+  second.add(data.data(), data.size() - 4000002);
+  first.merge(second);
+  EXPECT_EQ(first.count(), static_cast<int64_t>(data.size()));
+  EXPECT_NEAR(first.sum(), 1e6, 1e-8);
+}
+
+TEST_F(MathUtilityTest, SelectInPlaceMatchesSort) {
+  // Many duplicates and more values than one selection round handles directly
+  std::mt19937_64 engine(7);
+  std::vector<double> data(5 * MathUtility::kChunkSize + 77);
+
+  for (double &value : data) {
+    value = static_cast<double>(engine() % 100000);
+  }
+
+  std::vector<double> sorted = data;
+  std::sort(sorted.begin(), sorted.end());
+
+  for (size_t k : { size_t(0), size_t(12345), data.size() / 2, data.size() - 1 }) {
+    std::vector<double> values = data;
+    EXPECT_EQ(MathUtility::selectInPlace(values.data(), values.size(), k, 3), sorted[k]);
+    EXPECT_LE(*std::max_element(values.begin(), values.begin() + k), values[k]);
+    EXPECT_GE(*std::min_element(values.begin() + k, values.end()), values[k]);
+    std::sort(values.begin(), values.end());
+    EXPECT_TRUE(values == sorted);
+  }
+
+  std::vector<double> equal(data.size(), 2.5);
+  EXPECT_EQ(MathUtility::selectInPlace(equal.data(), equal.size(), 1000), 2.5);
+  EXPECT_THROW(MathUtility::selectInPlace(equal.data(), equal.size(), equal.size()), std::invalid_argument);
+}
+
+TEST_F(MathUtilityTest, CalculateMedianLargeEven) {
+  std::vector<double> data(4 * MathUtility::kChunkSize + 2);
+
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<double>((i * 7919) % data.size());
+  }
+
+  // Values are a permutation of 0 .. n - 1
+  const double expected = (data.size() - 1) / 2.0;
+  EXPECT_DOUBLE_EQ(MathUtility::calculateMedian(data.data(), static_cast<int>(data.size())), expected);
+  EXPECT_DOUBLE_EQ(MathUtility::calculateMedianInPlace(data.data(), data.size(), 2), expected);
+}
+
+TEST_F(MathUtilityTest, TDigestQuantiles) {
+  std::mt19937_64 engine(11);
+  std::exponential_distribution<double> latency(1.0);
+  std::vector<double> data(1000000);
+
+  for (double &value : data) {
+    value = latency(engine);
+  }
+
+  std::vector<double> sorted = data;
+  std::sort(sorted.begin(), sorted.end());
+  const TDigest digest = MathUtility::calculateDigest(data.data(), data.size(), 200.0);
+  EXPECT_EQ(digest.count(), static_cast<int64_t>(data.size()));
+  EXPECT_LE(digest.centroidCount(), 200u);
+  EXPECT_EQ(digest.quantile(0.0), sorted.front());
+  EXPECT_EQ(digest.quantile(1.0), sorted.back());
+
+  const auto exact = [&sorted](double q) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+  };
+
+  for (double q : { 0.01, 0.5, 0.9, 0.99, 0.999 }) {
+    // Errors are in rank: the estimate must lie between the exact q - 0.001 and q + 0.001 quantiles
+    const double estimate = digest.quantile(q);
+    EXPECT_GE(estimate, exact(q - 0.001)) << "q = " << q;
+    EXPECT_LE(estimate, exact(q + 0.001)) << "q = " << q;
+    EXPECT_NEAR(digest.cdf(exact(q)), q, 0.001) << "q = " << q;
+  }
+
+  // Digests of parts merge, and travel between processes as text
+  TDigest first;
+  TDigest second;
+  first.add(data.data(), data.size() / 3);
+  second.add(data.data() + data.size() / 3, data.size() - data.size() / 3);
+  std::stringstream text;
+  second.write(text);
+  TDigest received;
+  ASSERT_TRUE(TDigest::read(text, &received));
+  first.merge(received);
+  EXPECT_EQ(first.count(), digest.count());
+  EXPECT_GE(first.quantile(0.99), sorted[989000]);
+  EXPECT_LE(first.quantile(0.99), sorted[991000]);
+  std::stringstream garbage("tdigest 100 5 0 1 1\n0.5 4\n");
+  EXPECT_FALSE(TDigest::read(garbage, &received));
+}
+
 /**
  * @brief The main function of the test program.
  *
@@ -0,0 +1,410 @@
+/**
+ * @file mathUtility.h
+ *
+ * @brief Provides statistics and math utilities
+ */
+
+#ifndef MATH_UTILITY_H
+#define MATH_UTILITY_H
+
+#include "commonTypes.h"
+#include <iosfwd>
+#include <vector>
+
+namespace Can {
+namespace Utility {
+/**
+    @class RunningMoments
+    @brief Single-pass count, mean, variance, minimum and maximum that can be merged
+
+    Samples are accumulated with Welford's update and partial results are
+    combined with the pairwise formula of Chan, Golub and LeVeque, so
+    threads can summarise their own part of the data and merge at the end
+    without losing accuracy for data with a large offset.
+*/
+class RunningMoments {
+ public:
+  /**
+   * Creates empty moments.
+   */
+  RunningMoments();
+
+  /**
+   * Creates moments from precomputed values.
+   * @param count Number of samples.
+   * @param mean Mean of the samples.
+   * @param m2 Sum of squared deviations from the mean.
+   * @param min Smallest sample.
+   * @param max Largest sample.
+   */
+  RunningMoments(int64_t count, double mean, double m2, double min, double max);
+
+  /**
+   * Adds one sample.
+   * @param x Sample value.
+   */
+  void add(double x);
+
+  /**
+   * Adds an array of samples with the vectorised block kernel.
+   * @param data Samples.
+   * @param count Number of samples.
+   */
+  void add(const double *data, size_t count);
+
+  /**
+   * Adds the samples summarised by other moments.
+   * @param other Moments of disjoint samples.
+   */
+  void merge(const RunningMoments &other);
+
+  /**
+   * Returns the number of samples.
+   * @return Sample count.
+   */
+  int64_t count() const;
+
+  /**
+   * Returns the mean.
+   * @return Mean, 0 without samples.
+   */
+  double mean() const;
+
+  /**
+   * Returns the sum of the samples.
+   * @return count() * mean().
+   */
+  double sum() const;
+
+  /**
+   * Returns the unbiased sample variance.
+   * @return Variance, 0 with fewer than two samples.
+   */
+  double variance() const;
+
+  /**
+   * Returns the population variance.
+   * @return Variance with divisor count(), 0 without samples.
+   */
+  double populationVariance() const;
+
+  /**
+   * Returns the sample standard deviation.
+   * @return Square root of variance().
+   */
+  double stdDev() const;
+
+  /**
+   * Returns the smallest sample.
+   * @return Minimum, +infinity without samples.
+   */
+  double min() const;
+
+  /**
+   * Returns the largest sample.
+   * @return Maximum, -infinity without samples.
+   */
+  double max() const;
+
+ private:
+  int64_t count_;
+  double mean_;
+  double m2_;
+  double min_;
+  double max_;
+};
+
+/**
+    @class PairwiseSum
+    @brief Streaming pairwise (cascade) summation that can be merged
+
+    Values are summed in blocks of kBlockSize, and block sums are combined
+    like a binary counter, so the rounding error grows with log(n) instead
+    of n while memory stays constant.
+*/
+class PairwiseSum {
+ public:
+  /**
+   * Creates an empty sum.
+   */
+  PairwiseSum();
+
+  /**
+   * Adds one value.
+   * @param x Value.
+   */
+  void add(double x);
+
+  /**
+   * Adds an array of values.
+   * @param data Values.
+   * @param count Number of values.
+   */
+  void add(const double *data, size_t count);
+
+  /**
+   * Adds the values summed by another accumulator.
+   * @param other Sum of other values.
+   */
+  void merge(const PairwiseSum &other);
+
+  /**
+   * Returns the number of values added.
+   * @return Value count.
+   */
+  int64_t count() const;
+
+  /**
+   * Returns the sum.
+   * @return Sum of all values, 0 without values.
+   */
+  double sum() const;
+
+  /// Values summed directly before a block joins the cascade
+  static const size_t kBlockSize = 128;
+
+ private:
+  void carry(int level, double value);
+
+  static const int kLevels = 64;
+
+  double levels_[kLevels];
+  uint64_t occupied_;
+  double block_;
+  size_t blockCount_;
+  int64_t count_;
+};
+
+/**
+    @class TDigest
+    @brief Mergeable streaming quantile sketch (merging t-digest)
+
+    Values are buffered and periodically merged into at most about
+    compression centroids. Centroids are small near the tails (k1 scale
+    function), so extreme quantiles such as p99 and p99.9 stay accurate
+    while memory is bounded regardless of the number of values. Digests
+    built on different threads or processes merge into one digest of all
+    values; write and read move a digest between processes. Const member
+    functions merge the buffer first, so they must not run concurrently on
+    one digest.
+*/
+class TDigest {
+ public:
+  /**
+   * Creates an empty digest.
+   * @param compression Accuracy parameter delta; memory grows linearly with it.
+   * @throws std::invalid_argument If compression is below 10.
+   */
+  explicit TDigest(double compression = 100.0);
+
+  /**
+   * Adds one value.
+   * @param x Value.
+   */
+  void add(double x);
+
+  /**
+   * Adds an array of values.
+   * @param data Values.
+   * @param count Number of values.
+   */
+  void add(const double *data, size_t count);
+
+  /**
+   * Adds the values summarised by another digest.
+   * @param other Digest of other values, of any compression.
+   */
+  void merge(const TDigest &other);
+
+  /**
+   * Estimates a quantile.
+   * @param q Quantile in [0, 1]; 0 and 1 return the exact minimum and maximum.
+   * @return Estimated value, NaN for an empty digest.
+   */
+  double quantile(double q) const;
+
+  /**
+   * Estimates the fraction of values at or below a value.
+   * @param x Value.
+   * @return Estimated cumulative fraction in [0, 1], NaN for an empty digest.
+   */
+  double cdf(double x) const;
+
+  /**
+   * Returns the number of values added.
+   * @return Value count.
+   */
+  int64_t count() const;
+
+  /**
+   * Returns the smallest value.
+   * @return Minimum, +infinity when empty.
+   */
+  double min() const;
+
+  /**
+   * Returns the largest value.
+   * @return Maximum, -infinity when empty.
+   */
+  double max() const;
+
+  /**
+   * Returns the compression parameter.
+   * @return Delta.
+   */
+  double compression() const;
+
+  /**
+   * Returns the number of centroids after merging the buffer.
+   * @return Centroid count, at most about compression.
+   */
+  size_t centroidCount() const;
+
+  /**
+   * Writes the digest as text.
+   * @param out Output stream.
+   */
+  void write(std::ostream &out) const;
+
+  /**
+   * Reads a digest written by write.
+   * @param in Input stream.
+   * @param digest Receives the digest.
+   * @return true if a well-formed digest was read; digest is unchanged otherwise.
+   */
+  static bool read(std::istream &in, TDigest *digest);
+
+ private:
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  void flush() const;
+  void compress(const std::vector<Centroid> &sorted) const;
+
+  double compression_;
+  mutable std::vector<Centroid> centroids_;  // Sorted by mean
+  mutable std::vector<double> buffer_;       // Values not merged yet
+  int64_t count_;
+  double min_;
+  double max_;
+};
+
+/**
+    @class MathUtility
+    @brief Provides statistics over arrays of doubles.
+
+    The array functions use AVX2 kernels when the processor supports them
+    and split inputs larger than kChunkSize across OpenMP threads. Chunks
+    are merged in a fixed order, so results do not depend on the thread
+    count or the instruction set.
+*/
+class MathUtility {
+ public:
+  /**
+   * Calculates the mean of an array.
+   * @param data Values.
+   * @param datalen Number of values.
+   * @return Mean of the values.
+   * @throws std::invalid_argument If data is null or datalen is not positive.
+   */
+  static double calculateMean(const double *data, int datalen);
+
+  /**
+   * Calculates the median of an array without modifying it.
+   * Selects on one copy of the data with calculateMedianInPlace.
+   * @param data Values.
+   * @param datalen Number of values.
+   * @return Middle value, or the mean of the two middle values for an even count.
+   * @throws std::invalid_argument If data is null or datalen is not positive.
+   */
+  static double calculateMedian(const double *data, int datalen);
+
+  /**
+   * Calculates the median of an array by rearranging it, without allocating a copy.
+   * @param data Values, left rearranged as by selectInPlace.
+   * @param count Number of values.
+   * @param numThreads OpenMP threads (0 for the default).
+   * @return Middle value, or the mean of the two middle values for an even count.
+   * @throws std::invalid_argument If data is null or count is 0.
+   */
+  static double calculateMedianInPlace(double *data, size_t count, int numThreads = 0);
+
+  /**
+   * Finds the k-th smallest value, rearranging the array like std::nth_element.
+   *
+   * Large ranges are narrowed Floyd-Rivest style: two pivots taken from a
+   * sample bracket rank k, and parallel partitions keep only the values
+   * between them. The remaining range is finished with introselect
+   * (std::nth_element). Expected time is linear, and no memory
+   * proportional to count is allocated.
+   *
+   * @param data Values; afterwards data[k] holds the result, no value before it is greater and none after it is smaller.
+   * @param count Number of values.
+   * @param k Zero-based rank.
+   * @param numThreads OpenMP threads (0 for the default).
+   * @return The k-th smallest value.
+   * @throws std::invalid_argument If data is null or k is not below count.
+   */
+  static double selectInPlace(double *data, size_t count, size_t k, int numThreads = 0);
+
+  /**
+   * Builds a quantile digest of an array in parallel.
+   * @param data Values.
+   * @param count Number of values.
+   * @param compression Accuracy parameter of the digest.
+   * @param numThreads OpenMP threads (0 for the default).
+   * @return Digest of all values; it does not depend on the thread count.
+   */
+  static TDigest calculateDigest(const double *data, size_t count, double compression = 100.0, int numThreads = 0);
+
+  /**
+   * Calculates the smallest and largest value of an array.
+   * @param data Values.
+   * @param datalen Number of values.
+   * @param min Receives the minimum.
+   * @param max Receives the maximum.
+   * @throws std::invalid_argument If a pointer is null or datalen is not positive.
+   */
+  static void calculateMinMax(const double *data, int datalen, double *min, double *max);
+
+  /**
+   * Compares two doubles, usable as a qsort comparator.
+   * @param a Pointer to the first double.
+   * @param b Pointer to the second double.
+   * @return -1 if a < b, 1 if a > b, 0 otherwise.
+   */
+  static int compareDouble(const void *a, const void *b);
+
+  /**
+   * Calculates count, mean, variance, minimum and maximum in one pass over memory.
+   * @param data Values.
+   * @param count Number of values.
+   * @param numThreads OpenMP threads (0 for the default).
+   * @return Moments of the values.
+   */
+  static RunningMoments calculateMoments(const double *data, size_t count, int numThreads = 0);
+
+  /**
+   * Sums an array with pairwise summation.
+   * @param data Values.
+   * @param count Number of values.
+   * @param numThreads OpenMP threads (0 for the default).
+   * @return Sum of the values, 0 for no values.
+   */
+  static double pairwiseSum(const double *data, size_t count, int numThreads = 0);
+
+  /**
+   * Checks whether the AVX2 kernels are used.
+   * @return true if the processor and operating system support AVX2.
+   */
+  static bool usesAvx2();
+
+  /// Values per parallel work item
+  static const size_t kChunkSize = 1 << 16;
+};
+}
+}
+
+#endif // MATH_UTILITY_H
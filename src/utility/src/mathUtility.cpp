@@ -0,0 +1,962 @@
+#include "../header/mathUtility.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <omp.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define MATH_UTILITY_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+
+// GCC and Clang need per-function target attributes to emit AVX2 above the build baseline
+#if defined(__GNUC__) || defined(__clang__)
+  #define MATH_UTILITY_TARGET(isa) __attribute__((target(isa)))
+#else
+  #define MATH_UTILITY_TARGET(isa)
+#endif
+
+using namespace Can::Utility;
+
+namespace {
+
+// Values per moments block; both passes over a block stay in the L1/L2 cache
+const size_t kMomentsBlock = 4096;
+
+struct Moments {
+  double mean;
+  double m2;
+  double min;
+  double max;
+};
+
+// Every kernel keeps eight partial sums, element i going to sum i % 8, and
+// combines them as ((s0 + s4) + (s1 + s5)) + ((s2 + s6) + (s3 + s7)). The
+// AVX2 kernels hold s0..s3 and s4..s7 in two registers, so both kernels
+// round identically.
+double combineLanes(const double lanes[8]) {
+  return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+}
+
+double sumScalar(const double *data, size_t count) {
+  double lanes[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  size_t i = 0;
+
+  for (; i < count - count % 8; i += 8) {
+    for (int lane = 0; lane < 8; ++lane) {
+      lanes[lane] += data[i + lane];
+    }
+  }
+
+  double sum = combineLanes(lanes);
+
+  for (; i < count; ++i) {
+    sum += data[i];
+  }
+
+  return sum;
+}
+
+void minMaxScalar(const double *data, size_t count, double *min, double *max) {
+  double lo = std::numeric_limits<double>::infinity();
+  double hi = -std::numeric_limits<double>::infinity();
+
+  for (size_t i = 0; i < count; ++i) {
+    lo = data[i] < lo ? data[i] : lo;
+    hi = data[i] > hi ? data[i] : hi;
+  }
+
+  *min = lo;
+  *max = hi;
+}
+
+// Two passes over one block: the mean, then squared deviations corrected by their sum
+Moments momentsScalar(const double *data, size_t count) {
+  Moments moments;
+  minMaxScalar(data, count, &moments.min, &moments.max);
+  moments.mean = sumScalar(data, count) / static_cast<double>(count);
+  double squares[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  double deviations[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  size_t i = 0;
+
+  for (; i < count - count % 8; i += 8) {
+    for (int lane = 0; lane < 8; ++lane) {
+      const double deviation = data[i + lane] - moments.mean;
+      squares[lane] += deviation * deviation;
+      deviations[lane] += deviation;
+    }
+  }
+
+  double square_sum = combineLanes(squares);
+  double deviation_sum = combineLanes(deviations);
+
+  for (; i < count; ++i) {
+    const double deviation = data[i] - moments.mean;
+    square_sum += deviation * deviation;
+    deviation_sum += deviation;
+  }
+
+  moments.m2 = std::max(square_sum - deviation_sum * deviation_sum / static_cast<double>(count), 0.0);
+  return moments;
+}
+
+#ifdef MATH_UTILITY_X86
+
+MATH_UTILITY_TARGET("avx2")
+void storeLanes(__m256d low, __m256d high, double lanes[8]) {
+  _mm256_storeu_pd(lanes, low);
+  _mm256_storeu_pd(lanes + 4, high);
+}
+
+MATH_UTILITY_TARGET("avx2")
+double sumAvx2(const double *data, size_t count) {
+  __m256d low = _mm256_setzero_pd();
+  __m256d high = _mm256_setzero_pd();
+  size_t i = 0;
+
+  for (; i < count - count % 8; i += 8) {
+    low = _mm256_add_pd(low, _mm256_loadu_pd(data + i));
+    high = _mm256_add_pd(high, _mm256_loadu_pd(data + i + 4));
+  }
+
+  double lanes[8];
+  storeLanes(low, high, lanes);
+  double sum = combineLanes(lanes);
+
+  for (; i < count; ++i) {
+    sum += data[i];
+  }
+
+  return sum;
+}
+
+MATH_UTILITY_TARGET("avx2")
+void minMaxAvx2(const double *data, size_t count, double *min, double *max) {
+  __m256d lo = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+  __m256d hi = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+  size_t i = 0;
+
+  for (; i < count - count % 8; i += 8) {
+    const __m256d a = _mm256_loadu_pd(data + i);
+    const __m256d b = _mm256_loadu_pd(data + i + 4);
+    lo = _mm256_min_pd(lo, _mm256_min_pd(a, b));
+    hi = _mm256_max_pd(hi, _mm256_max_pd(a, b));
+  }
+
+  double lows[4];
+  double highs[4];
+  _mm256_storeu_pd(lows, lo);
+  _mm256_storeu_pd(highs, hi);
+  double tail_min;
+  double tail_max;
+  minMaxScalar(data + i, count - i, &tail_min, &tail_max);
+  *min = std::min(std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3])), tail_min);
+  *max = std::max(std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3])), tail_max);
+}
+
+MATH_UTILITY_TARGET("avx2")
+Moments momentsAvx2(const double *data, size_t count) {
+  Moments moments;
+  minMaxAvx2(data, count, &moments.min, &moments.max);
+  moments.mean = sumAvx2(data, count) / static_cast<double>(count);
+  const __m256d mean = _mm256_set1_pd(moments.mean);
+  __m256d squares_low = _mm256_setzero_pd();
+  __m256d squares_high = _mm256_setzero_pd();
+  __m256d deviations_low = _mm256_setzero_pd();
+  __m256d deviations_high = _mm256_setzero_pd();
+  size_t i = 0;
+
+  for (; i < count - count % 8; i += 8) {
+    const __m256d low = _mm256_sub_pd(_mm256_loadu_pd(data + i), mean);
+    const __m256d high = _mm256_sub_pd(_mm256_loadu_pd(data + i + 4), mean);
+    squares_low = _mm256_add_pd(squares_low, _mm256_mul_pd(low, low));
+    squares_high = _mm256_add_pd(squares_high, _mm256_mul_pd(high, high));
+    deviations_low = _mm256_add_pd(deviations_low, low);
+    deviations_high = _mm256_add_pd(deviations_high, high);
+  }
+
+  double lanes[8];
+  storeLanes(squares_low, squares_high, lanes);
+  double square_sum = combineLanes(lanes);
+  storeLanes(deviations_low, deviations_high, lanes);
+  double deviation_sum = combineLanes(lanes);
+
+  for (; i < count; ++i) {
+    const double deviation = data[i] - moments.mean;
+    square_sum += deviation * deviation;
+    deviation_sum += deviation;
+  }
+
+  moments.m2 = std::max(square_sum - deviation_sum * deviation_sum / static_cast<double>(count), 0.0);
+  return moments;
+}
+
+bool detectAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] < 7) {
+    return false;
+  }
+
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0;
+  return osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#else
+
+double sumAvx2(const double *data, size_t count) {
+  return sumScalar(data, count);
+}
+
+void minMaxAvx2(const double *data, size_t count, double *min, double *max) {
+  minMaxScalar(data, count, min, max);
+}
+
+Moments momentsAvx2(const double *data, size_t count) {
+  return momentsScalar(data, count);
+}
+
+bool detectAvx2() {
+  return false;
+}
+
+#endif // MATH_UTILITY_X86
+
+bool hasAvx2() {
+  static const bool avx2 = detectAvx2();
+  return avx2;
+}
+
+double sumBlock(const double *data, size_t count) {
+  return hasAvx2() ? sumAvx2(data, count) : sumScalar(data, count);
+}
+
+RunningMoments momentsBlock(const double *data, size_t count) {
+  const Moments moments = hasAvx2() ? momentsAvx2(data, count) : momentsScalar(data, count);
+  return RunningMoments(static_cast<int64_t>(count), moments.mean, moments.m2, moments.min, moments.max);
+}
+
+// Halves the range down to single blocks
+double pairwise(const double *data, size_t count) {
+  if (count <= PairwiseSum::kBlockSize) {
+    return sumBlock(data, count);
+  }
+
+  const size_t half = count / 2;
+  return pairwise(data, half) + pairwise(data + half, count - half);
+}
+
+size_t chunkCount(size_t count, size_t chunkSize = MathUtility::kChunkSize) {
+  return (count + chunkSize - 1) / chunkSize;
+}
+
+/*
+ * Calls f(chunk, first, last) for each chunkSize range of [0, count),
+ * spread over OpenMP threads when there is more than one chunk.
+ */
+template<typename Func>
+void forEachChunk(size_t count, int numThreads, Func f, size_t chunkSize = MathUtility::kChunkSize) {
+  const long long chunks = static_cast<long long>(chunkCount(count, chunkSize));
+  const int threads = numThreads > 0 ? numThreads : omp_get_max_threads();
+  #pragma omp parallel for schedule(static) num_threads(threads) if(chunks > 1)
+
+  for (long long chunk = 0; chunk < chunks; ++chunk) {
+    const size_t first = static_cast<size_t>(chunk) * chunkSize;
+    f(static_cast<size_t>(chunk), first, std::min(count, first + chunkSize));
+  }
+}
+
+// Merges chunk results as a balanced tree in chunk order, independent of the thread count
+template<typename T, typename Combine>
+T mergeTree(std::vector<T> &parts, Combine combine) {
+  for (size_t width = 1; width < parts.size(); width *= 2) {
+    for (size_t i = 0; i + width < parts.size(); i += 2 * width) {
+      combine(parts[i], parts[i + width]);
+    }
+  }
+
+  return parts.front();
+}
+
+std::pair<double, double> rangeMinMax(const double *data, size_t count, int numThreads) {
+  std::vector<std::pair<double, double>> parts(chunkCount(count));
+  forEachChunk(count, numThreads, [data, &parts](size_t chunk, size_t first, size_t last) {
+    if (hasAvx2()) {
+      minMaxAvx2(data + first, last - first, &parts[chunk].first, &parts[chunk].second);
+    } else {
+      minMaxScalar(data + first, last - first, &parts[chunk].first, &parts[chunk].second);
+    }
+  });
+  const auto combine = [](std::pair<double, double> &a, const std::pair<double, double> &b) {
+    a.first = std::min(a.first, b.first);
+    a.second = std::max(a.second, b.second);
+  };
+  return mergeTree(parts, combine);
+}
+
+/*
+ * Moves the values for which keep holds to the front of [data, data + count)
+ * and returns their number. Chunks are partitioned in parallel; then the
+ * i-th non-kept value left of the split swaps with the i-th kept value right
+ * of it, again in parallel.
+ */
+template<typename Keep>
+size_t parallelPartition(double *data, size_t count, int numThreads, Keep keep) {
+  const size_t chunks = chunkCount(count);
+  std::vector<size_t> kept(chunks);
+  forEachChunk(count, numThreads, [data, &kept, keep](size_t chunk, size_t first, size_t last) {
+    kept[chunk] = static_cast<size_t>(std::partition(data + first, data + last, keep) - (data + first));
+  });
+  size_t split = 0;
+
+  for (size_t chunkKept : kept) {
+    split += chunkKept;
+  }
+
+  // Misplaced positions as runs in ascending order, with the rank of each run's first position
+  std::vector<size_t> holes;
+  std::vector<size_t> holeRanks;
+  std::vector<size_t> strays;
+  std::vector<size_t> strayRanks;
+  size_t misplaced = 0;
+  size_t strayed = 0;
+
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    const size_t first = chunk * MathUtility::kChunkSize;
+    const size_t boundary = first + kept[chunk];
+    const size_t last = std::min(count, first + MathUtility::kChunkSize);
+
+    if (boundary < split && boundary < last) {
+      holes.push_back(boundary);
+      holeRanks.push_back(misplaced);
+      misplaced += std::min(last, split) - boundary;
+    }
+
+    if (boundary > split) {
+      strays.push_back(std::max(first, split));
+      strayRanks.push_back(strayed);
+      strayed += boundary - std::max(first, split);
+    }
+  }
+
+  forEachChunk(misplaced, numThreads, [&](size_t, size_t firstRank, size_t lastRank) {
+    size_t hole = static_cast<size_t>(std::upper_bound(holeRanks.begin(), holeRanks.end(), firstRank) - holeRanks.begin()) - 1;
+    size_t stray = static_cast<size_t>(std::upper_bound(strayRanks.begin(), strayRanks.end(), firstRank) - strayRanks.begin()) - 1;
+
+    for (size_t rank = firstRank; rank < lastRank; ++rank) {
+      if (hole + 1 < holeRanks.size() && rank == holeRanks[hole + 1]) {
+        ++hole;
+      }
+
+      if (stray + 1 < strayRanks.size() && rank == strayRanks[stray + 1]) {
+        ++stray;
+      }
+
+      std::swap(data[holes[hole] + (rank - holeRanks[hole])], data[strays[stray] + (rank - strayRanks[stray])]);
+    }
+  });
+  return split;
+}
+
+// Ranges up to this size are selected with std::nth_element directly
+const size_t kSelectThreshold = 4 * MathUtility::kChunkSize;
+// Sample size and pivot margin of a selection round; the margin is twice the sample rank's standard deviation
+const size_t kSelectSample = 4096;
+const size_t kSelectMargin = 64;
+// Values per digest work item; each keeps a buffer of its own
+const size_t kDigestChunk = size_t(1) << 22;
+// Values buffered per unit of compression before a digest merges them
+const size_t kDigestBufferFactor = 32;
+const double kPi = 3.14159265358979323846;
+
+// k1 scale function of the t-digest and its inverse; one unit of k is the largest allowed centroid
+double digestScale(double q, double compression) {
+  return compression / (2.0 * kPi) * std::asin(2.0 * q - 1.0);
+}
+
+double digestScaleInverse(double k, double compression) {
+  if (k >= compression / 4.0) {
+    return 1.0;
+  }
+
+  return (std::sin(k * 2.0 * kPi / compression) + 1.0) / 2.0;
+}
+
+void checkArray(const double *data, int datalen) {
+  if (data == nullptr || datalen <= 0) {
+    throw std::invalid_argument("Data must contain at least one value.");
+  }
+}
+
+} // namespace
+
+RunningMoments::RunningMoments()
+  : count_(0), mean_(0.0), m2_(0.0), min_(std::numeric_limits<double>::infinity()),
+    max_(-std::numeric_limits<double>::infinity()) {
+}
+
+RunningMoments::RunningMoments(int64_t count, double mean, double m2, double min, double max)
+  : count_(count), mean_(mean), m2_(m2), min_(min), max_(max) {
+}
+
+void RunningMoments::add(double x) {
+  ++count_;
+  const double delta = x - mean_;
+  mean_ += delta / static_cast<double>(count_);
+  m2_ += delta * (x - mean_);
+  min_ = x < min_ ? x : min_;
+  max_ = x > max_ ? x : max_;
+}
+
+void RunningMoments::add(const double *data, size_t count) {
+  for (size_t first = 0; first < count; first += kMomentsBlock) {
+    merge(momentsBlock(data + first, std::min(kMomentsBlock, count - first)));
+  }
+}
+
+void RunningMoments::merge(const RunningMoments &other) {
+  if (other.count_ == 0) {
+    return;
+  }
+
+  if (count_ == 0) {
+    *this = other;
+    return;
+  }
+
+  const double total = static_cast<double>(count_ + other.count_);
+  const double delta = other.mean_ - mean_;
+  const double weight = static_cast<double>(other.count_) / total;
+  mean_ += delta * weight;
+  m2_ += other.m2_ + delta * delta * static_cast<double>(count_) * weight;
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+int64_t RunningMoments::count() const {
+  return count_;
+}
+
+double RunningMoments::mean() const {
+  return mean_;
+}
+
+double RunningMoments::sum() const {
+  return mean_ * static_cast<double>(count_);
+}
+
+double RunningMoments::variance() const {
+  return count_ > 1 ? m2_ / static_cast<double>(count_ - 1) : 0.0;
+}
+
+double RunningMoments::populationVariance() const {
+  return count_ > 0 ? m2_ / static_cast<double>(count_) : 0.0;
+}
+
+double RunningMoments::stdDev() const {
+  return std::sqrt(variance());
+}
+
+double RunningMoments::min() const {
+  return min_;
+}
+
+double RunningMoments::max() const {
+  return max_;
+}
+
+PairwiseSum::PairwiseSum() : occupied_(0), block_(0.0), blockCount_(0), count_(0) {
+  std::fill(levels_, levels_ + kLevels, 0.0);
+}
+
+void PairwiseSum::carry(int level, double value) {
+  // Like incrementing a binary counter: equal-sized partial sums combine upwards
+  while ((occupied_ >> level) & 1) {
+    value = levels_[level] + value;
+    occupied_ &= ~(uint64_t(1) << level);
+    ++level;
+  }
+
+  levels_[level] = value;
+  occupied_ |= uint64_t(1) << level;
+}
+
+void PairwiseSum::add(double x) {
+  block_ += x;
+  ++blockCount_;
+  ++count_;
+
+  if (blockCount_ >= kBlockSize) {
+    carry(0, block_);
+    block_ = 0.0;
+    blockCount_ = 0;
+  }
+}
+
+void PairwiseSum::add(const double *data, size_t count) {
+  size_t i = 0;
+
+  // Top up a started block, then take whole blocks straight from the array
+  while (i < count && blockCount_ != 0) {
+    add(data[i++]);
+  }
+
+  for (; i + kBlockSize <= count; i += kBlockSize) {
+    carry(0, sumBlock(data + i, kBlockSize));
+    count_ += kBlockSize;
+  }
+
+  for (; i < count; ++i) {
+    add(data[i]);
+  }
+}
+
+void PairwiseSum::merge(const PairwiseSum &other) {
+  for (int level = 0; level < kLevels; ++level) {
+    if ((other.occupied_ >> level) & 1) {
+      carry(level, other.levels_[level]);
+    }
+  }
+
+  block_ += other.block_;
+  blockCount_ += other.blockCount_;
+  count_ += other.count_;
+
+  if (blockCount_ >= kBlockSize) {
+    carry(0, block_);
+    block_ = 0.0;
+    blockCount_ = 0;
+  }
+}
+
+int64_t PairwiseSum::count() const {
+  return count_;
+}
+
+double PairwiseSum::sum() const {
+  double total = block_;
+
+  for (int level = 0; level < kLevels; ++level) {
+    if ((occupied_ >> level) & 1) {
+      total = levels_[level] + total;
+    }
+  }
+
+  return total;
+}
+
+TDigest::TDigest(double compression)
+  : compression_(compression), count_(0), min_(std::numeric_limits<double>::infinity()),
+    max_(-std::numeric_limits<double>::infinity()) {
+  if (!(compression >= 10.0)) {
+    throw std::invalid_argument("Compression must be at least 10.");
+  }
+}
+
+void TDigest::add(double x) {
+  buffer_.push_back(x);
+  ++count_;
+  min_ = x < min_ ? x : min_;
+  max_ = x > max_ ? x : max_;
+
+  if (buffer_.size() >= kDigestBufferFactor * static_cast<size_t>(compression_)) {
+    flush();
+  }
+}
+
+void TDigest::add(const double *data, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    add(data[i]);
+  }
+}
+
+void TDigest::merge(const TDigest &other) {
+  if (other.count_ == 0) {
+    return;
+  }
+
+  if (&other == this) {
+    const TDigest copy(other);
+    merge(copy);
+    return;
+  }
+
+  flush();
+  other.flush();
+  std::vector<Centroid> sorted(centroids_.size() + other.centroids_.size());
+  std::merge(centroids_.begin(), centroids_.end(), other.centroids_.begin(), other.centroids_.end(), sorted.begin(),
+  [](const Centroid & a, const Centroid & b) {
+    return a.mean < b.mean;
+  });
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  compress(sorted);
+}
+
+void TDigest::flush() const {
+  if (buffer_.empty()) {
+    return;
+  }
+
+  // Centroids are already sorted, so only the buffered values need sorting before the two are merged
+  std::sort(buffer_.begin(), buffer_.end());
+  std::vector<Centroid> sorted;
+  sorted.reserve(buffer_.size() + centroids_.size());
+  size_t centroid = 0;
+
+  for (double value : buffer_) {
+    while (centroid < centroids_.size() && centroids_[centroid].mean < value) {
+      sorted.push_back(centroids_[centroid++]);
+    }
+
+    sorted.push_back(Centroid{value, 1.0});
+  }
+
+  sorted.insert(sorted.end(), centroids_.begin() + static_cast<std::ptrdiff_t>(centroid), centroids_.end());
+  buffer_.clear();
+  compress(sorted);
+}
+
+void TDigest::compress(const std::vector<Centroid> &sorted) const {
+  double total = 0.0;
+
+  for (const Centroid &centroid : sorted) {
+    total += centroid.weight;
+  }
+
+  // Greedily merge neighbours while the centroid stays within one unit of the scale function
+  centroids_.clear();
+  Centroid current = sorted.front();
+  double before = 0.0;
+  double limit = total * digestScaleInverse(digestScale(0.0, compression_) + 1.0, compression_);
+
+  for (size_t i = 1; i < sorted.size(); ++i) {
+    const Centroid &next = sorted[i];
+
+    if (before + current.weight + next.weight <= limit) {
+      current.weight += next.weight;
+      current.mean += (next.mean - current.mean) * next.weight / current.weight;
+    } else {
+      before += current.weight;
+      centroids_.push_back(current);
+      limit = total * digestScaleInverse(digestScale(before / total, compression_) + 1.0, compression_);
+      current = next;
+    }
+  }
+
+  centroids_.push_back(current);
+}
+
+double TDigest::quantile(double q) const {
+  flush();
+
+  if (centroids_.empty()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  if (q <= 0.0) {
+    return min_;
+  }
+
+  if (q >= 1.0) {
+    return max_;
+  }
+
+  // Each centroid's mean sits at the middle of its weight; interpolate between those points and the extremes
+  const double target = q * static_cast<double>(count_);
+  double before = 0.0;
+  double previousMean = min_;
+  double previousPosition = 0.0;
+
+  for (const Centroid &centroid : centroids_) {
+    const double position = before + centroid.weight / 2.0;
+
+    if (target < position) {
+      const double fraction = (target - previousPosition) / (position - previousPosition);
+      return previousMean + fraction * (centroid.mean - previousMean);
+    }
+
+    before += centroid.weight;
+    previousMean = centroid.mean;
+    previousPosition = position;
+  }
+
+  const double fraction = (target - previousPosition) / (static_cast<double>(count_) - previousPosition);
+  return previousMean + fraction * (max_ - previousMean);
+}
+
+double TDigest::cdf(double x) const {
+  flush();
+
+  if (centroids_.empty()) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  if (x < min_) {
+    return 0.0;
+  }
+
+  if (x >= max_) {
+    return 1.0;
+  }
+
+  const double total = static_cast<double>(count_);
+  double before = 0.0;
+  double previousMean = min_;
+  double previousPosition = 0.0;
+
+  for (const Centroid &centroid : centroids_) {
+    const double position = before + centroid.weight / 2.0;
+
+    if (x < centroid.mean) {
+      const double span = centroid.mean - previousMean;
+      const double fraction = span > 0.0 ? (x - previousMean) / span : 1.0;
+      return (previousPosition + fraction * (position - previousPosition)) / total;
+    }
+
+    before += centroid.weight;
+    previousMean = centroid.mean;
+    previousPosition = position;
+  }
+
+  const double fraction = (x - previousMean) / (max_ - previousMean);
+  return (previousPosition + fraction * (total - previousPosition)) / total;
+}
+
+int64_t TDigest::count() const {
+  return count_;
+}
+
+double TDigest::min() const {
+  return min_;
+}
+
+double TDigest::max() const {
+  return max_;
+}
+
+double TDigest::compression() const {
+  return compression_;
+}
+
+size_t TDigest::centroidCount() const {
+  flush();
+  return centroids_.size();
+}
+
+void TDigest::write(std::ostream &out) const {
+  flush();
+  const std::streamsize precision = out.precision(17);
+  out << "tdigest " << compression_ << ' ' << count_ << ' ' << min_ << ' ' << max_ << ' ' << centroids_.size() << '\n';
+
+  for (const Centroid &centroid : centroids_) {
+    out << centroid.mean << ' ' << centroid.weight << '\n';
+  }
+
+  out.precision(precision);
+}
+
+bool TDigest::read(std::istream &in, TDigest *digest) {
+  std::string tag;
+  double compression;
+  int64_t count;
+  double min;
+  double max;
+  size_t centroids;
+
+  if (digest == nullptr || !(in >> tag >> compression >> count >> min >> max >> centroids) || tag != "tdigest"
+      || !(compression >= 10.0) || count < 0) {
+    return false;
+  }
+
+  TDigest result(compression);
+  double weight = 0.0;
+
+  for (size_t i = 0; i < centroids; ++i) {
+    Centroid centroid;
+
+    if (!(in >> centroid.mean >> centroid.weight) || !(centroid.weight > 0.0)) {
+      return false;
+    }
+
+    weight += centroid.weight;
+    result.centroids_.push_back(centroid);
+  }
+
+  if (weight != static_cast<double>(count)) {
+    return false;
+  }
+
+  result.count_ = count;
+  result.min_ = min;
+  result.max_ = max;
+  *digest = result;
+  return true;
+}
+
+double MathUtility::calculateMean(const double *data, int datalen) {
+  checkArray(data, datalen);
+  return calculateMoments(data, static_cast<size_t>(datalen)).mean();
+}
+
+double MathUtility::calculateMedian(const double *data, int datalen) {
+  checkArray(data, datalen);
+  std::vector<double> values(data, data + datalen);
+  return calculateMedianInPlace(values.data(), values.size());
+}
+
+double MathUtility::calculateMedianInPlace(double *data, size_t count, int numThreads) {
+  if (data == nullptr || count == 0) {
+    throw std::invalid_argument("Data must contain at least one value.");
+  }
+
+  const size_t middle = count / 2;
+  const double upper = selectInPlace(data, count, middle, numThreads);
+
+  if (count % 2 == 1) {
+    return upper;
+  }
+
+  // Selection leaves the lower half in front, so its maximum is the other middle value
+  const double lower = rangeMinMax(data, middle, numThreads).second;
+  return lower + (upper - lower) / 2.0;
+}
+
+double MathUtility::selectInPlace(double *data, size_t count, size_t k, int numThreads) {
+  if (data == nullptr || k >= count) {
+    throw std::invalid_argument("Rank must be below the number of values.");
+  }
+
+  size_t first = 0;
+  size_t last = count;
+
+  while (last - first > kSelectThreshold) {
+    const size_t size = last - first;
+    double sample[kSelectSample];
+
+    for (size_t i = 0; i < kSelectSample; ++i) {
+      sample[i] = data[first + i * (size / kSelectSample)];
+    }
+
+    // Pivots about two standard deviations of the sample rank either side of k
+    std::sort(sample, sample + kSelectSample);
+    const size_t rank = static_cast<size_t>(static_cast<double>(k - first) / static_cast<double>(size) * kSelectSample);
+    const double low = sample[rank > kSelectMargin ? rank - kSelectMargin : 0];
+    const double high = sample[std::min(rank + kSelectMargin, kSelectSample - 1)];
+    const size_t below = parallelPartition(data + first, size, numThreads, [low](double x) {
+      return x < low;
+    });
+
+    if (k < first + below) {
+      last = first + below;
+      continue;
+    }
+
+    first += below;
+    const size_t band = parallelPartition(data + first, last - first, numThreads, [high](double x) {
+      return x <= high;
+    });
+
+    if (k >= first + band) {
+      first += band;
+    } else if (low == high) {
+      // The whole band equals the pivot
+      return low;
+    } else if (band == size) {
+      break;
+    } else {
+      last = first + band;
+    }
+  }
+
+  std::nth_element(data + first, data + k, data + last);
+  return data[k];
+}
+
+void MathUtility::calculateMinMax(const double *data, int datalen, double *min, double *max) {
+  checkArray(data, datalen);
+
+  if (min == nullptr || max == nullptr) {
+    throw std::invalid_argument("Output pointers must not be null.");
+  }
+
+  const std::pair<double, double> range = rangeMinMax(data, static_cast<size_t>(datalen), 0);
+  *min = range.first;
+  *max = range.second;
+}
+
+int MathUtility::compareDouble(const void *a, const void *b) {
+  const double x = *static_cast<const double *>(a);
+  const double y = *static_cast<const double *>(b);
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+RunningMoments MathUtility::calculateMoments(const double *data, size_t count, int numThreads) {
+  if (data == nullptr || count == 0) {
+    return RunningMoments();
+  }
+
+  std::vector<RunningMoments> parts(chunkCount(count));
+  forEachChunk(count, numThreads, [data, &parts](size_t chunk, size_t first, size_t last) {
+    parts[chunk].add(data + first, last - first);
+  });
+  return mergeTree(parts, [](RunningMoments & a, const RunningMoments & b) {
+    a.merge(b);
+  });
+}
+
+double MathUtility::pairwiseSum(const double *data, size_t count, int numThreads) {
+  if (data == nullptr || count == 0) {
+    return 0.0;
+  }
+
+  std::vector<double> parts(chunkCount(count));
+  forEachChunk(count, numThreads, [data, &parts](size_t chunk, size_t first, size_t last) {
+    parts[chunk] = pairwise(data + first, last - first);
+  });
+  return mergeTree(parts, [](double & a, double b) {
+    a += b;
+  });
+}
+
+bool MathUtility::usesAvx2() {
+  return hasAvx2();
+}
+
+TDigest MathUtility::calculateDigest(const double *data, size_t count, double compression, int numThreads) {
+  TDigest digest(compression);
+
+  if (data == nullptr || count == 0) {
+    return digest;
+  }
+
+  std::vector<TDigest> parts(chunkCount(count, kDigestChunk), digest);
+  forEachChunk(count, numThreads, [data, &parts](size_t chunk, size_t first, size_t last) {
+    parts[chunk].add(data + first, last - first);
+  }, kDigestChunk);
+  return mergeTree(parts, [](TDigest & a, const TDigest & b) {
+    a.merge(b);
+  });
+}